@@ -11,6 +11,32 @@
 #define LINMATH_H_FUNC static inline
 #endif
 
+/* The hot matrix kernels (mul, mul_vec4, invert, look_at) have SIMD versions
+ * picked at compile time. The scalar originals stay available as *_scalar,
+ * define LINMATH_NO_SIMD to use them everywhere. */
+#if !defined(LINMATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define LINMATH_SSE 1
+#include <emmintrin.h>
+#if defined(__AVX2__) && defined(__FMA__)
+#define LINMATH_AVX2 1
+#include <immintrin.h>
+#endif
+#define LINMATH_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(w, z, y, x))
+#elif !defined(LINMATH_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define LINMATH_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(LINMATH_AVX2)
+#define LINMATH_SIMD_NAME "avx2"
+#elif defined(LINMATH_SSE)
+#define LINMATH_SIMD_NAME "sse2"
+#elif defined(LINMATH_NEON)
+#define LINMATH_SIMD_NAME "neon"
+#else
+#define LINMATH_SIMD_NAME "scalar"
+#endif
+
 #define LINMATH_H_DEFINE_VEC(n) \
 typedef float vec##n[n]; \
 LINMATH_H_FUNC void vec##n##_add(vec##n r, vec##n const a, vec##n const b) \
@@ -162,7 +188,7 @@ LINMATH_H_FUNC void mat4x4_scale_aniso(mat4x4 M, mat4x4 const a, float x, float
 	vec4_scale(M[2], a[2], z);
 	vec4_dup(M[3], a[3]);
 }
-LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b)
+LINMATH_H_FUNC void mat4x4_mul_scalar(mat4x4 M, mat4x4 const a, mat4x4 const b)
 {
 	mat4x4 temp;
 	int k, r, c;
@@ -173,7 +199,7 @@ LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b)
 	}
 	mat4x4_dup(M, temp);
 }
-LINMATH_H_FUNC void mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v)
+LINMATH_H_FUNC void mat4x4_mul_vec4_scalar(vec4 r, mat4x4 const M, vec4 const v)
 {
 	int i, j;
 	for(j=0; j<4; ++j) {
@@ -182,6 +208,97 @@ LINMATH_H_FUNC void mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v)
 			r[j] += M[i][j] * v[i];
 	}
 }
+/* Column c of the product is the columns of a weighted by column c of b.
+ * Without FMA the sums run in the scalar order, so the results match it bit for bit.
+ * Everything is loaded before the first store, M and r may alias the inputs. */
+LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b)
+{
+#if defined(LINMATH_AVX2)
+	/* two columns per register, each a column of a needs in both halves */
+	__m256 a01 = _mm256_loadu_ps(a[0]);
+	__m256 a23 = _mm256_loadu_ps(a[2]);
+	__m256 a0 = _mm256_permute2f128_ps(a01, a01, 0x00);
+	__m256 a1 = _mm256_permute2f128_ps(a01, a01, 0x11);
+	__m256 a2 = _mm256_permute2f128_ps(a23, a23, 0x00);
+	__m256 a3 = _mm256_permute2f128_ps(a23, a23, 0x11);
+	__m256 b01 = _mm256_loadu_ps(b[0]);
+	__m256 b23 = _mm256_loadu_ps(b[2]);
+
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+	r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+	r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xaa), r01);
+	r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xff), r01);
+
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+	r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+	r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xaa), r23);
+	r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xff), r23);
+
+	_mm256_storeu_ps(M[0], r01);
+	_mm256_storeu_ps(M[2], r23);
+#elif defined(LINMATH_SSE)
+	__m128 a0 = _mm_loadu_ps(a[0]);
+	__m128 a1 = _mm_loadu_ps(a[1]);
+	__m128 a2 = _mm_loadu_ps(a[2]);
+	__m128 a3 = _mm_loadu_ps(a[3]);
+	__m128 r[4];
+	int c;
+	for(c=0; c<4; ++c) {
+		__m128 bc = _mm_loadu_ps(b[c]);
+		r[c] = _mm_mul_ps(a0, LINMATH_SWIZZLE(bc, 0, 0, 0, 0));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a1, LINMATH_SWIZZLE(bc, 1, 1, 1, 1)));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a2, LINMATH_SWIZZLE(bc, 2, 2, 2, 2)));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a3, LINMATH_SWIZZLE(bc, 3, 3, 3, 3)));
+	}
+	for(c=0; c<4; ++c)
+		_mm_storeu_ps(M[c], r[c]);
+#elif defined(LINMATH_NEON)
+	float32x4_t a0 = vld1q_f32(a[0]);
+	float32x4_t a1 = vld1q_f32(a[1]);
+	float32x4_t a2 = vld1q_f32(a[2]);
+	float32x4_t a3 = vld1q_f32(a[3]);
+	float32x4_t r[4];
+	int c;
+	for(c=0; c<4; ++c) {
+		float32x4_t bc = vld1q_f32(b[c]);
+		r[c] = vmulq_laneq_f32(a0, bc, 0);
+		r[c] = vfmaq_laneq_f32(r[c], a1, bc, 1);
+		r[c] = vfmaq_laneq_f32(r[c], a2, bc, 2);
+		r[c] = vfmaq_laneq_f32(r[c], a3, bc, 3);
+	}
+	for(c=0; c<4; ++c)
+		vst1q_f32(M[c], r[c]);
+#else
+	mat4x4_mul_scalar(M, a, b);
+#endif
+}
+LINMATH_H_FUNC void mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v)
+{
+#if defined(LINMATH_SSE)
+	/* a single column, too narrow for AVX2 to help */
+	__m128 x = _mm_loadu_ps(v);
+	__m128 p = _mm_mul_ps(_mm_loadu_ps(M[0]), LINMATH_SWIZZLE(x, 0, 0, 0, 0));
+#if defined(LINMATH_AVX2)
+	p = _mm_fmadd_ps(_mm_loadu_ps(M[1]), LINMATH_SWIZZLE(x, 1, 1, 1, 1), p);
+	p = _mm_fmadd_ps(_mm_loadu_ps(M[2]), LINMATH_SWIZZLE(x, 2, 2, 2, 2), p);
+	p = _mm_fmadd_ps(_mm_loadu_ps(M[3]), LINMATH_SWIZZLE(x, 3, 3, 3, 3), p);
+#else
+	p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(M[1]), LINMATH_SWIZZLE(x, 1, 1, 1, 1)));
+	p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(M[2]), LINMATH_SWIZZLE(x, 2, 2, 2, 2)));
+	p = _mm_add_ps(p, _mm_mul_ps(_mm_loadu_ps(M[3]), LINMATH_SWIZZLE(x, 3, 3, 3, 3)));
+#endif
+	_mm_storeu_ps(r, p);
+#elif defined(LINMATH_NEON)
+	float32x4_t x = vld1q_f32(v);
+	float32x4_t p = vmulq_laneq_f32(vld1q_f32(M[0]), x, 0);
+	p = vfmaq_laneq_f32(p, vld1q_f32(M[1]), x, 1);
+	p = vfmaq_laneq_f32(p, vld1q_f32(M[2]), x, 2);
+	p = vfmaq_laneq_f32(p, vld1q_f32(M[3]), x, 3);
+	vst1q_f32(r, p);
+#else
+	mat4x4_mul_vec4_scalar(r, M, v);
+#endif
+}
 LINMATH_H_FUNC void mat4x4_translate(mat4x4 T, float x, float y, float z)
 {
 	mat4x4_identity(T);
@@ -275,7 +392,7 @@ LINMATH_H_FUNC void mat4x4_rotate_Z(mat4x4 Q, mat4x4 const M, float angle)
 	};
 	mat4x4_mul(Q, M, R);
 }
-LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M)
+LINMATH_H_FUNC void mat4x4_invert_scalar(mat4x4 T, mat4x4 const M)
 {
 	float s[6];
 	float c[6];
@@ -316,6 +433,81 @@ LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M)
 	T[3][2] = (-M[3][0] * s[3] + M[3][1] * s[1] - M[3][2] * s[0]) * idet;
 	T[3][3] = ( M[2][0] * s[3] - M[2][1] * s[1] + M[2][2] * s[0]) * idet;
 }
+#if defined(LINMATH_SSE)
+/* 2x2 blocks packed as (m00, m01, m10, m11): A*B, adj(A)*B and A*adj(B) */
+LINMATH_H_FUNC __m128 mat2_mul_sse(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, LINMATH_SWIZZLE(b, 0, 3, 0, 3)),
+	                  _mm_mul_ps(LINMATH_SWIZZLE(a, 1, 0, 3, 2), LINMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+LINMATH_H_FUNC __m128 mat2_adj_mul_sse(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(LINMATH_SWIZZLE(a, 3, 3, 0, 0), b),
+	                  _mm_mul_ps(LINMATH_SWIZZLE(a, 1, 1, 2, 2), LINMATH_SWIZZLE(b, 2, 3, 0, 1)));
+}
+LINMATH_H_FUNC __m128 mat2_mul_adj_sse(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, LINMATH_SWIZZLE(b, 3, 0, 3, 0)),
+	                  _mm_mul_ps(LINMATH_SWIZZLE(a, 1, 0, 3, 2), LINMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+/* The SIMD version inverts blockwise from 2x2 sub matrices, a different
+ * rounding order than the cofactors above, so it agrees to a few ULP only.
+ * The block formulas hold for either storage order, the inverse of the
+ * transpose is the transpose of the inverse. */
+LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M)
+{
+#if defined(LINMATH_SSE)
+	__m128 c0 = _mm_loadu_ps(M[0]);
+	__m128 c1 = _mm_loadu_ps(M[1]);
+	__m128 c2 = _mm_loadu_ps(M[2]);
+	__m128 c3 = _mm_loadu_ps(M[3]);
+
+	__m128 A = _mm_movelh_ps(c0, c1);
+	__m128 B = _mm_movehl_ps(c1, c0);
+	__m128 C = _mm_movelh_ps(c2, c3);
+	__m128 D = _mm_movehl_ps(c3, c2);
+
+	/* determinants of the four blocks, (|A|, |B|, |C|, |D|) */
+	__m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+	__m128 detA = LINMATH_SWIZZLE(detSub, 0, 0, 0, 0);
+	__m128 detB = LINMATH_SWIZZLE(detSub, 1, 1, 1, 1);
+	__m128 detC = LINMATH_SWIZZLE(detSub, 2, 2, 2, 2);
+	__m128 detD = LINMATH_SWIZZLE(detSub, 3, 3, 3, 3);
+
+	__m128 DC = mat2_adj_mul_sse(D, C);
+	__m128 AB = mat2_adj_mul_sse(A, B);
+	/* adjugates of the inverse's blocks, X Y over Z W */
+	__m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mat2_mul_sse(B, DC));
+	__m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mat2_mul_sse(C, AB));
+	__m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mat2_mul_adj_sse(D, AB));
+	__m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mat2_mul_adj_sse(A, DC));
+
+	/* |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C) */
+	__m128 tr = _mm_mul_ps(AB, LINMATH_SWIZZLE(DC, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+	tr = _mm_add_ss(tr, LINMATH_SWIZZLE(tr, 1, 1, 1, 1));
+	tr = LINMATH_SWIZZLE(tr, 0, 0, 0, 0);
+	__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+	/* Assumes it is invertible */
+	__m128 idet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+	X = _mm_mul_ps(X, idet);
+	Y = _mm_mul_ps(Y, idet);
+	Z = _mm_mul_ps(Z, idet);
+	W = _mm_mul_ps(W, idet);
+
+	/* undoes the adjugate and the block packing in one shuffle */
+	_mm_storeu_ps(T[0], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(T[1], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2)));
+	_mm_storeu_ps(T[2], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3)));
+	_mm_storeu_ps(T[3], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2)));
+#else
+	mat4x4_invert_scalar(T, M);
+#endif
+}
 LINMATH_H_FUNC void mat4x4_orthonormalize(mat4x4 R, mat4x4 const M)
 {
 	mat4x4_dup(R, M);
@@ -397,7 +589,7 @@ LINMATH_H_FUNC void mat4x4_perspective(mat4x4 m, float y_fov, float aspect, floa
 	m[3][2] = -((2.f * f * n) / (f - n));
 	m[3][3] = 0.f;
 }
-LINMATH_H_FUNC void mat4x4_look_at(mat4x4 m, vec3 const eye, vec3 const center, vec3 const up)
+LINMATH_H_FUNC void mat4x4_look_at_scalar(mat4x4 m, vec3 const eye, vec3 const center, vec3 const up)
 {
 	/* Adapted from Android's OpenGL Matrix.java.                        */
 	/* See the OpenGL GLUT documentation for gluLookAt for a description */
@@ -438,6 +630,52 @@ LINMATH_H_FUNC void mat4x4_look_at(mat4x4 m, vec3 const eye, vec3 const center,
 
 	mat4x4_translate_in_place(m, -eye[0], -eye[1], -eye[2]);
 }
+#if defined(LINMATH_SSE)
+/* same operations per lane as vec3_mul_cross and vec3_norm, w stays 0 */
+LINMATH_H_FUNC __m128 vec3_cross_sse(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(LINMATH_SWIZZLE(a, 1, 2, 0, 3), LINMATH_SWIZZLE(b, 2, 0, 1, 3)),
+	                  _mm_mul_ps(LINMATH_SWIZZLE(a, 2, 0, 1, 3), LINMATH_SWIZZLE(b, 1, 2, 0, 3)));
+}
+LINMATH_H_FUNC __m128 vec3_norm_sse(__m128 v)
+{
+	__m128 p = _mm_mul_ps(v, v);
+	__m128 len = _mm_add_ss(_mm_add_ss(p, LINMATH_SWIZZLE(p, 1, 1, 1, 1)), LINMATH_SWIZZLE(p, 2, 2, 2, 2));
+	len = _mm_div_ss(_mm_set_ss(1.f), _mm_sqrt_ss(len));
+	return _mm_mul_ps(v, LINMATH_SWIZZLE(len, 0, 0, 0, 0));
+}
+#endif
+/* Matches the scalar version bit for bit without FMA. */
+LINMATH_H_FUNC void mat4x4_look_at(mat4x4 m, vec3 const eye, vec3 const center, vec3 const up)
+{
+#if defined(LINMATH_SSE)
+	__m128 e = _mm_setr_ps(eye[0], eye[1], eye[2], 0.f);
+	__m128 f = vec3_norm_sse(_mm_sub_ps(_mm_setr_ps(center[0], center[1], center[2], 0.f), e));
+	__m128 s = vec3_norm_sse(vec3_cross_sse(f, _mm_setr_ps(up[0], up[1], up[2], 0.f)));
+	__m128 t = vec3_cross_sse(s, f);
+	/* sign flips rather than 0 - x, so zeros keep the scalar sign */
+	__m128 sign = _mm_set1_ps(-0.f);
+	__m128 nf = _mm_xor_ps(f, sign);
+	__m128 w = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+
+	/* s, t and -f are the rows */
+	_MM_TRANSPOSE4_PS(s, t, nf, w);
+
+	/* translate_in_place by -eye, the w term is a zero product in the scalar sum */
+	__m128 ne = _mm_xor_ps(e, sign);
+	__m128 p = _mm_mul_ps(s, LINMATH_SWIZZLE(ne, 0, 0, 0, 0));
+	p = _mm_add_ps(p, _mm_mul_ps(t, LINMATH_SWIZZLE(ne, 1, 1, 1, 1)));
+	p = _mm_add_ps(p, _mm_mul_ps(nf, LINMATH_SWIZZLE(ne, 2, 2, 2, 2)));
+	p = _mm_add_ps(p, _mm_mul_ps(w, _mm_setzero_ps()));
+
+	_mm_storeu_ps(m[0], s);
+	_mm_storeu_ps(m[1], t);
+	_mm_storeu_ps(m[2], nf);
+	_mm_storeu_ps(m[3], _mm_add_ps(w, p));
+#else
+	mat4x4_look_at_scalar(m, eye, center, up);
+#endif
+}
 
 typedef float quat[4];
 #define quat_add vec4_add
@@ -0,0 +1,7 @@
+// per-frame camera data, written to the renderer's ring buffer, see renderer.c
+layout (std140) uniform Camera {
+    mat4x4 projection;
+    mat4x4 view;
+    mat4x4 inverseViewProjection;
+    vec3 viewPos;
+};
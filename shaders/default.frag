@@ -5,62 +5,9 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_diffuse2;
-    sampler2D texture_diffuse3;
-    sampler2D texture_specular1;
-    sampler2D texture_specular2;
-
-    float shininess;
-};
-
-uniform Material material;
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-uniform DirLight dirLight;
-
-struct PointLight {
-    vec3 position;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-#define NUM_POINT_LIGHTS 4
-uniform PointLight pointLights[NUM_POINT_LIGHTS];
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-
-    float cutOff;
-    float outerCutOff;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-uniform SpotLight spotLight;
-
-uniform vec3 viewPos;
+#include "material.glsl"
+#include "lights.glsl"
+#include "camera.glsl"
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -73,8 +20,10 @@ void main() {
 
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
 
-    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+    uvec2 lightList = FetchCluster(gl_FragCoord.z);
+    for (uint i = 0u; i < lightList.y; i++) {
+        int index = int(texelFetch(cluster.indices, int(lightList.x + i)).r);
+        result += CalcPointLight(FetchPointLight(index), norm, FragPos, viewDir);
     }
 
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
@@ -93,14 +42,19 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = light.ambient * vec3(MaterialDiffuse(TexCoords));
+    vec3 diffuse = light.diffuse * diff * vec3(MaterialDiffuse(TexCoords));
+    vec3 specular = light.specular * spec * vec3(MaterialSpecular(TexCoords));
 
     return (ambient + diffuse + specular);
 }
 
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    float distance = length(light.position - fragPos);
+    if (distance > light.range) {
+        return vec3(0.0);
+    }
+
     vec3 lightDir = normalize(light.position - fragPos);
 
     float diff = max(dot(normal, lightDir), 0.0);
@@ -108,12 +62,11 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = light.ambient * vec3(MaterialDiffuse(TexCoords));
+    vec3 diffuse = light.diffuse * diff * vec3(MaterialDiffuse(TexCoords));
+    vec3 specular = light.specular * spec * vec3(MaterialSpecular(TexCoords));
 
     return (ambient + diffuse + specular) * attenuation;
 }
@@ -129,9 +82,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
 
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 ambient = light.ambient * vec3(MaterialDiffuse(TexCoords));
+    vec3 diffuse = light.diffuse * diff * vec3(MaterialDiffuse(TexCoords));
+    vec3 specular = light.specular * spec * vec3(MaterialSpecular(TexCoords));
 
     float theta = dot(lightDir, normalize(-light.direction));
     float epsilon = light.cutOff - light.outerCutOff;
@@ -8,8 +8,11 @@ out vec3 Normal;
 out vec2 TexCoords;
 
 uniform mat4x4 model;
-uniform mat4x4 view;
-uniform mat4x4 projection;
+
+#include "camera.glsl"
+
+// depth.vert computes the same position for the depth pre-pass
+invariant gl_Position;
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
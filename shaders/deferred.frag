@@ -0,0 +1,121 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+struct Material {
+    float shininess;
+};
+
+uniform Material material;
+
+#include "lights.glsl"
+#include "normals.glsl"
+#include "camera.glsl"
+
+// surface attributes read back from the G-buffer
+vec3 Albedo;
+float Specular;
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+
+void main() {
+    float depthSample = texture(gDepth, TexCoords).r;
+    if (depthSample == 1.0) {
+        // nothing was drawn here, keep the clear color
+        discard;
+    }
+
+    vec4 albedoSpec = texture(gAlbedoSpec, TexCoords);
+    Albedo = albedoSpec.rgb;
+    Specular = albedoSpec.a;
+
+    vec4 position = inverseViewProjection * vec4(vec3(TexCoords, depthSample) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = position.xyz / position.w;
+
+    vec3 norm = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+
+    uvec2 lightList = FetchCluster(depthSample);
+    for (uint i = 0u; i < lightList.y; i++) {
+        int index = int(texelFetch(cluster.indices, int(lightList.x + i)).r);
+        result += CalcPointLight(FetchPointLight(index), norm, fragPos, viewDir);
+    }
+
+    result += CalcSpotLight(spotLight, norm, fragPos, viewDir);
+
+    FragColor = vec4(result, 1.0);
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
+
+    vec3 lightDir = normalize(-light.direction);
+
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+    vec3 ambient = light.ambient * Albedo;
+    vec3 diffuse = light.diffuse * diff * Albedo;
+    vec3 specular = light.specular * spec * Specular;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    float distance = length(light.position - fragPos);
+    if (distance > light.range) {
+        return vec3(0.0);
+    }
+
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 ambient = light.ambient * Albedo;
+    vec3 diffuse = light.diffuse * diff * Albedo;
+    vec3 specular = light.specular * spec * Specular;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
+    vec3 lightDir = normalize(light.position - fragPos);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 ambient = light.ambient * Albedo;
+    vec3 diffuse = light.diffuse * diff * Albedo;
+    vec3 specular = light.specular * spec * Specular;
+
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+    diffuse *= intensity;
+    specular *= intensity;
+
+    return (ambient + diffuse + specular) * attenuation;
+}
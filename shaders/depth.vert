@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4x4 model;
+
+#include "camera.glsl"
+
+// must match default.vert bit for bit, the color pass depth tests with GL_EQUAL
+invariant gl_Position;
+
+void main() {
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view  * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec2 gNormal;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+#include "material.glsl"
+#include "normals.glsl"
+
+void main() {
+    gAlbedoSpec.rgb = MaterialDiffuse(TexCoords).rgb;
+    gAlbedoSpec.a = MaterialSpecular(TexCoords).r;
+    gNormal = EncodeNormal(normalize(Normal));
+}
@@ -1,10 +1,11 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4x4 model;
-uniform mat4x4 view;
-uniform mat4x4 projection;
+// per instance, see renderLightCubes
+layout (location = 3) in mat4 instanceModel;
+
+#include "camera.glsl"
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * instanceModel * vec4(aPos, 1.0);
 }
@@ -0,0 +1,90 @@
+// light declarations shared by the forward and deferred lighting shaders
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform DirLight dirLight;
+
+struct PointLight {
+    vec3 position;
+    float range;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// point lights are binned per froxel on the CPU, see cluster.c
+struct Cluster {
+    samplerBuffer lights;
+    usamplerBuffer grid;
+    usamplerBuffer indices;
+
+    ivec3 dims;
+    vec2 screenSize;
+    float near;
+    float far;
+    float sliceScale;
+    float sliceBias;
+};
+
+uniform Cluster cluster;
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+
+    float cutOff;
+    float outerCutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+layout (std140) uniform Lights {
+    SpotLight spotLight;
+};
+
+PointLight FetchPointLight(int index) {
+    vec4 texel0 = texelFetch(cluster.lights, index * 4);
+    vec4 texel1 = texelFetch(cluster.lights, index * 4 + 1);
+    vec4 texel2 = texelFetch(cluster.lights, index * 4 + 2);
+    vec4 texel3 = texelFetch(cluster.lights, index * 4 + 3);
+
+    PointLight light;
+    light.position = texel0.xyz;
+    light.range = texel0.w;
+    light.ambient = texel1.rgb;
+    light.constant = texel1.w;
+    light.diffuse = texel2.rgb;
+    light.linear = texel2.w;
+    light.specular = texel3.rgb;
+    light.quadratic = texel3.w;
+
+    return light;
+}
+
+// offset and count of the light list covering a pixel, depthSample is its window space depth
+uvec2 FetchCluster(float depthSample) {
+    float ndcDepth = depthSample * 2.0 - 1.0;
+    float depth = 2.0 * cluster.near * cluster.far / (cluster.far + cluster.near - ndcDepth * (cluster.far - cluster.near));
+
+    ivec2 tile = ivec2(gl_FragCoord.xy / cluster.screenSize * vec2(cluster.dims.xy));
+    int slice = int(log(depth) * cluster.sliceScale + cluster.sliceBias);
+
+    ivec3 id = clamp(ivec3(tile, slice), ivec3(0), cluster.dims - 1);
+    return texelFetch(cluster.grid, id.x + cluster.dims.x * (id.y + cluster.dims.y * id.z)).xy;
+}
@@ -0,0 +1,83 @@
+// texture sampling of the three material paths, the C side picks one with materialDefines in renderer.c
+// MATERIAL_ARRAYS is defined when material textures are packed into array layers and atlas pages, see texpack.c
+#ifdef MATERIAL_ARRAYS
+struct Material {
+    sampler2DArray diffuseArray;
+    sampler2DArray specularArray;
+    float diffuseLayer;
+    float specularLayer;
+    // scale xy, offset zw of the texture inside its layer
+    vec4 diffuseTransform;
+    vec4 specularTransform;
+
+    float shininess;
+};
+
+uniform Material material;
+
+// wraps inside the atlas tile, gradients come from the unwrapped coordinates so mip selection has no seams.
+// Tiles have no gutter, so the wrapped coordinate stays half a texel of the coarser filtered level inside the tile
+// and linear taps never reach a neighbour
+vec4 SampleLayer(sampler2DArray array, float layer, vec4 transform, vec2 uv) {
+    vec2 scaled = uv * transform.xy;
+    vec2 dx = dFdx(scaled);
+    vec2 dy = dFdy(scaled);
+    // whole layers wrap with GL_REPEAT
+    if (transform.xy == vec2(1.0)) {
+        return textureGrad(array, vec3(uv, layer), dx, dy);
+    }
+
+    vec2 pageSize = vec2(textureSize(array, 0).xy);
+    float lod = ceil(log2(max(max(length(dx * pageSize), length(dy * pageSize)), 1.0)));
+    vec2 border = min(0.5 * exp2(lod) / pageSize, 0.5 * transform.xy);
+    vec2 tileUV = clamp(fract(uv) * transform.xy, border, transform.xy - border);
+    return textureGrad(array, vec3(tileUV + transform.zw, layer), dx, dy);
+}
+
+vec4 MaterialDiffuse(vec2 uv) {
+    return SampleLayer(material.diffuseArray, material.diffuseLayer, material.diffuseTransform, uv);
+}
+
+vec4 MaterialSpecular(vec2 uv) {
+    return SampleLayer(material.specularArray, material.specularLayer, material.specularTransform, uv);
+}
+#elif defined(MATERIAL_BINDLESS)
+// GL_ARB_bindless_texture is enabled in the define prelude, #extension has to precede all declarations
+struct Material {
+    float shininess;
+};
+
+uniform Material material;
+
+// diffuse handle in xy, specular handle in zw, see material.c
+layout (std140) uniform Materials {
+    uvec4 materialHandles[MATERIAL_MAX];
+};
+
+uniform uint materialId;
+
+vec4 MaterialDiffuse(vec2 uv) {
+    return texture(sampler2D(materialHandles[materialId].xy), uv);
+}
+
+vec4 MaterialSpecular(vec2 uv) {
+    return texture(sampler2D(materialHandles[materialId].zw), uv);
+}
+#else
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+
+    float shininess;
+};
+
+uniform Material material;
+
+vec4 MaterialDiffuse(vec2 uv) {
+    return texture(material.texture_diffuse1, uv);
+}
+
+vec4 MaterialSpecular(vec2 uv) {
+    return texture(material.texture_specular1, uv);
+}
+#endif
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+
+size_t arenaSize(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+Arena initArena(MemoryCategory category, size_t capacity) {
+    Arena arena = {0};
+    // the tracked header is MEMORY_HEADER_SIZE bytes, so the block stays 16 byte aligned
+    arena.data = trackedMalloc(category, capacity);
+    if (!arena.data && capacity > 0) {
+        printf("Error: Could not allocate a %zu byte arena\n", capacity);
+        return arena;
+    }
+    arena.capacity = capacity;
+    return arena;
+}
+
+void* arenaAlloc(Arena* arena, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    size_t bytes = arenaSize(count * size);
+    if (bytes > arena->capacity - arena->used) {
+        printf("Error: Arena full, %zu of %zu bytes used, %zu more requested\n", arena->used, arena->capacity, bytes);
+        return NULL;
+    }
+
+    void* data = arena->data + arena->used;
+    arena->used += bytes;
+    memset(data, 0, bytes);
+    return data;
+}
+
+void freeArena(Arena* arena) {
+    trackedFree(arena->data);
+    *arena = (Arena){0};
+}
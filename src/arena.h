@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "memtrack.h"
+
+// every allocation starts on this boundary, enough for SSE loads of vec4 data
+#define ARENA_ALIGNMENT 16
+
+// one block, bump allocated and released as a whole; sized up front from a counting pass
+typedef struct arena {
+    unsigned char* data;
+    size_t capacity;
+    size_t used;
+} Arena;
+
+// bytes an allocation of size takes from the arena, for the counting pass
+size_t arenaSize(size_t size);
+Arena initArena(MemoryCategory category, size_t capacity);
+// zeroed like calloc, NULL once the arena is full
+void* arenaAlloc(Arena* arena, size_t count, size_t size);
+void freeArena(Arena* arena);
@@ -0,0 +1,426 @@
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "bc.h"
+#include "jobs.h"
+
+// 16 pixels split per channel
+typedef struct blockPixels {
+    float channel[4][16];
+} BlockPixels;
+
+size_t bcBlockSize(BCFormat format) {
+    switch (format) {
+        case BC_FORMAT_BC1:
+        case BC_FORMAT_BC4:
+            return 8;
+        case BC_FORMAT_BC3:
+        case BC_FORMAT_BC5:
+        case BC_FORMAT_BC7:
+            return 16;
+    }
+    return 16;
+}
+
+size_t bcImageSize(BCFormat format, int width, int height) {
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * bcBlockSize(format);
+}
+
+static void splitBlock(const uint8_t* rgba, BlockPixels* pixels) {
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            pixels->channel[c][i] = rgba[i * 4 + c];
+        }
+    }
+}
+
+// nearest palette entry for all 16 pixels over the first numChannels channels
+static void selectIndices(const BlockPixels* pixels, int numChannels, const float palette[][4], int numPalette, int* indices) {
+#if defined(__SSE2__)
+    for (int i = 0; i < 16; i += 4) {
+        __m128 best = _mm_set1_ps(INFINITY);
+        __m128i bestIndex = _mm_setzero_si128();
+
+        for (int k = 0; k < numPalette; k++) {
+            __m128 distance = _mm_setzero_ps();
+            for (int c = 0; c < numChannels; c++) {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(&pixels->channel[c][i]), _mm_set1_ps(palette[k][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+            }
+
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+            best = _mm_min_ps(best, distance);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+        }
+
+        _mm_storeu_si128((__m128i*)&indices[i], bestIndex);
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        float best = INFINITY;
+        indices[i] = 0;
+
+        for (int k = 0; k < numPalette; k++) {
+            float distance = 0.0f;
+            for (int c = 0; c < numChannels; c++) {
+                float d = pixels->channel[c][i] - palette[k][c];
+                distance += d * d;
+            }
+
+            if (distance < best) {
+                best = distance;
+                indices[i] = k;
+            }
+        }
+    }
+#endif
+}
+
+// endpoints along the principal axis of the block's colors
+static void fitEndpoints(const BlockPixels* pixels, int numChannels, float* low, float* high) {
+    float mean[4] = {0};
+    for (int c = 0; c < numChannels; c++) {
+        for (int i = 0; i < 16; i++) {
+            mean[c] += pixels->channel[c][i];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {{0}};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < numChannels; a++) {
+            for (int b = 0; b < numChannels; b++) {
+                covariance[a][b] += (pixels->channel[a][i] - mean[a]) * (pixels->channel[b][i] - mean[b]);
+            }
+        }
+    }
+
+    // power iteration converges quickly enough for a 4x4 block
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {0};
+        float length = 0.0f;
+        for (int a = 0; a < numChannels; a++) {
+            for (int b = 0; b < numChannels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+
+        if (length < 1e-8f) {
+            break;
+        }
+
+        length = 1.0f / sqrtf(length);
+        for (int a = 0; a < numChannels; a++) {
+            axis[a] = next[a] * length;
+        }
+    }
+
+    float tMin = INFINITY;
+    float tMax = -INFINITY;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < numChannels; c++) {
+            t += (pixels->channel[c][i] - mean[c]) * axis[c];
+        }
+        tMin = fminf(tMin, t);
+        tMax = fmaxf(tMax, t);
+    }
+
+    for (int c = 0; c < numChannels; c++) {
+        low[c] = fminf(fmaxf(mean[c] + tMin * axis[c], 0.0f), 255.0f);
+        high[c] = fminf(fmaxf(mean[c] + tMax * axis[c], 0.0f), 255.0f);
+    }
+}
+
+static uint16_t pack565(const float* color) {
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(uint16_t packed, float* color) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (float)((r << 3) | (r >> 2));
+    color[1] = (float)((g << 2) | (g >> 4));
+    color[2] = (float)((b << 3) | (b >> 2));
+    color[3] = 255.0f;
+}
+
+static void encodeColorBlock(const BlockPixels* pixels, uint8_t* out) {
+    float low[4];
+    float high[4];
+    fitEndpoints(pixels, 3, low, high);
+
+    uint16_t color0 = pack565(high);
+    uint16_t color1 = pack565(low);
+
+    // color0 > color1 selects the four color mode
+    if (color0 < color1) {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    uint32_t bits = 0;
+    if (color0 != color1) {
+        float palette[4][4];
+        unpack565(color0, palette[0]);
+        unpack565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        int indices[16];
+        selectIndices(pixels, 3, (const float (*)[4])palette, 4, indices);
+        for (int i = 0; i < 16; i++) {
+            bits |= (uint32_t)indices[i] << (i * 2);
+        }
+    }
+
+    out[0] = color0 & 0xff;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xff;
+    out[3] = color1 >> 8;
+    out[4] = bits & 0xff;
+    out[5] = (bits >> 8) & 0xff;
+    out[6] = (bits >> 16) & 0xff;
+    out[7] = bits >> 24;
+}
+
+// single channel block with eight interpolated values, also used for BC3 alpha and BC5
+static void encodeChannelBlock(const BlockPixels* pixels, int channel, uint8_t* out) {
+    float min = 255.0f;
+    float max = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        min = fminf(min, pixels->channel[channel][i]);
+        max = fmaxf(max, pixels->channel[channel][i]);
+    }
+
+    uint8_t a0 = (uint8_t)(max + 0.5f);
+    uint8_t a1 = (uint8_t)(min + 0.5f);
+    memset(out, 0, 8);
+    out[0] = a0;
+    out[1] = a1;
+
+    if (a0 == a1) {
+        return;
+    }
+
+    float palette[8][4] = {{0}};
+    palette[0][0] = a0;
+    palette[1][0] = a1;
+    for (int k = 1; k < 7; k++) {
+        palette[k + 1][0] = ((7 - k) * a0 + k * a1) / 7.0f;
+    }
+
+    BlockPixels single;
+    memcpy(single.channel[0], pixels->channel[channel], sizeof(single.channel[0]));
+
+    int indices[16];
+    selectIndices(&single, 1, (const float (*)[4])palette, 8, indices);
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        bits |= (uint64_t)indices[i] << (i * 3);
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (bits >> (i * 8)) & 0xff;
+    }
+}
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out) {
+    BlockPixels pixels;
+    splitBlock(rgba, &pixels);
+    encodeColorBlock(&pixels, out);
+}
+
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out) {
+    BlockPixels pixels;
+    splitBlock(rgba, &pixels);
+    encodeChannelBlock(&pixels, 3, out);
+    encodeColorBlock(&pixels, out + 8);
+}
+
+void encodeBC4Block(const uint8_t* rgba, uint8_t* out) {
+    BlockPixels pixels;
+    splitBlock(rgba, &pixels);
+    encodeChannelBlock(&pixels, 0, out);
+}
+
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out) {
+    BlockPixels pixels;
+    splitBlock(rgba, &pixels);
+    encodeChannelBlock(&pixels, 0, out);
+    encodeChannelBlock(&pixels, 1, out + 8);
+}
+
+typedef struct bitWriter {
+    uint64_t bits[2];
+    int position;
+} BitWriter;
+
+static void writeBits(BitWriter* writer, uint32_t value, int count) {
+    for (int i = 0; i < count; i++, writer->position++) {
+        if (value & (1u << i)) {
+            writer->bits[writer->position >> 6] |= 1ull << (writer->position & 63);
+        }
+    }
+}
+
+// 7 bit endpoint plus the p bit shared by all four channels, picks the p bit with less error
+static void quantizeBC7Endpoint(const float* color, uint8_t* quantized, int* pBit) {
+    float bestError = INFINITY;
+    for (int p = 0; p < 2; p++) {
+        float error = 0.0f;
+        uint8_t candidate[4];
+        for (int c = 0; c < 4; c++) {
+            int q = (int)((color[c] - p) / 2.0f + 0.5f);
+            if (q < 0) q = 0;
+            if (q > 127) q = 127;
+            candidate[c] = (uint8_t)q;
+            float d = (float)((q << 1) | p) - color[c];
+            error += d * d;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            *pBit = p;
+            memcpy(quantized, candidate, 4);
+        }
+    }
+}
+
+// mode 6 only: one subset, RGBA endpoints with p bits and 4 bit indices
+void encodeBC7Block(const uint8_t* rgba, uint8_t* out) {
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    BlockPixels pixels;
+    splitBlock(rgba, &pixels);
+
+    float low[4];
+    float high[4];
+    fitEndpoints(&pixels, 4, low, high);
+
+    uint8_t e0[4];
+    uint8_t e1[4];
+    int p0 = 0;
+    int p1 = 0;
+    quantizeBC7Endpoint(low, e0, &p0);
+    quantizeBC7Endpoint(high, e1, &p1);
+
+    float palette[16][4];
+    for (int k = 0; k < 16; k++) {
+        for (int c = 0; c < 4; c++) {
+            int v0 = (e0[c] << 1) | p0;
+            int v1 = (e1[c] << 1) | p1;
+            palette[k][c] = (float)(((64 - weights[k]) * v0 + weights[k] * v1 + 32) >> 6);
+        }
+    }
+
+    int indices[16];
+    selectIndices(&pixels, 4, (const float (*)[4])palette, 16, indices);
+
+    // the anchor index is stored with 3 bits, so its top bit has to be zero
+    if (indices[0] & 8) {
+        uint8_t swap[4];
+        memcpy(swap, e0, 4);
+        memcpy(e0, e1, 4);
+        memcpy(e1, swap, 4);
+
+        int swapP = p0;
+        p0 = p1;
+        p1 = swapP;
+
+        for (int i = 0; i < 16; i++) {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    BitWriter writer = {0};
+    writeBits(&writer, 1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writeBits(&writer, e0[c], 7);
+        writeBits(&writer, e1[c], 7);
+    }
+    writeBits(&writer, p0, 1);
+    writeBits(&writer, p1, 1);
+    writeBits(&writer, indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        writeBits(&writer, indices[i], 4);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        out[i] = (writer.bits[i >> 3] >> ((i & 7) * 8)) & 0xff;
+    }
+}
+
+// encodes block rows [firstBlockRow, firstBlockRow + numBlockRows) of an RGBA8 image,
+// out points at the start of the whole compressed image
+void encodeBCRows(BCFormat format, const uint8_t* rgba, int width, int height, int firstBlockRow, int numBlockRows, uint8_t* out) {
+    int blocksX = (width + 3) / 4;
+    size_t blockSize = bcBlockSize(format);
+
+    for (int by = firstBlockRow; by < firstBlockRow + numBlockRows; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            // edge blocks repeat the last row and column
+            uint8_t block[64];
+            for (int y = 0; y < 4; y++) {
+                int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+                for (int x = 0; x < 4; x++) {
+                    int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                    memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                }
+            }
+
+            uint8_t* target = out + ((size_t)by * blocksX + bx) * blockSize;
+            switch (format) {
+                case BC_FORMAT_BC1:
+                    encodeBC1Block(block, target);
+                    break;
+                case BC_FORMAT_BC3:
+                    encodeBC3Block(block, target);
+                    break;
+                case BC_FORMAT_BC4:
+                    encodeBC4Block(block, target);
+                    break;
+                case BC_FORMAT_BC5:
+                    encodeBC5Block(block, target);
+                    break;
+                case BC_FORMAT_BC7:
+                    encodeBC7Block(block, target);
+                    break;
+            }
+        }
+    }
+}
+
+typedef struct bcJob {
+    BCFormat format;
+    const uint8_t* rgba;
+    int width;
+    int height;
+    uint8_t* out;
+} BCJob;
+
+static void encodeRowRange(void* data, int begin, int end) {
+    const BCJob* job = data;
+    encodeBCRows(job->format, job->rgba, job->width, job->height, begin, end - begin, job->out);
+}
+
+void encodeBCImage(BCFormat format, const uint8_t* rgba, int width, int height, uint8_t* out) {
+    // every block row writes its own part of out
+    BCJob job = {format, rgba, width, height, out};
+    parallelFor((height + 3) / 4, BC_ROWS_PER_JOB, encodeRowRange, &job);
+}
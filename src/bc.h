@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// block rows per parallelFor job, one row of a 4096 wide BC7 image is already 1024 blocks
+#define BC_ROWS_PER_JOB 2
+
+// block compression encoders, all take 4x4 blocks of RGBA8 pixels
+typedef enum bcFormat {
+    BC_FORMAT_BC1,
+    BC_FORMAT_BC3,
+    BC_FORMAT_BC4,
+    BC_FORMAT_BC5,
+    BC_FORMAT_BC7,
+} BCFormat;
+
+size_t bcBlockSize(BCFormat format);
+size_t bcImageSize(BCFormat format, int width, int height);
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC4Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC7Block(const uint8_t* rgba, uint8_t* out);
+
+void encodeBCRows(BCFormat format, const uint8_t* rgba, int width, int height, int firstBlockRow, int numBlockRows, uint8_t* out);
+// block rows spread over the job system
+void encodeBCImage(BCFormat format, const uint8_t* rgba, int width, int height, uint8_t* out);
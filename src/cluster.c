@@ -0,0 +1,409 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cluster.h"
+#include "memtrack.h"
+#include "jobs.h"
+
+// keeps infinite ranges from turning into NaNs in the tile math
+#define CLUSTER_RANGE_LIMIT 1.0e6f
+
+static void createBufferTexture(unsigned int* buffer, unsigned int* texture, GLenum format) {
+    glGenBuffers(1, buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, *buffer, MEMORY_RENDER_GPU, 16);
+
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_BUFFER, *texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+ClusterGrid initClusterGrid(float near, float far) {
+    ClusterGrid grid = {0};
+    grid.near = near;
+    grid.far = far;
+
+    grid.boundsMin = calloc(CLUSTER_COUNT, sizeof(vec3));
+    grid.boundsMax = calloc(CLUSTER_COUNT, sizeof(vec3));
+
+    grid.lightData = calloc(CLUSTER_MAX_LIGHTS * 16, sizeof(float));
+    grid.viewX = calloc(CLUSTER_MAX_LIGHTS, sizeof(float));
+    grid.viewY = calloc(CLUSTER_MAX_LIGHTS, sizeof(float));
+    grid.viewZ = calloc(CLUSTER_MAX_LIGHTS, sizeof(float));
+    grid.range = calloc(CLUSTER_MAX_LIGHTS, sizeof(float));
+    grid.extents = calloc(CLUSTER_MAX_LIGHTS * 6, sizeof(int));
+
+    grid.grid = calloc(CLUSTER_COUNT * 2, sizeof(uint32_t));
+    grid.indices = calloc(CLUSTER_Z * CLUSTER_SLICE_MAX_INDICES, sizeof(uint32_t));
+    grid.pairs = calloc(CLUSTER_Z * CLUSTER_SLICE_MAX_INDICES * 2, sizeof(uint32_t));
+
+    createBufferTexture(&grid.lightBuffer, &grid.lightTexture, GL_RGBA32F);
+    createBufferTexture(&grid.gridBuffer, &grid.gridTexture, GL_RG32UI);
+    createBufferTexture(&grid.indexBuffer, &grid.indexTexture, GL_R32UI);
+
+    return grid;
+}
+
+static float sliceDepth(const ClusterGrid* grid, int slice) {
+    return grid->near * powf(grid->far / grid->near, (float)slice / CLUSTER_Z);
+}
+
+static int depthSlice(const ClusterGrid* grid, float depth) {
+    int slice = (int)floorf(logf(depth / grid->near) / logf(grid->far / grid->near) * CLUSTER_Z);
+    if (slice < 0) return 0;
+    if (slice >= CLUSTER_Z) return CLUSTER_Z - 1;
+    return slice;
+}
+
+static int ndcTile(float ndc, int tiles) {
+    int tile = (int)floorf((ndc * 0.5f + 0.5f) * tiles);
+    if (tile < 0) return 0;
+    if (tile >= tiles) return tiles - 1;
+    return tile;
+}
+
+static void buildClusterBounds(ClusterGrid* grid) {
+    for (int z = 0; z < CLUSTER_Z; z++) {
+        float d0 = sliceDepth(grid, z);
+        float d1 = sliceDepth(grid, z + 1);
+
+        for (int y = 0; y < CLUSTER_Y; y++) {
+            float ny0 = -1.0f + 2.0f * y / CLUSTER_Y;
+            float ny1 = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+
+            for (int x = 0; x < CLUSTER_X; x++) {
+                float nx0 = -1.0f + 2.0f * x / CLUSTER_X;
+                float nx1 = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+
+                int index = x + CLUSTER_X * (y + CLUSTER_Y * z);
+                float* lo = grid->boundsMin[index];
+                float* hi = grid->boundsMax[index];
+
+                lo[0] = fminf(nx0 * d0, nx0 * d1) / grid->projX;
+                hi[0] = fmaxf(nx1 * d0, nx1 * d1) / grid->projX;
+                lo[1] = fminf(ny0 * d0, ny0 * d1) / grid->projY;
+                hi[1] = fmaxf(ny1 * d0, ny1 * d1) / grid->projY;
+                lo[2] = -d1;
+                hi[2] = -d0;
+            }
+        }
+    }
+}
+
+static void packLightData(ClusterGrid* grid, const PointLight* lights, unsigned int numLights) {
+    for (unsigned int i = 0; i < numLights; i++) {
+        const PointLight* light = &lights[i];
+        float* texel = &grid->lightData[i * 16];
+
+        float range = lightRange(light);
+        if (range > CLUSTER_RANGE_LIMIT) range = CLUSTER_RANGE_LIMIT;
+        grid->range[i] = range;
+
+        memcpy(&texel[0], light->position, sizeof(vec3));
+        texel[3] = range;
+        memcpy(&texel[4], light->ambient, sizeof(vec3));
+        texel[7] = light->constant;
+        memcpy(&texel[8], light->diffuse, sizeof(vec3));
+        texel[11] = light->linear;
+        memcpy(&texel[12], light->specular, sizeof(vec3));
+        texel[15] = light->quadratic;
+    }
+}
+
+// view space transform of the light centers, four lights per iteration
+static void transformLights(ClusterGrid* grid, unsigned int numLights, mat4x4 view) {
+    unsigned int i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= numLights; i += 4) {
+        const float* t0 = &grid->lightData[(i + 0) * 16];
+        const float* t1 = &grid->lightData[(i + 1) * 16];
+        const float* t2 = &grid->lightData[(i + 2) * 16];
+        const float* t3 = &grid->lightData[(i + 3) * 16];
+
+        __m128 x = _mm_setr_ps(t0[0], t1[0], t2[0], t3[0]);
+        __m128 y = _mm_setr_ps(t0[1], t1[1], t2[1], t3[1]);
+        __m128 z = _mm_setr_ps(t0[2], t1[2], t2[2], t3[2]);
+
+        for (int row = 0; row < 3; row++) {
+            __m128 r = _mm_set1_ps(view[3][row]);
+            r = _mm_add_ps(r, _mm_mul_ps(x, _mm_set1_ps(view[0][row])));
+            r = _mm_add_ps(r, _mm_mul_ps(y, _mm_set1_ps(view[1][row])));
+            r = _mm_add_ps(r, _mm_mul_ps(z, _mm_set1_ps(view[2][row])));
+
+            float* out = row == 0 ? grid->viewX : (row == 1 ? grid->viewY : grid->viewZ);
+            _mm_storeu_ps(&out[i], r);
+        }
+    }
+#endif
+
+    for (; i < numLights; i++) {
+        const float* p = &grid->lightData[i * 16];
+        grid->viewX[i] = view[0][0] * p[0] + view[1][0] * p[1] + view[2][0] * p[2] + view[3][0];
+        grid->viewY[i] = view[0][1] * p[0] + view[1][1] * p[1] + view[2][1] * p[2] + view[3][1];
+        grid->viewZ[i] = view[0][2] * p[0] + view[1][2] * p[1] + view[2][2] * p[2] + view[3][2];
+    }
+}
+
+// screen tiles covered by a light sphere clipped to the depth range [dmin, dmax]
+static int sphereTiles(const ClusterGrid* grid, unsigned int i, float dmin, float dmax, int* tiles) {
+    float r = grid->range[i];
+
+    // the projected extent is widest at whichever depth pulls the edge outward
+    float xlo = grid->viewX[i] - r;
+    float xhi = grid->viewX[i] + r;
+    float ylo = grid->viewY[i] - r;
+    float yhi = grid->viewY[i] + r;
+
+    float nx0 = xlo * grid->projX / (xlo < 0.0f ? dmin : dmax);
+    float nx1 = xhi * grid->projX / (xhi > 0.0f ? dmin : dmax);
+    float ny0 = ylo * grid->projY / (ylo < 0.0f ? dmin : dmax);
+    float ny1 = yhi * grid->projY / (yhi > 0.0f ? dmin : dmax);
+
+    if (nx1 < -1.0f || nx0 > 1.0f || ny1 < -1.0f || ny0 > 1.0f) {
+        return 0;
+    }
+
+    tiles[0] = ndcTile(nx0, CLUSTER_X);
+    tiles[1] = ndcTile(nx1, CLUSTER_X);
+    tiles[2] = ndcTile(ny0, CLUSTER_Y);
+    tiles[3] = ndcTile(ny1, CLUSTER_Y);
+    return 1;
+}
+
+// conservative cluster box of every light sphere; z0 > z1 marks a culled light
+static void computeLightExtents(ClusterGrid* grid, unsigned int numLights) {
+    for (unsigned int i = 0; i < numLights; i++) {
+        int* e = &grid->extents[i * 6];
+        float r = grid->range[i];
+        float depth = -grid->viewZ[i];
+        float dmin = depth - r;
+        float dmax = depth + r;
+
+        e[4] = 1;
+        e[5] = 0;
+        if (r <= 0.0f || dmax < grid->near || dmin > grid->far) {
+            continue;
+        }
+
+        if (dmin < grid->near) dmin = grid->near;
+        if (dmax > grid->far) dmax = grid->far;
+
+        if (!sphereTiles(grid, i, dmin, dmax, e)) {
+            continue;
+        }
+
+        e[4] = depthSlice(grid, dmin);
+        e[5] = depthSlice(grid, dmax);
+    }
+}
+
+static int sphereTouchesCluster(const ClusterGrid* grid, int cluster, float x, float y, float z, float r) {
+    const float* lo = grid->boundsMin[cluster];
+    const float* hi = grid->boundsMax[cluster];
+
+    float dx = x < lo[0] ? lo[0] - x : (x > hi[0] ? x - hi[0] : 0.0f);
+    float dy = y < lo[1] ? lo[1] - y : (y > hi[1] ? y - hi[1] : 0.0f);
+    float dz = z < lo[2] ? lo[2] - z : (z > hi[2] ? z - hi[2] : 0.0f);
+
+    return dx * dx + dy * dy + dz * dz <= r * r;
+}
+
+// bins every light of one depth slice into that slice's part of the index list
+static void binSlice(ClusterGrid* grid, int z, unsigned int numLights) {
+    uint32_t* cells = &grid->grid[z * CLUSTER_X * CLUSTER_Y * 2];
+    uint32_t* indices = &grid->indices[z * CLUSTER_SLICE_MAX_INDICES];
+    uint32_t* pairs = &grid->pairs[z * CLUSTER_SLICE_MAX_INDICES * 2];
+    uint32_t numPairs = 0;
+    uint32_t numDropped = 0;
+    memset(cells, 0, CLUSTER_X * CLUSTER_Y * 2 * sizeof(uint32_t));
+
+    float d0 = sliceDepth(grid, z);
+    float d1 = sliceDepth(grid, z + 1);
+
+    for (unsigned int i = 0; i < numLights; i++) {
+        const int* e = &grid->extents[i * 6];
+        if (z < e[4] || z > e[5]) continue;
+
+        // tiles touched within this slice only, much tighter than the whole sphere's
+        int tiles[4];
+        float depth = -grid->viewZ[i];
+        float dmin = fmaxf(depth - grid->range[i], d0);
+        float dmax = fminf(depth + grid->range[i], d1);
+        if (!sphereTiles(grid, i, dmin, dmax, tiles)) continue;
+
+        for (int y = tiles[2]; y <= tiles[3]; y++) {
+            for (int x = tiles[0]; x <= tiles[1]; x++) {
+                int local = x + CLUSTER_X * y;
+                int cluster = local + CLUSTER_X * CLUSTER_Y * z;
+                if (!sphereTouchesCluster(grid, cluster, grid->viewX[i], grid->viewY[i], grid->viewZ[i], grid->range[i])) {
+                    continue;
+                }
+
+                if (numPairs == CLUSTER_SLICE_MAX_INDICES) {
+                    numDropped++;
+                    continue;
+                }
+
+                pairs[numPairs * 2] = local;
+                pairs[numPairs * 2 + 1] = i;
+                numPairs++;
+                cells[local * 2 + 1]++;
+            }
+        }
+    }
+
+    // counting sort of the (cluster, light) pairs, keeps lights in ascending order per cluster
+    uint32_t offset = 0;
+    for (int local = 0; local < CLUSTER_X * CLUSTER_Y; local++) {
+        cells[local * 2] = offset;
+        offset += cells[local * 2 + 1];
+        cells[local * 2 + 1] = 0;
+    }
+
+    for (uint32_t p = 0; p < numPairs; p++) {
+        uint32_t* cell = &cells[pairs[p * 2] * 2];
+        indices[cell[0] + cell[1]] = pairs[p * 2 + 1];
+        cell[1]++;
+    }
+
+    grid->sliceCounts[z] = numPairs;
+    grid->sliceDropped[z] = numDropped;
+}
+
+typedef struct binJob {
+    ClusterGrid* grid;
+    unsigned int numLights;
+} BinJob;
+
+static void binSlices(void* data, int begin, int end) {
+    BinJob* job = data;
+    for (int z = begin; z < end; z++) {
+        binSlice(job->grid, z, job->numLights);
+    }
+}
+
+void updateClusterGrid(ClusterGrid* grid, const PointLight* lights, unsigned int numLights, mat4x4 view, mat4x4 projection) {
+    if (numLights > CLUSTER_MAX_LIGHTS) {
+        numLights = CLUSTER_MAX_LIGHTS;
+    }
+
+    if (grid->projX != projection[0][0] || grid->projY != projection[1][1]) {
+        grid->projX = projection[0][0];
+        grid->projY = projection[1][1];
+        buildClusterBounds(grid);
+    }
+
+    grid->numLights = numLights;
+
+    packLightData(grid, lights, numLights);
+    transformLights(grid, numLights, view);
+    computeLightExtents(grid, numLights);
+
+    // slices write only their own cells, index range and counters
+    BinJob job = {grid, numLights};
+    parallelFor(CLUSTER_Z, 1, binSlices, &job);
+
+    // compact the per slice index lists into one contiguous list
+    uint32_t base = 0;
+    grid->numDropped = 0;
+    for (uint32_t z = 0; z < CLUSTER_Z; z++) {
+        uint32_t count = grid->sliceCounts[z];
+        grid->numDropped += grid->sliceDropped[z];
+        if (base != z * CLUSTER_SLICE_MAX_INDICES) {
+            memmove(&grid->indices[base], &grid->indices[z * CLUSTER_SLICE_MAX_INDICES], count * sizeof(uint32_t));
+        }
+
+        uint32_t* cells = &grid->grid[z * CLUSTER_X * CLUSTER_Y * 2];
+        for (int local = 0; local < CLUSTER_X * CLUSTER_Y; local++) {
+            cells[local * 2] += base;
+        }
+        base += count;
+    }
+    grid->numIndices = base;
+
+    grid->reportDropped += grid->numDropped;
+    grid->reportDroppedFrames += grid->numDropped > 0;
+
+    size_t lightBytes = (numLights > 0 ? numLights : 1) * 16 * sizeof(float);
+    glBindBuffer(GL_TEXTURE_BUFFER, grid->lightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, lightBytes, grid->lightData, GL_STREAM_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, grid->lightBuffer, MEMORY_RENDER_GPU, lightBytes);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, grid->gridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * 2 * sizeof(uint32_t), grid->grid, GL_STREAM_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, grid->gridBuffer, MEMORY_RENDER_GPU, CLUSTER_COUNT * 2 * sizeof(uint32_t));
+
+    size_t indexBytes = (base > 0 ? base : 1) * sizeof(uint32_t);
+    glBindBuffer(GL_TEXTURE_BUFFER, grid->indexBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, indexBytes, grid->indices, GL_STREAM_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, grid->indexBuffer, MEMORY_RENDER_GPU, indexBytes);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void reportClusterGrid(ClusterGrid* grid) {
+    if (grid->reportDropped > 0) {
+        printf("Cluster index list full in %u frames, dropped %llu light references\n", grid->reportDroppedFrames,
+               grid->reportDropped);
+    }
+    grid->reportDropped = 0;
+    grid->reportDroppedFrames = 0;
+}
+
+void bindClusterGrid(ClusterGrid* grid, unsigned int shader, int width, int height) {
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, grid->lightTexture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, grid->gridTexture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, grid->indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(shader, "cluster.lights"), CLUSTER_TEXTURE_UNIT);
+    glUniform1i(glGetUniformLocation(shader, "cluster.grid"), CLUSTER_TEXTURE_UNIT + 1);
+    glUniform1i(glGetUniformLocation(shader, "cluster.indices"), CLUSTER_TEXTURE_UNIT + 2);
+
+    float sliceScale = CLUSTER_Z / logf(grid->far / grid->near);
+    glUniform3i(glGetUniformLocation(shader, "cluster.dims"), CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+    glUniform2f(glGetUniformLocation(shader, "cluster.screenSize"), (float)width, (float)height);
+    glUniform1f(glGetUniformLocation(shader, "cluster.near"), grid->near);
+    glUniform1f(glGetUniformLocation(shader, "cluster.far"), grid->far);
+    glUniform1f(glGetUniformLocation(shader, "cluster.sliceScale"), sliceScale);
+    glUniform1f(glGetUniformLocation(shader, "cluster.sliceBias"), -logf(grid->near) * sliceScale);
+}
+
+void freeClusterGrid(ClusterGrid* grid) {
+    glDeleteTextures(1, &grid->lightTexture);
+    glDeleteTextures(1, &grid->gridTexture);
+    glDeleteTextures(1, &grid->indexTexture);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, grid->lightBuffer);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, grid->gridBuffer);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, grid->indexBuffer);
+    glDeleteBuffers(1, &grid->lightBuffer);
+    glDeleteBuffers(1, &grid->gridBuffer);
+    glDeleteBuffers(1, &grid->indexBuffer);
+
+    free(grid->boundsMin);
+    free(grid->boundsMax);
+    free(grid->lightData);
+    free(grid->viewX);
+    free(grid->viewY);
+    free(grid->viewZ);
+    free(grid->range);
+    free(grid->extents);
+    free(grid->grid);
+    free(grid->indices);
+    free(grid->pairs);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <linmath.h>
+
+#include "light.h"
+
+// froxel grid: screen tiles in x/y, logarithmic depth slices in z
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+
+#define CLUSTER_MAX_LIGHTS 16384
+// every depth slice owns a fixed part of the index list so slices can be binned independently
+#define CLUSTER_SLICE_MAX_INDICES 16384
+
+// cluster buffers are bound to units CLUSTER_TEXTURE_UNIT .. CLUSTER_TEXTURE_UNIT + 2
+#define CLUSTER_TEXTURE_UNIT 8
+
+typedef struct clusterGrid {
+    float near;
+    float far;
+    float projX;
+    float projY;
+
+    // view space bounds of every cluster, rebuilt when the projection changes
+    vec3 *boundsMin;
+    vec3 *boundsMax;
+
+    unsigned int numLights;
+    // 4 RGBA texels per light: position + range, ambient + constant, diffuse + linear, specular + quadratic
+    float *lightData;
+    // view space spheres and cluster ranges of every light
+    float *viewX;
+    float *viewY;
+    float *viewZ;
+    float *range;
+    int *extents;
+
+    // offset and count into indices per cluster
+    uint32_t *grid;
+    uint32_t *indices;
+    // scratch (cluster, light) pairs per slice
+    uint32_t *pairs;
+    uint32_t sliceCounts[CLUSTER_Z];
+    uint32_t sliceDropped[CLUSTER_Z];
+    uint32_t numIndices;
+    // light references that did not fit, in the last update and since the last report
+    unsigned int numDropped;
+    unsigned long long reportDropped;
+    unsigned int reportDroppedFrames;
+
+    unsigned int lightBuffer, lightTexture;
+    unsigned int gridBuffer, gridTexture;
+    unsigned int indexBuffer, indexTexture;
+} ClusterGrid;
+
+ClusterGrid initClusterGrid(float near, float far);
+void updateClusterGrid(ClusterGrid* grid, const PointLight* lights, unsigned int numLights, mat4x4 view, mat4x4 projection);
+void bindClusterGrid(ClusterGrid* grid, unsigned int shader, int width, int height);
+// dropped light references since the last report, with the renderer's periodic report
+void reportClusterGrid(ClusterGrid* grid);
+void freeClusterGrid(ClusterGrid* grid);
@@ -0,0 +1,79 @@
+#include <glad/glad.h>
+#include <stdio.h>
+
+#include "deferred.h"
+#include "memtrack.h"
+
+static unsigned int createTarget(int width, int height, GLint internalFormat, GLenum format, GLenum type, int pixelBytes) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, texture, MEMORY_RENDER_GPU, (size_t)width * height * pixelBytes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+GBuffer initGBuffer(int width, int height) {
+    GBuffer gbuffer = {0};
+    gbuffer.width = width;
+    gbuffer.height = height;
+
+    gbuffer.albedoSpec = createTarget(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4);
+    gbuffer.normal = createTarget(width, height, GL_RG16F, GL_RG, GL_HALF_FLOAT, 4);
+    // matches the usual default framebuffer format so depth can be blitted back
+    gbuffer.depth = createTarget(width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &gbuffer.FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbuffer.albedoSpec, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gbuffer.normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gbuffer.depth, 0);
+
+    GLenum attachments[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Error: G-buffer framebuffer is incomplete\n");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return gbuffer;
+}
+
+void bindGBufferTextures(GBuffer* gbuffer, unsigned int shader) {
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->albedoSpec);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_TEXTURE_UNIT + 1);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->normal);
+    glActiveTexture(GL_TEXTURE0 + GBUFFER_TEXTURE_UNIT + 2);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->depth);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform1i(glGetUniformLocation(shader, "gAlbedoSpec"), GBUFFER_TEXTURE_UNIT);
+    glUniform1i(glGetUniformLocation(shader, "gNormal"), GBUFFER_TEXTURE_UNIT + 1);
+    glUniform1i(glGetUniformLocation(shader, "gDepth"), GBUFFER_TEXTURE_UNIT + 2);
+}
+
+// copies the scene depth to the default framebuffer so forward passes can depth test against it
+void blitGBufferDepth(GBuffer* gbuffer) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer->FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, gbuffer->width, gbuffer->height, 0, 0, gbuffer->width, gbuffer->height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void freeGBuffer(GBuffer* gbuffer) {
+    glDeleteFramebuffers(1, &gbuffer->FBO);
+    untrackGpuObject(MEMORY_OBJECT_TEXTURE, gbuffer->albedoSpec);
+    untrackGpuObject(MEMORY_OBJECT_TEXTURE, gbuffer->normal);
+    untrackGpuObject(MEMORY_OBJECT_TEXTURE, gbuffer->depth);
+    glDeleteTextures(1, &gbuffer->albedoSpec);
+    glDeleteTextures(1, &gbuffer->normal);
+    glDeleteTextures(1, &gbuffer->depth);
+}
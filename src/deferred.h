@@ -0,0 +1,20 @@
+#pragma once
+
+// geometry buffer for the deferred path:
+// albedo rgb + specular intensity, octahedral packed normal, and depth
+typedef struct gBuffer {
+    unsigned int FBO;
+    unsigned int albedoSpec;
+    unsigned int normal;
+    unsigned int depth;
+    int width;
+    int height;
+} GBuffer;
+
+// first texture unit the lighting pass reads the geometry buffer from
+#define GBUFFER_TEXTURE_UNIT 0
+
+GBuffer initGBuffer(int width, int height);
+void bindGBufferTextures(GBuffer* gbuffer, unsigned int shader);
+void blitGBufferDepth(GBuffer* gbuffer);
+void freeGBuffer(GBuffer* gbuffer);
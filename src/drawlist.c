@@ -0,0 +1,236 @@
+#include <glad/glad.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "drawlist.h"
+#include "texpack.h"
+#include "material.h"
+
+typedef struct recordContext {
+    DrawList* list;
+    Model* model;
+    mat4x4 modelView;
+    mat4x4 modelViewProjection;
+} RecordContext;
+
+// first map of the type, the shaders sample no more than that
+static const Texture* firstTexture(const Mesh* mesh, const char* type) {
+    for (unsigned int i = 0; i < mesh->numTextures; i++) {
+        if (strcmp(type, mesh->textures[i].type) == 0) {
+            return &mesh->textures[i];
+        }
+    }
+    return NULL;
+}
+
+static DrawMaterial resolveMaterial(const Mesh* mesh) {
+    DrawMaterial material = {0};
+    material.materialId = mesh->materialId;
+
+    const Texture* textures[2] = {firstTexture(mesh, "texture_diffuse"), firstTexture(mesh, "texture_specular")};
+    for (int i = 0; i < 2; i++) {
+        // lazy materials only run with plain texture binds
+        if (!mesh->materialLoaded) {
+            material.textures[i] = fallbackMaterialTexture(i);
+        } else if (textures[i]) {
+            material.textures[i] = textures[i]->id;
+            material.layers[i] = (float)textures[i]->layer;
+            vec4_dup(material.transforms[i], textures[i]->uvTransform);
+        }
+    }
+    return material;
+}
+
+// positive floats order like their bit patterns, the top 24 bits are plenty for sorting
+static uint64_t depthKey(float depth) {
+    depth = depth > 0.0f ? depth : 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 8;
+}
+
+static void recordMeshes(void* data, int begin, int end) {
+    RecordContext* context = data;
+    DrawList* list = context->list;
+
+    int thread = jobThreadIndex();
+    thread = thread > 0 ? thread : 0;
+    DrawCommand* commands = list->threadCommands[thread];
+    unsigned int count = list->threadCounts[thread];
+    unsigned int culled = 0;
+
+    for (int i = begin; i < end; i++) {
+        Mesh* mesh = &context->model->meshes[i];
+        if (!mesh->visible) {
+            continue;
+        }
+        if (meshOutsideFrustum(mesh, context->modelViewProjection)) {
+            culled++;
+            continue;
+        }
+
+        // the GL thread loads the textures after recording, this frame still draws the fallback
+        if (!mesh->materialLoaded) {
+            mesh->materialRequested = true;
+        }
+
+        DrawMaterial* material = &list->materials[i];
+        *material = resolveMaterial(mesh);
+
+        vec4 center = {
+            (mesh->aabbMin[0] + mesh->aabbMax[0]) * 0.5f,
+            (mesh->aabbMin[1] + mesh->aabbMax[1]) * 0.5f,
+            (mesh->aabbMin[2] + mesh->aabbMax[2]) * 0.5f,
+            1.0f,
+        };
+        vec4 viewCenter;
+        mat4x4_mul_vec4(viewCenter, context->modelView, center);
+
+        // bindless draws bind nothing, only depth matters
+        uint64_t state = 0;
+        if (list->mode != DRAW_MATERIAL_BINDLESS) {
+            state = (uint64_t)(material->textures[0] & 0xfff) << 12 | (material->textures[1] & 0xfff);
+        }
+
+        commands[count++] = (DrawCommand){
+            .key = state << 40 | depthKey(-viewCenter[2]) << 16 | ((unsigned int)i & 0xffff),
+            .vertexArray = mesh->VAO,
+            .numIndices = (unsigned int)mesh->numIndices,
+            .material = (unsigned int)i,
+        };
+    }
+
+    list->threadCounts[thread] = count;
+    atomic_fetch_add_explicit(&list->numFrustumCulled, culled, memory_order_relaxed);
+}
+
+static int compareCommands(const void* a, const void* b) {
+    uint64_t keyA = ((const DrawCommand*)a)->key;
+    uint64_t keyB = ((const DrawCommand*)b)->key;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+static void reserveDrawList(DrawList* list, unsigned int numMeshes) {
+    int numThreads = jobWorkerCount() + 1;
+    if (numMeshes <= list->capacity && numThreads == list->numThreads) {
+        return;
+    }
+
+    // every thread may end up recording every mesh
+    for (int i = 0; i < DRAW_LIST_MAX_THREADS; i++) {
+        free(list->threadCommands[i]);
+        list->threadCommands[i] = i < numThreads ? malloc(numMeshes * sizeof(DrawCommand)) : NULL;
+    }
+    list->numThreads = numThreads;
+    free(list->commands);
+    free(list->materials);
+    list->commands = malloc(numMeshes * sizeof(DrawCommand));
+    list->materials = malloc(numMeshes * sizeof(DrawMaterial));
+    list->capacity = numMeshes;
+}
+
+void recordDrawList(DrawList* list, Model* model, mat4x4 modelView, mat4x4 projection) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    reserveDrawList(list, model->numMeshes);
+    if (bindlessMaterialsActive()) {
+        list->mode = DRAW_MATERIAL_BINDLESS;
+    } else {
+        list->mode = texturePackingActive() ? DRAW_MATERIAL_PACKED : DRAW_MATERIAL_TEXTURES;
+    }
+    memset(list->threadCounts, 0, sizeof(list->threadCounts));
+    atomic_store(&list->numFrustumCulled, 0);
+
+    RecordContext context = {.list = list, .model = model};
+    mat4x4_dup(context.modelView, modelView);
+    mat4x4_mul(context.modelViewProjection, projection, modelView);
+    parallelFor(model->numMeshes, DRAW_LIST_GRAIN, recordMeshes, &context);
+
+    list->numCommands = 0;
+    for (int i = 0; i < list->numThreads; i++) {
+        memcpy(&list->commands[list->numCommands], list->threadCommands[i], list->threadCounts[i] * sizeof(DrawCommand));
+        list->numCommands += list->threadCounts[i];
+    }
+    qsort(list->commands, list->numCommands, sizeof(DrawCommand), compareCommands);
+
+    list->recordMs = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void submitDrawList(const DrawList* list, unsigned int shader) {
+    GLenum target = list->mode == DRAW_MATERIAL_PACKED ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    int layerLocations[2] = {-1, -1};
+    int transformLocations[2] = {-1, -1};
+    int materialIdLocation = -1;
+
+    // uniform lookups once per list instead of once per draw
+    switch (list->mode) {
+        case DRAW_MATERIAL_TEXTURES:
+            glUniform1i(glGetUniformLocation(shader, "material.texture_diffuse1"), 0);
+            glUniform1i(glGetUniformLocation(shader, "material.texture_specular1"), 1);
+            break;
+        case DRAW_MATERIAL_PACKED:
+            glUniform1i(glGetUniformLocation(shader, "material.diffuseArray"), 0);
+            glUniform1i(glGetUniformLocation(shader, "material.specularArray"), 1);
+            layerLocations[0] = glGetUniformLocation(shader, "material.diffuseLayer");
+            layerLocations[1] = glGetUniformLocation(shader, "material.specularLayer");
+            transformLocations[0] = glGetUniformLocation(shader, "material.diffuseTransform");
+            transformLocations[1] = glGetUniformLocation(shader, "material.specularTransform");
+            break;
+        case DRAW_MATERIAL_BINDLESS:
+            bindMaterialTable(shader);
+            materialIdLocation = glGetUniformLocation(shader, "materialId");
+            break;
+    }
+
+    unsigned int boundTextures[2] = {~0u, ~0u};
+    unsigned int boundVertexArray = 0;
+
+    for (unsigned int i = 0; i < list->numCommands; i++) {
+        const DrawCommand* command = &list->commands[i];
+        const DrawMaterial* material = &list->materials[command->material];
+
+        if (list->mode == DRAW_MATERIAL_BINDLESS) {
+            glUniform1ui(materialIdLocation, material->materialId);
+        } else {
+            for (int unit = 0; unit < 2; unit++) {
+                if (boundTextures[unit] != material->textures[unit]) {
+                    glActiveTexture(GL_TEXTURE0 + unit);
+                    glBindTexture(target, material->textures[unit]);
+                    boundTextures[unit] = material->textures[unit];
+                }
+                if (list->mode == DRAW_MATERIAL_PACKED) {
+                    glUniform1f(layerLocations[unit], material->layers[unit]);
+                    glUniform4fv(transformLocations[unit], 1, material->transforms[unit]);
+                }
+            }
+        }
+
+        if (boundVertexArray != command->vertexArray) {
+            glBindVertexArray(command->vertexArray);
+            boundVertexArray = command->vertexArray;
+        }
+        glDrawElements(GL_TRIANGLES, command->numIndices, GL_UNSIGNED_INT, 0);
+    }
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// geometry only, for passes that do not sample material textures
+void submitDrawListDepth(const DrawList* list) {
+    for (unsigned int i = 0; i < list->numCommands; i++) {
+        glBindVertexArray(list->commands[i].vertexArray);
+        glDrawElements(GL_TRIANGLES, list->commands[i].numIndices, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+void freeDrawList(DrawList* list) {
+    for (int i = 0; i < DRAW_LIST_MAX_THREADS; i++) {
+        free(list->threadCommands[i]);
+    }
+    free(list->commands);
+    free(list->materials);
+    *list = (DrawList){0};
+}
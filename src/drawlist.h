@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <linmath.h>
+
+#include "model.h"
+#include "jobs.h"
+
+// meshes per recording job
+#define DRAW_LIST_GRAIN 16
+#define DRAW_LIST_MAX_THREADS (JOB_MAX_WORKERS + 1)
+
+// how materials reach the shader, fixed when the list is recorded
+typedef enum drawMaterialMode {
+    DRAW_MATERIAL_TEXTURES,
+    DRAW_MATERIAL_PACKED,
+    DRAW_MATERIAL_BINDLESS,
+} DrawMaterialMode;
+
+// resolved once per mesh while recording, the GL thread only reads it
+typedef struct drawMaterial {
+    // diffuse and specular, 2D textures or array textures when packed
+    unsigned int textures[2];
+    float layers[2];
+    vec4 transforms[2];
+    unsigned int materialId;
+} DrawMaterial;
+
+// state changes sort first, then front to back
+typedef struct drawCommand {
+    uint64_t key;
+    unsigned int vertexArray;
+    unsigned int numIndices;
+    // index into DrawList.materials
+    unsigned int material;
+} DrawCommand;
+
+typedef struct drawList {
+    DrawMaterialMode mode;
+    unsigned int capacity;
+    int numThreads;
+
+    // filled by the recording threads, then merged into commands
+    DrawCommand* threadCommands[DRAW_LIST_MAX_THREADS];
+    unsigned int threadCounts[DRAW_LIST_MAX_THREADS];
+
+    DrawCommand* commands;
+    unsigned int numCommands;
+    DrawMaterial* materials;
+
+    atomic_uint numFrustumCulled;
+    double recordMs;
+} DrawList;
+
+// culls, resolves materials and builds sorted commands on the job system, no GL calls
+void recordDrawList(DrawList* list, Model* model, mat4x4 modelView, mat4x4 projection);
+// replays the commands, call on the GL thread
+void submitDrawList(const DrawList* list, unsigned int shader);
+void submitDrawListDepth(const DrawList* list);
+void freeDrawList(DrawList* list);
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "framepacing.h"
+
+static double ticksToMs(Uint64 ticks, Uint64 frequency) {
+    return (double)ticks * 1000.0 / (double)frequency;
+}
+
+FixedTimestep initFixedTimestep(int rate) {
+    FixedTimestep timestep = {0};
+    timestep.frequency = SDL_GetPerformanceFrequency();
+    timestep.stepTicks = timestep.frequency / rate;
+    timestep.last = SDL_GetPerformanceCounter();
+    return timestep;
+}
+
+int advanceFixedTimestep(FixedTimestep* timestep) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    timestep->accumulator += now - timestep->last;
+    timestep->last = now;
+
+    Uint64 steps = timestep->accumulator / timestep->stepTicks;
+    if (steps > SIMULATION_MAX_STEPS) {
+        timestep->droppedSeconds += (double)((steps - SIMULATION_MAX_STEPS) * timestep->stepTicks) / timestep->frequency;
+        steps = SIMULATION_MAX_STEPS;
+        // keep the fraction so interpolation does not jump
+        timestep->accumulator = timestep->accumulator % timestep->stepTicks + steps * timestep->stepTicks;
+    }
+    timestep->accumulator -= steps * timestep->stepTicks;
+
+    return (int)steps;
+}
+
+double fixedTimestepSeconds(const FixedTimestep* timestep) {
+    return (double)timestep->stepTicks / (double)timestep->frequency;
+}
+
+float fixedTimestepAlpha(const FixedTimestep* timestep) {
+    return (float)((double)timestep->accumulator / (double)timestep->stepTicks);
+}
+
+FramePacer initFramePacer(int rate) {
+    FramePacer pacer = {0};
+    pacer.frequency = SDL_GetPerformanceFrequency();
+    pacer.targetTicks = rate > 0 ? pacer.frequency / rate : 0;
+    pacer.spinMargin = FRAME_PACER_SPIN_MARGIN_MS;
+    return pacer;
+}
+
+// SDL_Delay only has millisecond granularity and the scheduler may oversleep by more,
+// so it sleeps until spinMargin before the deadline and busy waits the remainder
+static void sleepUntil(FramePacer* pacer, Uint64 deadline) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now >= deadline) {
+        return;
+    }
+
+    int sleepMs = (int)(ticksToMs(deadline - now, pacer->frequency) - pacer->spinMargin);
+    if (sleepMs > 0) {
+        SDL_Delay(sleepMs);
+
+        Uint64 woke = SDL_GetPerformanceCounter();
+        double slept = ticksToMs(woke - now, pacer->frequency);
+        pacer->stats.sleepMs += slept;
+
+        // adapt to the worst oversleep quickly, forget it slowly
+        double oversleep = slept - sleepMs;
+        if (oversleep > pacer->spinMargin) {
+            pacer->spinMargin = oversleep;
+        } else {
+            pacer->spinMargin = fmax(FRAME_PACER_SPIN_MARGIN_MS, pacer->spinMargin * 0.99 + oversleep * 0.01);
+        }
+        now = woke;
+    }
+
+    Uint64 spinStart = now;
+    while (now < deadline) {
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+        now = SDL_GetPerformanceCounter();
+    }
+    pacer->stats.spinMs += ticksToMs(now - spinStart, pacer->frequency);
+}
+
+void waitFramePacer(FramePacer* pacer) {
+    if (pacer->targetTicks != 0) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (pacer->deadline == 0) {
+            pacer->deadline = now + pacer->targetTicks;
+        }
+
+        if (now > pacer->deadline) {
+            pacer->stats.numLate++;
+            // start over from here instead of rushing the following frames to catch up
+            if (now - pacer->deadline > pacer->targetTicks) {
+                pacer->deadline = now;
+            }
+        } else {
+            sleepUntil(pacer, pacer->deadline);
+        }
+        pacer->deadline += pacer->targetTicks;
+    }
+
+    Uint64 frame = SDL_GetPerformanceCounter();
+    if (pacer->lastFrame != 0) {
+        FramePacerStats* stats = &pacer->stats;
+        double interval = ticksToMs(frame - pacer->lastFrame, pacer->frequency);
+
+        if (stats->numFrames == 0) {
+            stats->min = interval;
+            stats->max = interval;
+        }
+        stats->numFrames++;
+        stats->sum += interval;
+        stats->sumSquares += interval * interval;
+        stats->min = fmin(stats->min, interval);
+        stats->max = fmax(stats->max, interval);
+
+        // uncapped frames are compared against the running mean instead of a target
+        double target = pacer->targetTicks ? ticksToMs(pacer->targetTicks, pacer->frequency) : stats->sum / stats->numFrames;
+        stats->deviation += fabs(interval - target);
+    }
+    pacer->lastFrame = frame;
+}
+
+void reportFramePacer(FramePacer* pacer) {
+    FramePacerStats* stats = &pacer->stats;
+    if (stats->numFrames == 0) {
+        return;
+    }
+
+    double mean = stats->sum / stats->numFrames;
+    double variance = fmax(0.0, stats->sumSquares / stats->numFrames - mean * mean);
+    printf("Frame pacing: %.3f ms mean, %.3f ms stddev, %.3f-%.3f ms, jitter %.3f ms, %u late, slept %.1f ms, spun %.1f ms, spin margin %.2f ms\n",
+           mean, sqrt(variance), stats->min, stats->max, stats->deviation / stats->numFrames, stats->numLate,
+           stats->sleepMs, stats->spinMs, pacer->spinMargin);
+
+    *stats = (FramePacerStats){0};
+}
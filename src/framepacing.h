@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#define SIMULATION_RATE 60
+// updates run per frame at most, the rest of a long stall is dropped instead of spiralling
+#define SIMULATION_MAX_STEPS 8
+#define FRAME_PACER_DEFAULT_RATE 60
+// sleeping stops this long before the deadline and spins the rest, grows to the worst oversleep seen
+#define FRAME_PACER_SPIN_MARGIN_MS 1.0
+#define FRAME_PACER_REPORT_INTERVAL 300
+
+typedef struct fixedTimestep {
+    Uint64 frequency;
+    Uint64 stepTicks;
+    Uint64 accumulator;
+    Uint64 last;
+    // simulation seconds lost to SIMULATION_MAX_STEPS
+    double droppedSeconds;
+} FixedTimestep;
+
+typedef struct framePacerStats {
+    unsigned int numFrames;
+    // frame to frame intervals since the last report, in milliseconds
+    double sum;
+    double sumSquares;
+    double min;
+    double max;
+    // mean absolute deviation from the target interval
+    double deviation;
+    unsigned int numLate;
+    double sleepMs;
+    double spinMs;
+} FramePacerStats;
+
+typedef struct framePacer {
+    Uint64 frequency;
+    // 0 when uncapped
+    Uint64 targetTicks;
+    Uint64 deadline;
+    Uint64 lastFrame;
+    double spinMargin;
+    FramePacerStats stats;
+} FramePacer;
+
+FixedTimestep initFixedTimestep(int rate);
+// number of simulation steps due since the last call
+int advanceFixedTimestep(FixedTimestep* timestep);
+double fixedTimestepSeconds(const FixedTimestep* timestep);
+// how far rendering is between the previous and the current simulation state
+float fixedTimestepAlpha(const FixedTimestep* timestep);
+
+// rate 0 runs uncapped and only records the statistics
+FramePacer initFramePacer(int rate);
+// waits for the next frame deadline, call once per frame after the swap
+void waitFramePacer(FramePacer* pacer);
+void reportFramePacer(FramePacer* pacer);
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <SDL2/SDL.h>
+
+#include "glext.h"
+
+GLExtensions glExt = {0};
+
+// needs a current context, call right after gladLoadGLLoader
+void loadGLExtensions(void) {
+    glExt.textureCompressionS3TC = SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc");
+    glExt.textureCompressionBPTC = SDL_GL_ExtensionSupported("GL_ARB_texture_compression_bptc");
+
+    if (SDL_GL_ExtensionSupported("GL_ARB_texture_storage")) {
+        glExt.texStorage2D = (GLTexStorage2DProc)SDL_GL_GetProcAddress("glTexStorage2D");
+        glExt.textureStorage = glExt.texStorage2D != NULL;
+    }
+
+    if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+        glExt.createBufferStorage = (GLBufferStorageProc)SDL_GL_GetProcAddress("glBufferStorage");
+        glExt.bufferStorage = glExt.createBufferStorage != NULL;
+    }
+
+    if (SDL_GL_ExtensionSupported("GL_ARB_bindless_texture")) {
+        glExt.getTextureHandle = (GLGetTextureHandleProc)SDL_GL_GetProcAddress("glGetTextureHandleARB");
+        glExt.makeTextureHandleResident = (GLTextureHandleResidencyProc)SDL_GL_GetProcAddress("glMakeTextureHandleResidentARB");
+        glExt.makeTextureHandleNonResident = (GLTextureHandleResidencyProc)SDL_GL_GetProcAddress("glMakeTextureHandleNonResidentARB");
+        glExt.bindlessTexture = glExt.getTextureHandle && glExt.makeTextureHandleResident && glExt.makeTextureHandleNonResident;
+    }
+
+    // the ARB version shares the enums, only the entry point name differs
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        glExt.maxShaderCompilerThreads = (GLMaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+    } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        glExt.maxShaderCompilerThreads = (GLMaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    glExt.parallelShaderCompile = glExt.maxShaderCompilerThreads != NULL;
+
+    printf("Extensions: S3TC %s, BPTC %s, texture storage %s, buffer storage %s, bindless %s, parallel shader compile %s\n",
+           glExt.textureCompressionS3TC ? "yes" : "no",
+           glExt.textureCompressionBPTC ? "yes" : "no",
+           glExt.textureStorage ? "yes" : "no",
+           glExt.bufferStorage ? "yes" : "no",
+           glExt.bindlessTexture ? "yes" : "no",
+           glExt.parallelShaderCompile ? "yes" : "no");
+}
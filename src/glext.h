@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <glad/glad.h>
+
+// glad is generated for plain 3.3 core, optional extensions are detected and loaded here
+
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_ARB_texture_compression_bptc
+#define GL_COMPRESSED_RGBA_BPTC_UNORM_ARB 0x8E8C
+#endif
+
+#ifndef GL_ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP GLTexStorage2DProc)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+
+typedef void (APIENTRYP GLBufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef GLuint64 (APIENTRYP GLGetTextureHandleProc)(GLuint texture);
+typedef void (APIENTRYP GLTextureHandleResidencyProc)(GLuint64 handle);
+typedef void (APIENTRYP GLMaxShaderCompilerThreadsProc)(GLuint count);
+
+typedef struct glExtensions {
+    bool textureCompressionS3TC;
+    bool textureCompressionBPTC;
+    // immutable storage, core in 4.2
+    bool textureStorage;
+    GLTexStorage2DProc texStorage2D;
+    // immutable buffers that can stay mapped while the GPU reads them, core in 4.4
+    bool bufferStorage;
+    GLBufferStorageProc createBufferStorage;
+    // 64-bit texture handles sampled without binding
+    bool bindlessTexture;
+    GLGetTextureHandleProc getTextureHandle;
+    GLTextureHandleResidencyProc makeTextureHandleResident;
+    GLTextureHandleResidencyProc makeTextureHandleNonResident;
+    // compiles and links run on driver threads, GL_COMPLETION_STATUS_KHR polls them without blocking
+    bool parallelShaderCompile;
+    GLMaxShaderCompilerThreadsProc maxShaderCompilerThreads;
+} GLExtensions;
+
+extern GLExtensions glExt;
+
+void loadGLExtensions(void);
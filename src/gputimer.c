@@ -0,0 +1,91 @@
+#include <glad/glad.h>
+#include <stdio.h>
+
+#include "gputimer.h"
+
+GpuTimer initGpuTimer(const char** names, unsigned int numPasses) {
+    GpuTimer timer = {0};
+    timer.active = -1;
+
+    if (numPasses > GPU_TIMER_MAX_PASSES) {
+        numPasses = GPU_TIMER_MAX_PASSES;
+    }
+    timer.numPasses = numPasses;
+
+    for (unsigned int i = 0; i < numPasses; i++) {
+        timer.names[i] = names[i];
+    }
+
+    for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glGenQueries(numPasses, timer.queries[i]);
+    }
+
+    return timer;
+}
+
+void beginGpuTimer(GpuTimer* timer, unsigned int pass) {
+    // GL_TIME_ELAPSED queries cannot nest
+    if (timer->active >= 0 || pass >= timer->numPasses) {
+        return;
+    }
+
+    unsigned int slot = timer->frame % GPU_TIMER_LATENCY;
+    glBeginQuery(GL_TIME_ELAPSED, timer->queries[slot][pass]);
+    timer->pending[slot][pass] = true;
+    timer->active = pass;
+}
+
+void endGpuTimer(GpuTimer* timer) {
+    if (timer->active < 0) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->active = -1;
+}
+
+// call once per frame after the last pass; collects the results of the oldest frame in flight
+void advanceGpuTimer(GpuTimer* timer) {
+    timer->frame++;
+
+    unsigned int slot = timer->frame % GPU_TIMER_LATENCY;
+    for (unsigned int pass = 0; pass < timer->numPasses; pass++) {
+        if (!timer->pending[slot][pass]) {
+            continue;
+        }
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(timer->queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            // the slot gets reused now, drop the sample rather than stall
+            timer->pending[slot][pass] = false;
+            continue;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timer->queries[slot][pass], GL_QUERY_RESULT, &elapsed);
+        timer->total[pass] += (double)elapsed / 1000000.0;
+        timer->samples[pass]++;
+        timer->pending[slot][pass] = false;
+    }
+}
+
+void reportGpuTimer(GpuTimer* timer) {
+    printf("GPU ms/frame:");
+    for (unsigned int pass = 0; pass < timer->numPasses; pass++) {
+        if (timer->samples[pass] == 0) {
+            continue;
+        }
+
+        printf(" %s %.3f", timer->names[pass], timer->total[pass] / timer->samples[pass]);
+        timer->total[pass] = 0.0;
+        timer->samples[pass] = 0;
+    }
+    printf("\n");
+}
+
+void freeGpuTimer(GpuTimer* timer) {
+    for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glDeleteQueries(timer->numPasses, timer->queries[i]);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+
+#define GPU_TIMER_MAX_PASSES 8
+// results are read back this many frames late so the CPU never waits on the GPU
+#define GPU_TIMER_LATENCY 3
+
+typedef struct gpuTimer {
+    unsigned int queries[GPU_TIMER_LATENCY][GPU_TIMER_MAX_PASSES];
+    bool pending[GPU_TIMER_LATENCY][GPU_TIMER_MAX_PASSES];
+    const char* names[GPU_TIMER_MAX_PASSES];
+    unsigned int numPasses;
+    unsigned int frame;
+    int active;
+
+    // per pass totals since the last report, in milliseconds
+    double total[GPU_TIMER_MAX_PASSES];
+    unsigned int samples[GPU_TIMER_MAX_PASSES];
+} GpuTimer;
+
+GpuTimer initGpuTimer(const char** names, unsigned int numPasses);
+void beginGpuTimer(GpuTimer* timer, unsigned int pass);
+void endGpuTimer(GpuTimer* timer);
+void advanceGpuTimer(GpuTimer* timer);
+void reportGpuTimer(GpuTimer* timer);
+void freeGpuTimer(GpuTimer* timer);
@@ -1,20 +1,196 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "io.h"
+#include "jobs.h"
+#include "lz.h"
+#include "memtrack.h"
+#include "vfs.h"
 
 // 20 MiB, can probably change this to a highter value without issue
 // check your target platform
 #define IO_READ_CHUNK_SIZE 2097152
 #define IO_READ_ERROR_GENERAL "Error reading file: %s. errno: %d\n"
 #define IO_READ_ERROR_MEMORY "Not enough free memory to read file: %s\n"
+#define IO_READ_ERROR_CONTAINER "Corrupt compressed file: %s\n"
+
+// packed files are copied out of the mapping, callers own and free the data the same way
+static File io_file_copy(const char *path, const char *source, size_t size) {
+    File file = { .is_valid = false };
+
+    // the terminator needs one byte past the data
+    if (size == SIZE_MAX) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    char *data = trackedMalloc(MEMORY_IO_SCRATCH, size + 1);
+    if (!data) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    memcpy(data, source, size);
+    data[size] = 0;
+
+    file.data = data;
+    file.len = size;
+    file.is_valid = true;
+
+    return file;
+}
+
+typedef struct io_decode {
+    const LZContainer *container;
+    char *dst;
+    // of the decoded range in the uncompressed data
+    size_t offset;
+    size_t size;
+    uint32_t first_chunk;
+    atomic_bool failed;
+} IoDecode;
+
+static void io_decode_chunks(void *data, int begin, int end) {
+    IoDecode *decode = data;
+    const LZContainer *container = decode->container;
+    size_t range_end = decode->offset + decode->size;
+
+    for (int i = begin; i < end; i++) {
+        uint32_t chunk = decode->first_chunk + (uint32_t)i;
+        size_t chunk_begin = (size_t)chunk * container->chunkSize;
+        size_t chunk_size = lzChunkSize(container, chunk);
+
+        // whole chunks land in place, only the ones the range cuts go through scratch
+        if (chunk_begin >= decode->offset && chunk_begin + chunk_size <= range_end) {
+            if (!decompressLZChunk(container, chunk, decode->dst + (chunk_begin - decode->offset))) {
+                atomic_store_explicit(&decode->failed, true, memory_order_relaxed);
+            }
+            continue;
+        }
+
+        char *scratch = trackedMalloc(MEMORY_IO_SCRATCH, chunk_size);
+        if (!scratch || !decompressLZChunk(container, chunk, scratch)) {
+            trackedFree(scratch);
+            atomic_store_explicit(&decode->failed, true, memory_order_relaxed);
+            continue;
+        }
+        size_t from = decode->offset > chunk_begin ? decode->offset : chunk_begin;
+        size_t to = range_end < chunk_begin + chunk_size ? range_end : chunk_begin + chunk_size;
+        memcpy(decode->dst + (from - decode->offset), scratch + (from - chunk_begin), to - from);
+        trackedFree(scratch);
+    }
+}
+
+// [offset, offset + size) of the uncompressed data into dst, the chunks spread over the job system
+static bool io_decode_range(const LZContainer *container, size_t offset, size_t size, char *dst) {
+    if (size == 0) {
+        return true;
+    }
+
+    IoDecode decode = {
+        .container = container,
+        .dst = dst,
+        .offset = offset,
+        .size = size,
+        .first_chunk = (uint32_t)(offset / container->chunkSize),
+    };
+    atomic_init(&decode.failed, false);
+    uint32_t last_chunk = (uint32_t)((offset + size - 1) / container->chunkSize);
+    parallelFor((int)(last_chunk - decode.first_chunk + 1), LZ_CHUNK_GRAIN, io_decode_chunks, &decode);
+    return !atomic_load(&decode.failed);
+}
+
+static File io_file_decompress(const char *path, const LZContainer *container, size_t offset, size_t size) {
+    File file = { .is_valid = false };
+
+    if (offset > container->size || size > container->size - offset) {
+        printf("Range past the end of compressed file: %s\n", path);
+        return file;
+    }
+
+    if (size == SIZE_MAX) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    char *data = trackedMalloc(MEMORY_IO_SCRATCH, size + 1);
+    if (!data) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    if (!io_decode_range(container, offset, size, data)) {
+        trackedFree(data);
+        printf(IO_READ_ERROR_CONTAINER, path);
+        return file;
+    }
+    data[size] = 0;
+
+    file.data = data;
+    file.len = size;
+    file.is_valid = true;
+
+    return file;
+}
+
+static bool io_open_packed(const char *path, const VfsFile *packed, LZContainer *container) {
+    if (!openLZContainer(packed->data, packed->storedSize, container) || container->size != packed->size) {
+        printf(IO_READ_ERROR_CONTAINER, path);
+        return false;
+    }
+    return true;
+}
+
+static bool io_is_container(const char *data, size_t len) {
+    return len >= sizeof(LZHeader) && memcmp(data, LZ_MAGIC, 4) == 0;
+}
+
+static File io_file_read_loose(const char *path);
 
 File io_file_read(const char *path) {
+    VfsFile packed;
+    if (vfsFind(path, &packed)) {
+        if (packed.compression == PACK_COMPRESSION_LZ) {
+            LZContainer container;
+            if (!io_open_packed(path, &packed, &container)) {
+                return (File){ .is_valid = false };
+            }
+            return io_file_decompress(path, &container, 0, packed.size);
+        }
+        return io_file_copy(path, packed.data, packed.size);
+    }
+
+    // loose files written by assetpack -lzfile decode the same way
+    File file = io_file_read_loose(path);
+    if (!file.is_valid || !io_is_container(file.data, file.len)) {
+        return file;
+    }
+
+    LZContainer container;
+    File decoded = { .is_valid = false };
+    if (openLZContainer(file.data, file.len, &container)) {
+        decoded = io_file_decompress(path, &container, 0, (size_t)container.size);
+    } else {
+        printf(IO_READ_ERROR_CONTAINER, path);
+    }
+    io_file_free(&file);
+    return decoded;
+}
+
+static File io_file_read_loose(const char *path) {
     File file = { .is_valid = false };
 
     FILE *fp = fopen(path, "rb");
-    if (!fp || ferror(fp)) {
+    if (!fp) {
         printf(IO_READ_ERROR_GENERAL, path, errno);
         return file;
     }
@@ -30,14 +206,16 @@ File io_file_read(const char *path) {
             size = used + IO_READ_CHUNK_SIZE + 1;
 
             if (size <= used) {
-                free(data);
+                trackedFree(data);
+                fclose(fp);
                 printf("Input file too large: %s\n", path);
                 return file;
             }
 
-            tmp = realloc(data, size);
+            tmp = trackedRealloc(MEMORY_IO_SCRATCH, data, size);
             if (!tmp) {
-                free(data);
+                trackedFree(data);
+                fclose(fp);
                 printf(IO_READ_ERROR_MEMORY, path);
                 return file;
             }
@@ -51,15 +229,17 @@ File io_file_read(const char *path) {
         used += n;
     }
 
-    if (ferror(fp)) {
-        free(data);
+    bool failed = ferror(fp);
+    fclose(fp);
+    if (failed) {
+        trackedFree(data);
         printf(IO_READ_ERROR_GENERAL, path, errno);
         return file;
     }
 
-    tmp = realloc(data, used + 1);
+    tmp = trackedRealloc(MEMORY_IO_SCRATCH, data, used + 1);
     if (!tmp) {
-        free(data);
+        trackedFree(data);
         printf(IO_READ_ERROR_MEMORY, path);
         return file;
     }
@@ -73,6 +253,82 @@ File io_file_read(const char *path) {
     return file;
 }
 
+File io_file_read_range(const char *path, size_t offset, size_t size) {
+    File file = { .is_valid = false };
+
+    if (size == SIZE_MAX) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    VfsFile packed;
+    if (vfsFind(path, &packed)) {
+        if (offset > packed.size || size > packed.size - offset) {
+            printf("Range past the end of packed file: %s\n", path);
+            return file;
+        }
+        if (packed.compression == PACK_COMPRESSION_LZ) {
+            LZContainer container;
+            if (!io_open_packed(path, &packed, &container)) {
+                return file;
+            }
+            // only the chunks covering the range are decoded
+            return io_file_decompress(path, &container, offset, size);
+        }
+        return io_file_copy(path, packed.data + offset, size);
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp || ferror(fp)) {
+        printf(IO_READ_ERROR_GENERAL, path, errno);
+        return file;
+    }
+
+    // a loose container is decoded whole, ranges of it are rare enough
+    LZHeader header;
+    if (fread(&header, 1, sizeof(header), fp) == sizeof(header) && io_is_container((const char *)&header, sizeof(header))) {
+        fclose(fp);
+        File whole = io_file_read(path);
+        if (whole.is_valid && (offset > whole.len || size > whole.len - offset)) {
+            printf("Range past the end of compressed file: %s\n", path);
+        } else if (whole.is_valid) {
+            file = io_file_copy(path, whole.data + offset, size);
+        }
+        io_file_free(&whole);
+        return file;
+    }
+
+    char *data = trackedMalloc(MEMORY_IO_SCRATCH, size + 1);
+    if (!data) {
+        fclose(fp);
+        printf(IO_READ_ERROR_MEMORY, path);
+        return file;
+    }
+
+    if (fseek(fp, (long)offset, SEEK_SET) != 0 || fread(data, 1, size, fp) != size) {
+        trackedFree(data);
+        fclose(fp);
+        printf(IO_READ_ERROR_GENERAL, path, errno);
+        return file;
+    }
+
+    fclose(fp);
+    data[size] = 0;
+
+    file.data = data;
+    file.len = size;
+    file.is_valid = true;
+
+    return file;
+}
+
+void io_file_free(File *file) {
+    trackedFree(file->data);
+    file->data = NULL;
+    file->len = 0;
+    file->is_valid = false;
+}
+
 int io_file_write(void *buffer, size_t size, const char *path) {
     FILE *fp = fopen(path, "wb");
     if (!fp || ferror(fp)) {
@@ -92,3 +348,158 @@ int io_file_write(void *buffer, size_t size, const char *path) {
 
     return 0;
 }
+
+static double io_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// asks the kernel to drop the file's cached pages so the next read goes to the disk, best effort
+static void io_drop_cache(const char *path) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+// round trips of zeros, noise and text with some noise in it, spanning several chunks, plus damaged containers
+static bool io_test_compression(void) {
+    const char *text = "the quick brown fox jumps over the lazy dog, ";
+    size_t text_len = strlen(text);
+    size_t size = 3 * LZ_CHUNK_SIZE + 1234;
+    unsigned char *raw = malloc(size);
+    unsigned char *decoded = malloc(size);
+    size_t capacity = lzContainerBound(size);
+    unsigned char *packed = malloc(capacity);
+
+    bool passed = true;
+    for (int pattern = 0; pattern < 3 && passed; pattern++) {
+        uint32_t state = 12345;
+        for (size_t i = 0; i < size; i++) {
+            state = state * 1664525u + 1013904223u;
+            unsigned char noise = (unsigned char)(state >> 24);
+            raw[i] = pattern == 0 ? 0 : pattern == 1 || noise < 8 ? noise : (unsigned char)text[i % text_len];
+        }
+
+        size_t packed_size = compressLZ(raw, size, packed, capacity);
+        LZContainer container;
+        passed = packed_size > 0 && openLZContainer(packed, packed_size, &container) && container.size == size;
+        for (uint32_t i = 0; passed && i < container.numChunks; i++) {
+            passed = decompressLZChunk(&container, i, decoded + (size_t)i * container.chunkSize);
+        }
+        passed = passed && memcmp(raw, decoded, size) == 0;
+        passed = passed && !openLZContainer(packed, packed_size - 1, &container);
+    }
+
+    LZContainer empty;
+    size_t empty_size = compressLZ(raw, 0, packed, capacity);
+    passed = passed && openLZContainer(packed, empty_size, &empty) && empty.size == 0 && empty.numChunks == 0;
+    passed = passed && !openLZContainer(packed, sizeof(LZHeader) - 1, &empty);
+
+    // a size that wraps the chunk count around
+    LZHeader wrapped = { .version = LZ_VERSION, .size = UINT64_MAX, .chunkSize = 2, .numChunks = 0 };
+    memcpy(wrapped.magic, LZ_MAGIC, 4);
+    passed = passed && !openLZContainer(&wrapped, sizeof(wrapped), &empty);
+
+    free(raw);
+    free(decoded);
+    free(packed);
+    return passed;
+}
+
+bool io_benchmark_compression(const char *path, int rounds) {
+    bool passed = io_test_compression();
+    printf("LZ self test %s\n", passed ? "passed" : "FAILED");
+
+    File raw = io_file_read(path);
+    if (!raw.is_valid || raw.len == 0) {
+        printf("LZ benchmark needs a non-empty file, %s is not one\n", path);
+        io_file_free(&raw);
+        return false;
+    }
+    rounds = rounds > 0 ? rounds : 1;
+
+    size_t capacity = lzContainerBound(raw.len);
+    char *packed = trackedMalloc(MEMORY_IO_SCRATCH, capacity);
+    char *decoded = trackedMalloc(MEMORY_IO_SCRATCH, raw.len);
+    if (!packed || !decoded) {
+        printf(IO_READ_ERROR_MEMORY, path);
+        trackedFree(packed);
+        trackedFree(decoded);
+        io_file_free(&raw);
+        return false;
+    }
+
+    double start = io_now_ms();
+    size_t packed_size = compressLZ(raw.data, raw.len, packed, capacity);
+    double compress_ms = io_now_ms() - start;
+    LZContainer container;
+    passed = openLZContainer(packed, packed_size, &container) && passed;
+
+    // the same chunks decoded one after another on this thread, then spread over the job system
+    start = io_now_ms();
+    for (int round = 0; round < rounds && passed; round++) {
+        for (uint32_t i = 0; i < container.numChunks; i++) {
+            passed = decompressLZChunk(&container, i, decoded + (size_t)i * container.chunkSize) && passed;
+        }
+    }
+    double serial_ms = (io_now_ms() - start) / rounds;
+    passed = passed && memcmp(decoded, raw.data, raw.len) == 0;
+
+    memset(decoded, 0, raw.len);
+    start = io_now_ms();
+    for (int round = 0; round < rounds && passed; round++) {
+        passed = io_decode_range(&container, 0, raw.len, decoded) && passed;
+    }
+    double parallel_ms = (io_now_ms() - start) / rounds;
+    passed = passed && memcmp(decoded, raw.data, raw.len) == 0;
+
+    // whole loads through io_file_read with the page cache dropped before each, the container sits next to the
+    // original so both come from the same disk
+    char packed_path[1024];
+    snprintf(packed_path, sizeof(packed_path), "%s.lz", path);
+    double raw_load_ms = 0.0;
+    double packed_load_ms = 0.0;
+    bool loaded = passed && io_file_write(packed, packed_size, packed_path) == 0;
+    for (int round = 0; round < rounds && loaded; round++) {
+        io_drop_cache(path);
+        start = io_now_ms();
+        File file = io_file_read(path);
+        raw_load_ms += io_now_ms() - start;
+        io_file_free(&file);
+
+        io_drop_cache(packed_path);
+        start = io_now_ms();
+        file = io_file_read(packed_path);
+        packed_load_ms += io_now_ms() - start;
+        loaded = file.is_valid && file.len == raw.len && memcmp(file.data, raw.data, raw.len) == 0;
+        passed = loaded && passed;
+        io_file_free(&file);
+    }
+    remove(packed_path);
+
+    double mib = (double)raw.len / (1024.0 * 1024.0);
+    double gb = (double)raw.len / 1e9;
+    printf("LZ %s: %.1f MiB to %.1f MiB, %.1f%% of the original, compressed at %.0f MiB/s\n", path, mib,
+           (double)packed_size / (1024.0 * 1024.0), 100.0 * packed_size / raw.len, mib / (compress_ms / 1000.0));
+    printf("LZ decode: %.2f GB/s on one thread, %.2f GB/s over %d workers and the main thread\n",
+           gb / (serial_ms / 1000.0), gb / (parallel_ms / 1000.0), jobWorkerCount());
+    if (loaded) {
+        printf("LZ load with a cold cache: %.2f ms uncompressed, %.2f ms compressed\n", raw_load_ms / rounds,
+               packed_load_ms / rounds);
+    }
+    if (packed_size > raw.len * (1.0 - LZ_MIN_SAVING)) {
+        printf("LZ saves less than %.0f%% here, assetpack -lz would store this file as is\n", LZ_MIN_SAVING * 100.0);
+    }
+    printf("LZ benchmark %s\n", passed ? "passed" : "FAILED");
+
+    trackedFree(packed);
+    trackedFree(decoded);
+    io_file_free(&raw);
+    return passed;
+}
@@ -3,11 +3,21 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+// rounds of -lzbench
+#define IO_LZ_BENCH_ROUNDS 10
+
 typedef struct file {
     char *data;
     size_t len;
     bool is_valid;
 } File;
 
+// packed files and LZ containers (assetpack -lz, -lzfile) come back decoded
 File io_file_read(const char *path);
+File io_file_read_range(const char *path, size_t offset, size_t size);
+// data is tracked as IO scratch, release it here rather than with free
+void io_file_free(File *file);
 int io_file_write(void *buffer, size_t size, const char *path);
+// round trip self test, then compression ratio, single and multi threaded decode GB/s and cold loads of the
+// file against a compressed copy of it
+bool io_benchmark_compression(const char *path, int rounds);
@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "jobs.h"
+
+typedef struct jobSystem {
+    bool ready;
+    int numWorkers;
+    // index 0 belongs to the main thread, workers use 1..numWorkers
+    JobDeque* deques;
+    SDL_Thread* threads[JOB_MAX_WORKERS];
+
+    atomic_bool running;
+    atomic_int numSleeping;
+    SDL_sem* wake;
+
+    JobStats stats;
+} JobSystem;
+
+typedef struct parallelForChunk {
+    ParallelForFunction function;
+    void* data;
+    int begin;
+    int end;
+} ParallelForChunk;
+
+static JobSystem jobs = {0};
+
+// deque of the calling thread, -1 on threads the job system does not own
+static _Thread_local int jobThread = -1;
+static _Thread_local unsigned int stealSeed = 1;
+
+static void cpuPause(void) {
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+// Chase-Lev deque with the C11 orderings from Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+// Only the owner pushes and pops at the bottom, thieves take from the top. The job is copied out before the
+// claiming CAS, a slot that was still in the deque when it was read cannot have been refilled yet.
+static void writeSlot(JobSlot* slot, const Job* job) {
+    atomic_store_explicit(&slot->function, job->function, memory_order_relaxed);
+    atomic_store_explicit(&slot->data, job->data, memory_order_relaxed);
+    atomic_store_explicit(&slot->counter, job->counter, memory_order_relaxed);
+}
+
+static void readSlot(JobSlot* slot, Job* job) {
+    job->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    job->data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    job->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+static bool pushJob(JobDeque* deque, const Job* job) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_SIZE) {
+        return false;
+    }
+
+    writeSlot(&deque->slots[bottom & (JOB_DEQUE_SIZE - 1)], job);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+static bool popJob(JobDeque* deque, Job* out) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    readSlot(&deque->slots[bottom & (JOB_DEQUE_SIZE - 1)], out);
+    if (top == bottom) {
+        // last job, race the thieves for it
+        bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+static bool stealJob(JobDeque* deque, Job* out) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return false;
+    }
+
+    readSlot(&deque->slots[top & (JOB_DEQUE_SIZE - 1)], out);
+    return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static void executeJob(const Job* job) {
+    job->function(job->data);
+    if (job->counter) {
+        atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+    }
+    atomic_fetch_add_explicit(&jobs.stats.numJobs, 1, memory_order_relaxed);
+}
+
+// own deque first, newest job for cache locality, then the oldest job of a random victim
+static bool findJob(int self, Job* out) {
+    if (popJob(&jobs.deques[self], out)) {
+        return true;
+    }
+
+    int numThreads = jobs.numWorkers + 1;
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 17;
+    stealSeed ^= stealSeed << 5;
+    int start = (int)(stealSeed % (unsigned int)numThreads);
+
+    for (int i = 0; i < numThreads; i++) {
+        int victim = (start + i) % numThreads;
+        if (victim != self && stealJob(&jobs.deques[victim], out)) {
+            atomic_fetch_add_explicit(&jobs.stats.numSteals, 1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int jobWorker(void* data) {
+    jobThread = (int)(intptr_t)data;
+    stealSeed = 0x9e3779b9u * (unsigned int)jobThread;
+
+    int idle = 0;
+    Job job;
+    while (atomic_load_explicit(&jobs.running, memory_order_acquire)) {
+        if (findJob(jobThread, &job)) {
+            executeJob(&job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_SPIN_COUNT) {
+            cpuPause();
+            continue;
+        }
+
+        // announce the sleep before the last look, runJob checks numSleeping after publishing its job
+        atomic_fetch_add(&jobs.numSleeping, 1);
+        if (findJob(jobThread, &job)) {
+            atomic_fetch_sub(&jobs.numSleeping, 1);
+            executeJob(&job);
+        } else {
+            atomic_fetch_add_explicit(&jobs.stats.numSleeps, 1, memory_order_relaxed);
+            SDL_SemWait(jobs.wake);
+            atomic_fetch_sub(&jobs.numSleeping, 1);
+        }
+        idle = 0;
+    }
+
+    return 0;
+}
+
+void initJobSystem(int numWorkers) {
+    if (numWorkers < 0) {
+        numWorkers = SDL_GetCPUCount() - 1;
+    }
+    numWorkers = numWorkers < JOB_MAX_WORKERS ? numWorkers : JOB_MAX_WORKERS;
+    numWorkers = numWorkers > 0 ? numWorkers : 0;
+
+    jobs.numWorkers = numWorkers;
+    jobs.deques = calloc(numWorkers + 1, sizeof(JobDeque));
+    jobs.wake = SDL_CreateSemaphore(0);
+    atomic_store(&jobs.running, true);
+    atomic_store(&jobs.numSleeping, 0);
+
+    jobThread = 0;
+    jobs.ready = true;
+
+    for (int i = 0; i < numWorkers; i++) {
+        jobs.threads[i] = SDL_CreateThread(jobWorker, "jobs", (void*)(intptr_t)(i + 1));
+        if (!jobs.threads[i]) {
+            printf("Error: Could not start job worker: %s\n", SDL_GetError());
+            // run with the workers that did start
+            jobs.numWorkers = i;
+            break;
+        }
+    }
+}
+
+int jobWorkerCount(void) {
+    return jobs.numWorkers;
+}
+
+int jobThreadIndex(void) {
+    return jobThread;
+}
+
+void runJob(JobFunction function, void* data, JobCounter* counter) {
+    int self = jobThread;
+    if (!jobs.ready || self < 0) {
+        function(data);
+        return;
+    }
+
+    if (counter) {
+        atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+    }
+
+    Job job = {function, data, counter};
+    if (!pushJob(&jobs.deques[self], &job)) {
+        atomic_fetch_add_explicit(&jobs.stats.numInline, 1, memory_order_relaxed);
+        executeJob(&job);
+        return;
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&jobs.numSleeping, memory_order_relaxed) > 0) {
+        SDL_SemPost(jobs.wake);
+    }
+}
+
+void waitForCounter(JobCounter* counter) {
+    Job job;
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        if (jobThread >= 0 && findJob(jobThread, &job)) {
+            executeJob(&job);
+        } else {
+            cpuPause();
+        }
+    }
+}
+
+static void parallelForJob(void* data) {
+    ParallelForChunk* chunk = data;
+    chunk->function(chunk->data, chunk->begin, chunk->end);
+}
+
+void parallelFor(int count, int grain, ParallelForFunction function, void* data) {
+    if (count <= 0) {
+        return;
+    }
+
+    int numThreads = jobs.numWorkers + 1;
+    if (grain <= 0) {
+        grain = count / (numThreads * JOB_CHUNKS_PER_THREAD);
+    }
+    // the chunk list lives on this stack frame
+    grain = grain > (count + JOB_MAX_CHUNKS - 1) / JOB_MAX_CHUNKS ? grain : (count + JOB_MAX_CHUNKS - 1) / JOB_MAX_CHUNKS;
+    grain = grain > 1 ? grain : 1;
+
+    int numChunks = (count + grain - 1) / grain;
+    if (numChunks == 1 || !jobs.ready || jobThread < 0 || jobs.numWorkers == 0) {
+        function(data, 0, count);
+        return;
+    }
+
+    ParallelForChunk chunks[JOB_MAX_CHUNKS];
+    JobCounter counter = {0};
+    for (int i = 0; i < numChunks; i++) {
+        int begin = i * grain;
+        int end = begin + grain < count ? begin + grain : count;
+        chunks[i] = (ParallelForChunk){function, data, begin, end};
+    }
+
+    // the caller takes the first chunk and then helps with the rest
+    for (int i = 1; i < numChunks; i++) {
+        runJob(parallelForJob, &chunks[i], &counter);
+    }
+    parallelForJob(&chunks[0]);
+    waitForCounter(&counter);
+}
+
+void reportJobSystem(void) {
+    printf("Job system: %d workers, %u jobs, %u steals, %u run inline, %u sleeps\n", jobs.numWorkers,
+           atomic_load(&jobs.stats.numJobs), atomic_load(&jobs.stats.numSteals),
+           atomic_load(&jobs.stats.numInline), atomic_load(&jobs.stats.numSleeps));
+}
+
+void freeJobSystem(void) {
+    if (!jobs.ready) {
+        return;
+    }
+
+    atomic_store(&jobs.running, false);
+    for (int i = 0; i < jobs.numWorkers; i++) {
+        SDL_SemPost(jobs.wake);
+    }
+    for (int i = 0; i < jobs.numWorkers; i++) {
+        SDL_WaitThread(jobs.threads[i], NULL);
+    }
+
+    SDL_DestroySemaphore(jobs.wake);
+    free(jobs.deques);
+    jobs = (JobSystem){0};
+    jobThread = -1;
+}
+
+// stress test
+
+#define JOB_TEST_COUNT 100003
+#define JOB_TEST_DEPTH 10
+#define JOB_TEST_FLOOD (JOB_DEQUE_SIZE * 3)
+
+typedef struct jobTestTree {
+    int depth;
+    atomic_int* visited;
+} JobTestTree;
+
+typedef struct jobTestStage {
+    int* values;
+    int index;
+    JobCounter* dependency;
+    long long sum;
+} JobTestStage;
+
+static void testCoverage(void* data, int begin, int end) {
+    atomic_int* hits = data;
+    for (int i = begin; i < end; i++) {
+        atomic_fetch_add_explicit(&hits[i], 1, memory_order_relaxed);
+    }
+}
+
+// every node spawns two children and waits for them, waiting threads keep running other jobs
+static void testTree(void* data) {
+    JobTestTree* node = data;
+    if (node->depth > 0) {
+        JobTestTree children[2] = {{node->depth - 1, node->visited}, {node->depth - 1, node->visited}};
+        JobCounter counter = {0};
+        runJob(testTree, &children[0], &counter);
+        runJob(testTree, &children[1], &counter);
+        waitForCounter(&counter);
+    }
+    atomic_fetch_add(node->visited, 1);
+}
+
+static void testProduce(void* data) {
+    JobTestStage* stage = data;
+    stage->values[stage->index] = stage->index * 3;
+}
+
+static void testConsume(void* data) {
+    JobTestStage* stage = data;
+    waitForCounter(stage->dependency);
+    stage->sum = 0;
+    for (int i = 0; i < stage->index; i++) {
+        stage->sum += stage->values[i];
+    }
+}
+
+static void testIncrement(void* data) {
+    atomic_fetch_add_explicit((atomic_int*)data, 1, memory_order_relaxed);
+}
+
+bool testJobSystem(int rounds) {
+    atomic_int* hits = malloc(JOB_TEST_COUNT * sizeof(atomic_int));
+    int* values = malloc(JOB_TEST_FLOOD * sizeof(int));
+    JobTestStage* producers = malloc(JOB_TEST_FLOOD * sizeof(JobTestStage));
+    const int grains[] = {0, 1, 7, 1000, JOB_TEST_COUNT};
+    bool ok = true;
+
+    for (int round = 0; round < rounds && ok; round++) {
+        // every index visited exactly once for any grain
+        for (unsigned int g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+            for (int i = 0; i < JOB_TEST_COUNT; i++) {
+                atomic_init(&hits[i], 0);
+            }
+            parallelFor(JOB_TEST_COUNT, grains[g], testCoverage, hits);
+            for (int i = 0; i < JOB_TEST_COUNT; i++) {
+                if (atomic_load(&hits[i]) != 1) {
+                    printf("Job test failed: parallelFor grain %d visited %d %d times\n", grains[g], i, atomic_load(&hits[i]));
+                    ok = false;
+                    break;
+                }
+            }
+        }
+
+        // nested jobs waiting on their children
+        atomic_int visited;
+        atomic_init(&visited, 0);
+        JobTestTree root = {JOB_TEST_DEPTH, &visited};
+        JobCounter treeCounter = {0};
+        runJob(testTree, &root, &treeCounter);
+        waitForCounter(&treeCounter);
+        if (atomic_load(&visited) != (2 << JOB_TEST_DEPTH) - 1) {
+            printf("Job test failed: tree visited %d of %d nodes\n", atomic_load(&visited), (2 << JOB_TEST_DEPTH) - 1);
+            ok = false;
+        }
+
+        // a consumer depending on more producers than fit in one deque
+        JobCounter produced = {0};
+        JobCounter consumed = {0};
+        JobTestStage consumer = {values, JOB_TEST_FLOOD, &produced, 0};
+        for (int i = 0; i < JOB_TEST_FLOOD; i++) {
+            producers[i] = (JobTestStage){values, i, NULL, 0};
+            runJob(testProduce, &producers[i], &produced);
+        }
+        runJob(testConsume, &consumer, &consumed);
+        waitForCounter(&consumed);
+        long long expected = 3LL * JOB_TEST_FLOOD * (JOB_TEST_FLOOD - 1) / 2;
+        if (consumer.sum != expected) {
+            printf("Job test failed: consumer saw %lld, expected %lld\n", consumer.sum, expected);
+            ok = false;
+        }
+
+        // plenty of tiny jobs against one counter
+        atomic_int increments;
+        atomic_init(&increments, 0);
+        JobCounter counter = {0};
+        for (int i = 0; i < JOB_TEST_FLOOD; i++) {
+            runJob(testIncrement, &increments, &counter);
+        }
+        waitForCounter(&counter);
+        if (atomic_load(&increments) != JOB_TEST_FLOOD) {
+            printf("Job test failed: %d of %d increments\n", atomic_load(&increments), JOB_TEST_FLOOD);
+            ok = false;
+        }
+    }
+
+    free(hits);
+    free(values);
+    free(producers);
+
+    if (ok) {
+        printf("Job test passed: %d rounds on %d workers\n", rounds, jobs.numWorkers);
+    }
+    reportJobSystem();
+    return ok;
+}
+
+// scaling benchmark
+
+#define JOB_BENCH_COUNT (1 << 20)
+#define JOB_BENCH_REPEAT 5
+
+static void benchWork(void* data, int begin, int end) {
+    float* values = data;
+    for (int i = begin; i < end; i++) {
+        float x = (float)i * 1e-6f;
+        for (int k = 0; k < 32; k++) {
+            x = sinf(x) * 0.5f + cosf(x * 0.25f);
+        }
+        values[i] = x;
+    }
+}
+
+void benchmarkJobSystem(void) {
+    int initialWorkers = jobs.numWorkers;
+    int numCPUs = SDL_GetCPUCount();
+    float* values = malloc(JOB_BENCH_COUNT * sizeof(float));
+    double baseline = 0.0;
+
+    // powers of two and the full CPU count
+    for (int threads = 1; ; threads = threads * 2 < numCPUs ? threads * 2 : numCPUs) {
+        freeJobSystem();
+        initJobSystem(threads - 1);
+
+        parallelFor(JOB_BENCH_COUNT, 0, benchWork, values);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < JOB_BENCH_REPEAT; i++) {
+            parallelFor(JOB_BENCH_COUNT, 0, benchWork, values);
+        }
+        double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() / JOB_BENCH_REPEAT;
+
+        baseline = threads == 1 ? ms : baseline;
+        printf("Job benchmark %2d threads: %.2f ms, %.2fx\n", threads, ms, baseline / ms);
+
+        if (threads >= numCPUs) {
+            break;
+        }
+    }
+
+    free(values);
+    freeJobSystem();
+    initJobSystem(initialWorkers);
+}
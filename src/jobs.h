@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// worker threads besides the main thread
+#define JOB_MAX_WORKERS 31
+// per thread, a power of two; a full deque runs the job inline
+#define JOB_DEQUE_SIZE 4096
+// failed steal rounds before an idle worker goes to sleep
+#define JOB_SPIN_COUNT 64
+// parallelFor splits into this many chunks per thread when no grain is given
+#define JOB_CHUNKS_PER_THREAD 4
+// chunk descriptors of one parallelFor, kept on the caller's stack
+#define JOB_MAX_CHUNKS 256
+
+typedef void (*JobFunction)(void* data);
+typedef void (*ParallelForFunction)(void* data, int begin, int end);
+
+// number of jobs still running, jobs can wait on counters from other jobs to form dependencies
+typedef struct jobCounter {
+    atomic_int pending;
+} JobCounter;
+
+typedef struct job {
+    JobFunction function;
+    void* data;
+    JobCounter* counter;
+} Job;
+
+// jobs are stored by value, a thief may read a slot the owner is refilling but then loses the claim
+typedef struct jobSlot {
+    _Atomic(JobFunction) function;
+    _Atomic(void*) data;
+    _Atomic(JobCounter*) counter;
+} JobSlot;
+
+// thieves hammer top and the owner bottom, keep them on separate cache lines
+typedef struct jobDeque {
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    JobSlot slots[JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct jobStats {
+    atomic_uint numJobs;
+    atomic_uint numSteals;
+    atomic_uint numInline;
+    atomic_uint numSleeps;
+} JobStats;
+
+// numWorkers < 0 picks one per CPU besides the main thread
+void initJobSystem(int numWorkers);
+int jobWorkerCount(void);
+// 0 on the main thread, 1..jobWorkerCount() on workers, -1 elsewhere
+int jobThreadIndex(void);
+// from a thread that is neither the main thread nor a worker the job runs inline
+void runJob(JobFunction function, void* data, JobCounter* counter);
+// runs other jobs until the counter drops to zero
+void waitForCounter(JobCounter* counter);
+// calls function over [0, count) in chunks of grain (0 picks one), returns once all chunks are done
+void parallelFor(int count, int grain, ParallelForFunction function, void* data);
+void reportJobSystem(void);
+void freeJobSystem(void);
+
+// correctness stress test and scaling benchmark, run from the command line
+bool testJobSystem(int rounds);
+void benchmarkJobSystem(void);
@@ -0,0 +1,36 @@
+#include <math.h>
+#include <float.h>
+
+#include "light.h"
+
+static float maxComponent(const vec3 v) {
+    float result = v[0];
+    if (v[1] > result) result = v[1];
+    if (v[2] > result) result = v[2];
+    return result;
+}
+
+// distance at which 1 / (constant + linear * d + quadratic * d^2) scaled by the
+// brightest color term drops below LIGHT_ATTENUATION_CUTOFF
+float lightRange(const PointLight* light) {
+    float intensity = maxComponent(light->ambient);
+    if (maxComponent(light->diffuse) > intensity) intensity = maxComponent(light->diffuse);
+    if (maxComponent(light->specular) > intensity) intensity = maxComponent(light->specular);
+
+    float c = light->constant - intensity / LIGHT_ATTENUATION_CUTOFF;
+    if (c >= 0.0f) {
+        // never bright enough to be visible
+        return 0.0f;
+    }
+
+    if (light->quadratic > 0.0f) {
+        float discriminant = light->linear * light->linear - 4.0f * light->quadratic * c;
+        return (-light->linear + sqrtf(discriminant)) / (2.0f * light->quadratic);
+    }
+
+    if (light->linear > 0.0f) {
+        return -c / light->linear;
+    }
+
+    return FLT_MAX;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <linmath.h>
+
+// contribution below this is invisible in an 8 bit framebuffer
+#define LIGHT_ATTENUATION_CUTOFF (1.0f / 256.0f)
+
+typedef struct pointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+} PointLight;
+
+float lightRange(const PointLight* light);
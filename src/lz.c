@@ -0,0 +1,293 @@
+#include <string.h>
+
+#include "lz.h"
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// bytes equal from a and b on, stopping at limit bytes
+static size_t matchLength(const unsigned char* a, const unsigned char* b, size_t limit) {
+    size_t length = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (length + 8 <= limit) {
+        uint64_t x, y;
+        memcpy(&x, a + length, sizeof(x));
+        memcpy(&y, b + length, sizeof(y));
+        if (x != y) {
+            return length + (__builtin_ctzll(x ^ y) >> 3);
+        }
+        length += 8;
+    }
+#endif
+    while (length < limit && a[length] == b[length]) {
+        length++;
+    }
+    return length;
+}
+
+// lengths from 15 on continue in bytes of 255 and a final smaller one
+static unsigned char* writeLength(unsigned char* op, size_t length) {
+    length -= 15;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+static unsigned char* writeSequence(unsigned char* op, const unsigned char* literals, size_t numLiterals, size_t offset,
+                                    size_t length) {
+    unsigned char* token = op++;
+    *token = (unsigned char)((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (numLiterals >= 15) {
+        op = writeLength(op, numLiterals);
+    }
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+
+    // the last sequence of a block has no match
+    if (length == 0) {
+        return op;
+    }
+
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    length -= LZ_MIN_MATCH;
+    *token |= (unsigned char)(length < 15 ? length : 15);
+    if (length >= 15) {
+        op = writeLength(op, length);
+    }
+    return op;
+}
+
+size_t lzBlockBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t compressLZBlock(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity) {
+    // with room for the worst case nothing below needs to check the output
+    if (capacity < lzBlockBound(size)) {
+        return 0;
+    }
+
+    // positions of the last 4 byte sequence per hash, candidates are compared before use so stale ones are fine
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    unsigned char* op = dst;
+    size_t anchor = 0;
+    if (size > LZ_MATCH_LIMIT) {
+        size_t matchLimit = size - LZ_MATCH_LIMIT;
+        size_t matchEnd = size - LZ_LAST_LITERALS;
+        // incompressible data is skipped through faster the longer nothing matched
+        unsigned int misses = 0;
+
+        size_t ip = 0;
+        while (ip < matchLimit) {
+            uint32_t sequence = read32(src + ip);
+            uint32_t* slot = &table[hashSequence(sequence)];
+            size_t candidate = *slot;
+            *slot = (uint32_t)ip;
+
+            if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET || read32(src + candidate) != sequence) {
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+
+            while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+                ip--;
+                candidate--;
+            }
+            size_t length = LZ_MIN_MATCH + matchLength(src + ip + LZ_MIN_MATCH, src + candidate + LZ_MIN_MATCH,
+                                                       matchEnd - ip - LZ_MIN_MATCH);
+
+            op = writeSequence(op, src + anchor, ip - anchor, ip - candidate, length);
+            ip += length;
+            anchor = ip;
+            misses = 0;
+        }
+    }
+
+    op = writeSequence(op, src + anchor, size - anchor, 0, 0);
+    return (size_t)(op - dst);
+}
+
+static bool readLength(const unsigned char** ip, const unsigned char* end, size_t* length) {
+    unsigned char byte;
+    do {
+        if (*ip >= end) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool decompressLZBlock(const unsigned char* src, size_t size, unsigned char* dst, size_t dstSize) {
+    const unsigned char* ip = src;
+    const unsigned char* inputEnd = src + size;
+    unsigned char* op = dst;
+    unsigned char* outputEnd = dst + dstSize;
+
+    for (;;) {
+        if (ip >= inputEnd) {
+            return false;
+        }
+        unsigned int token = *ip++;
+
+        size_t numLiterals = token >> 4;
+        if (numLiterals == 15 && !readLength(&ip, inputEnd, &numLiterals)) {
+            return false;
+        }
+        if (numLiterals > (size_t)(inputEnd - ip) || numLiterals > (size_t)(outputEnd - op)) {
+            return false;
+        }
+        // short runs are copied 16 bytes at once when both sides have the room, what lands past them is overwritten next
+        if (numLiterals <= 16 && inputEnd - ip >= 16 && outputEnd - op >= 16) {
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, numLiterals);
+        }
+        op += numLiterals;
+        ip += numLiterals;
+
+        if (ip == inputEnd) {
+            return op == outputEnd;
+        }
+        if (inputEnd - ip < 2) {
+            return false;
+        }
+
+        size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return false;
+        }
+
+        size_t length = token & 15;
+        if (length == 15 && !readLength(&ip, inputEnd, &length)) {
+            return false;
+        }
+        length += LZ_MIN_MATCH;
+        if (length > (size_t)(outputEnd - op)) {
+            return false;
+        }
+
+        // overlapping matches repeat the last offset bytes, only whole steps of at most offset bytes are safe
+        const unsigned char* match = op - offset;
+        size_t room = (size_t)(outputEnd - op);
+        if (offset >= 16 && room >= length + 15) {
+            for (size_t i = 0; i < length; i += 16) {
+                memcpy(op + i, match + i, 16);
+            }
+        } else if (offset >= 8 && room >= length + 7) {
+            for (size_t i = 0; i < length; i += 8) {
+                memcpy(op + i, match + i, 8);
+            }
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                op[i] = match[i];
+            }
+        }
+        op += length;
+    }
+}
+
+size_t lzContainerBound(size_t size) {
+    size_t numChunks = (size + LZ_CHUNK_SIZE - 1) / LZ_CHUNK_SIZE;
+    return sizeof(LZHeader) + numChunks * (sizeof(uint64_t) + lzBlockBound(LZ_CHUNK_SIZE));
+}
+
+size_t compressLZ(const void* src, size_t size, void* dst, size_t capacity) {
+    if (capacity < lzContainerBound(size)) {
+        return 0;
+    }
+
+    uint32_t numChunks = (uint32_t)((size + LZ_CHUNK_SIZE - 1) / LZ_CHUNK_SIZE);
+    LZHeader header = {
+        .version = LZ_VERSION,
+        .size = size,
+        .chunkSize = LZ_CHUNK_SIZE,
+        .numChunks = numChunks,
+    };
+    memcpy(header.magic, LZ_MAGIC, 4);
+    memcpy(dst, &header, sizeof(header));
+
+    unsigned char* data = (unsigned char*)dst + sizeof(LZHeader) + numChunks * sizeof(uint64_t);
+    uint64_t* chunkEnds = (uint64_t*)((unsigned char*)dst + sizeof(LZHeader));
+    size_t position = 0;
+    for (uint32_t i = 0; i < numChunks; i++) {
+        const unsigned char* chunk = (const unsigned char*)src + (size_t)i * LZ_CHUNK_SIZE;
+        size_t chunkSize = size - (size_t)i * LZ_CHUNK_SIZE < LZ_CHUNK_SIZE ? size - (size_t)i * LZ_CHUNK_SIZE : LZ_CHUNK_SIZE;
+
+        size_t stored = compressLZBlock(chunk, chunkSize, data + position, lzBlockBound(chunkSize));
+        if (stored == 0 || stored >= chunkSize) {
+            memcpy(data + position, chunk, chunkSize);
+            stored = chunkSize;
+        }
+        position += stored;
+        chunkEnds[i] = position;
+    }
+
+    return (size_t)(data + position - (unsigned char*)dst);
+}
+
+bool openLZContainer(const void* data, size_t size, LZContainer* container) {
+    if (size < sizeof(LZHeader)) {
+        return false;
+    }
+
+    LZHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LZ_MAGIC, 4) != 0 || header.version != LZ_VERSION || header.chunkSize == 0 ||
+        header.numChunks != header.size / header.chunkSize + (header.size % header.chunkSize != 0) ||
+        header.numChunks > (size - sizeof(LZHeader)) / sizeof(uint64_t)) {
+        return false;
+    }
+
+    *container = (LZContainer){
+        .chunkEnds = (const uint64_t*)((const unsigned char*)data + sizeof(LZHeader)),
+        .size = header.size,
+        .chunkSize = header.chunkSize,
+        .numChunks = header.numChunks,
+    };
+    container->data = (const unsigned char*)container->chunkEnds + header.numChunks * sizeof(uint64_t);
+
+    // every chunk inside the data and no larger than stored raw
+    size_t dataSize = size - (size_t)(container->data - (const unsigned char*)data);
+    uint64_t begin = 0;
+    for (uint32_t i = 0; i < header.numChunks; i++) {
+        uint64_t end = container->chunkEnds[i];
+        if (end < begin || end > dataSize || end - begin > lzChunkSize(container, i)) {
+            return false;
+        }
+        begin = end;
+    }
+    return true;
+}
+
+size_t lzChunkSize(const LZContainer* container, uint32_t chunk) {
+    uint64_t begin = (uint64_t)chunk * container->chunkSize;
+    return container->size - begin < container->chunkSize ? container->size - begin : container->chunkSize;
+}
+
+bool decompressLZChunk(const LZContainer* container, uint32_t chunk, void* dst) {
+    uint64_t begin = chunk > 0 ? container->chunkEnds[chunk - 1] : 0;
+    size_t stored = container->chunkEnds[chunk] - begin;
+    size_t size = lzChunkSize(container, chunk);
+
+    if (stored == size) {
+        memcpy(dst, container->data + begin, size);
+        return true;
+    }
+    return decompressLZBlock(container->data + begin, stored, dst, size);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// LZ4 style blocks: a token with literal and match length nibbles, the literals, a 16 bit offset
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 14
+// the last match starts this far from the end of a block at least, and the last bytes are always literals
+#define LZ_MATCH_LIMIT 12
+#define LZ_LAST_LITERALS 5
+
+// container: header, the end offset of every chunk's data, then the chunks, each compressed on its own
+#define LZ_MAGIC "LZCT"
+#define LZ_VERSION 1
+#define LZ_CHUNK_SIZE (256 * 1024)
+// chunks decoded per parallelFor job
+#define LZ_CHUNK_GRAIN 1
+// packs and the benchmark keep files compressed only if that saves at least this fraction
+#define LZ_MIN_SAVING 0.125
+
+typedef struct lzHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t size;
+    uint32_t chunkSize;
+    uint32_t numChunks;
+} LZHeader;
+
+// a validated container in memory, chunk i ends at chunkEnds[i] bytes past data; a chunk as long as its
+// uncompressed size is stored raw, compression never produces that
+typedef struct lzContainer {
+    const unsigned char* data;
+    const uint64_t* chunkEnds;
+    uint64_t size;
+    uint32_t chunkSize;
+    uint32_t numChunks;
+} LZContainer;
+
+size_t lzBlockBound(size_t size);
+// 0 if dst is too small
+size_t compressLZBlock(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+// dst has to be exactly the uncompressed size, false on malformed input
+bool decompressLZBlock(const unsigned char* src, size_t size, unsigned char* dst, size_t dstSize);
+
+size_t lzContainerBound(size_t size);
+// single threaded, returns the container size or 0 if dst is too small
+size_t compressLZ(const void* src, size_t size, void* dst, size_t capacity);
+// checks the header and chunk table, false for anything that is not a whole container
+bool openLZContainer(const void* data, size_t size, LZContainer* container);
+// bytes of the original data in the chunk
+size_t lzChunkSize(const LZContainer* container, uint32_t chunk);
+// decodes one whole chunk into dst, any thread
+bool decompressLZChunk(const LZContainer* container, uint32_t chunk, void* dst);
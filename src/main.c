@@ -1,33 +1,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <math.h>
 #include <SDL2/SDL.h>
 #include <glad/glad.h>
-#include <assert.h>
 
 #include "linmath.h"
-#include "shader.h"
 #include "model.h"
-
-#define TICK_INTERVAL 30
-
-static Uint32 next_time;
-
-Uint32 time_left(void) {
-    Uint32 now;
-
-    now = SDL_GetTicks();
-    if (next_time <= now) {
-        return 0;
-    } else {
-        return next_time - now;
-    }
-}
+#include "light.h"
+#include "renderer.h"
+#include "glext.h"
+#include "texcache.h"
+#include "framepacing.h"
+#include "jobs.h"
+#include "telemetry.h"
+#include "memtrack.h"
+#include "mathtest.h"
+#include "transforms.h"
+#include "shaderreload.h"
+#include "startup.h"
+#include "vfs.h"
+#include "io.h"
+
+// camera movement per second of simulated time
+#define CAMERA_SPEED 1.5f
+#define CAMERA_TURN_SPEED 60.0f
 
 const int WIDTH = 1920;
 const int HEIGHT = 1080;
 
+const float Z_NEAR = 0.1f;
+const float Z_FAR = 100.0f;
+
 bool should_quit = false;
 
 vec3 cameraPos = {0.0f, 0.0f, 3.0f};
@@ -36,78 +41,362 @@ vec3 cameraUp = {0.0f, 1.0f, 0.0f};
 
 float fov = 45.0f;
 
-float yaw = -90.0f;
-float pitch = 0;
+// simulated at SIMULATION_RATE, the rendered camera is interpolated between the last two steps
+typedef struct cameraState {
+    vec3 position;
+    float yaw;
+    float pitch;
+} CameraState;
+
+CameraState previousCamera = {{0.0f, 0.0f, 3.0f}, -90.0f, 0.0f};
+CameraState currentCamera = {{0.0f, 0.0f, 3.0f}, -90.0f, 0.0f};
 
-void input_handler() {
-    const float cameraSpeed = 0.05f;
+PointLight pointLights[CLUSTER_MAX_LIGHTS];
+unsigned int numPointLights = 0;
+
+void addPointLight(float x, float y, float z, float constant, float linear, float quadratic, float r, float g, float b) {
+    if (numPointLights == CLUSTER_MAX_LIGHTS) {
+        return;
+    }
+
+    PointLight light = {
+        .position = {x, y, z},
+        .constant = constant,
+        .linear = linear,
+        .quadratic = quadratic,
+        .ambient = {0.05f * r, 0.05f * g, 0.05f * b},
+        .diffuse = {0.8f * r, 0.8f * g, 0.8f * b},
+        .specular = {r, g, b},
+    };
+
+    pointLights[numPointLights] = light;
+    numPointLights++;
+}
+
+float randomRange(float min, float max) {
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+static void cameraDirection(vec3 front, float yaw, float pitch) {
+    vec3 direction;
+    direction[0] = cos(yaw * (M_PI / 180)) * cos(pitch * (M_PI / 180));
+    direction[1] = sin(pitch * (M_PI / 180));
+    direction[2] = sin(yaw * (M_PI / 180)) * cos(pitch * (M_PI / 180));
+    vec3_norm(front, direction);
+}
+
+// one simulation step of dt seconds
+void input_handler(CameraState* camera, float dt) {
+    const float cameraSpeed = CAMERA_SPEED * dt;
+
+    vec3 front;
+    cameraDirection(front, camera->yaw, camera->pitch);
 
     const Uint8 *currentKeyStates = SDL_GetKeyboardState(NULL);
     if (currentKeyStates[SDL_SCANCODE_W]) {
         vec3 result;
-        vec3_scale(result, cameraFront, cameraSpeed);
-        vec3_add(cameraPos, cameraPos, result);
+        vec3_scale(result, front, cameraSpeed);
+        vec3_add(camera->position, camera->position, result);
     } else if (currentKeyStates[SDL_SCANCODE_S]) {
         vec3 result;
-        vec3_scale(result, cameraFront, cameraSpeed);
-        vec3_sub(cameraPos, cameraPos, result);
+        vec3_scale(result, front, cameraSpeed);
+        vec3_sub(camera->position, camera->position, result);
     }
 
     if (currentKeyStates[SDL_SCANCODE_A]) {
         vec3 result;
-        vec3_mul_cross(result, cameraFront, cameraUp);
+        vec3_mul_cross(result, front, cameraUp);
         vec3 normalized;
         vec3_norm(normalized, result);
         vec3 final;
         vec3_scale(final, normalized, cameraSpeed);
-        vec3_sub(cameraPos, cameraPos, final);
+        vec3_sub(camera->position, camera->position, final);
     } else if (currentKeyStates[SDL_SCANCODE_D]) {
         vec3 result;
-        vec3_mul_cross(result, cameraFront, cameraUp);
+        vec3_mul_cross(result, front, cameraUp);
         vec3 normalized;
         vec3_norm(normalized, result);
         vec3 final;
         vec3_scale(final, normalized, cameraSpeed);
-        vec3_add(cameraPos, cameraPos, final);
+        vec3_add(camera->position, camera->position, final);
     }
 
-    const float sensitivity = 2.0f;
+    const float sensitivity = CAMERA_TURN_SPEED * dt;
     if (currentKeyStates[SDL_SCANCODE_LEFT]) {
-        yaw -= sensitivity;
+        camera->yaw -= sensitivity;
 
     } else if (currentKeyStates[SDL_SCANCODE_RIGHT]) {
-        yaw += sensitivity;
+        camera->yaw += sensitivity;
     }
 
     if (currentKeyStates[SDL_SCANCODE_UP]) {
-        pitch += sensitivity;
+        camera->pitch += sensitivity;
 
-        if (pitch > 89.0f)
-            pitch = 89.0f;
+        if (camera->pitch > 89.0f)
+            camera->pitch = 89.0f;
     } else if (currentKeyStates[SDL_SCANCODE_DOWN]) {
-        pitch -= sensitivity;
+        camera->pitch -= sensitivity;
 
-        if (pitch < -89.0f)
-            pitch = -89.0f;
+        if (camera->pitch < -89.0f)
+            camera->pitch = -89.0f;
     }
+}
 
-    vec3 direction;
-    direction[0] = cos(yaw * (M_PI / 180)) * cos(pitch * (M_PI / 180));
-    direction[1] = sin(pitch * (M_PI / 180));
-    direction[2] = sin(yaw * (M_PI / 180)) * cos(pitch * (M_PI / 180));
-    vec3_norm(cameraFront, direction);
+// blends the last two simulation steps into the camera that gets rendered
+void interpolateCamera(float alpha) {
+    vec3 delta;
+    vec3_sub(delta, currentCamera.position, previousCamera.position);
+    vec3_scale(delta, delta, alpha);
+    vec3_add(cameraPos, previousCamera.position, delta);
+
+    float yaw = previousCamera.yaw + (currentCamera.yaw - previousCamera.yaw) * alpha;
+    float pitch = previousCamera.pitch + (currentCamera.pitch - previousCamera.pitch) * alpha;
+    cameraDirection(cameraFront, yaw, pitch);
+}
+
+void setupFrameView(FrameView* frame) {
+    mat4x4_perspective(frame->projection, fov * (M_PI / 180), (float)WIDTH / (float)HEIGHT, Z_NEAR, Z_FAR);
+
+    vec3 cameraOrigin;
+    vec3_add(cameraOrigin, cameraPos, cameraFront);
+    mat4x4_look_at(frame->view, cameraPos, cameraOrigin, cameraUp);
+
+    mat4x4_identity(frame->model);
+    mat4x4_translate(frame->model, 0.0f, 0.0f, -5.0f);
+
+    vec3_dup(frame->position, cameraPos);
+    vec3_dup(frame->front, cameraFront);
+}
+
+// renders the same fixed view with every renderer, GPU synced per frame so the numbers are comparable
+void benchmarkRenderers(Renderer* renderer, Model* model, SDL_Window* window, int frames) {
+    RendererType types[] = {RENDERER_FORWARD, RENDERER_DEFERRED};
+    RendererType initialType = renderer->type;
+
+    SDL_GL_SetSwapInterval(0);
+
+    for (unsigned int t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        setRendererType(renderer, types[t]);
+
+        FrameView frame;
+        setupFrameView(&frame);
+
+        // warm up so shader compilation and first uploads stay out of the timing
+        for (int i = 0; i < 10; i++) {
+            renderFrame(renderer, model, pointLights, numPointLights, &frame);
+            SDL_GL_SwapWindow(window);
+        }
+        glFinish();
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < frames; i++) {
+            renderFrame(renderer, model, pointLights, numPointLights, &frame);
+            SDL_GL_SwapWindow(window);
+            glFinish();
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+
+        double ms = (double)(end - start) * 1000.0 / SDL_GetPerformanceFrequency() / frames;
+        printf("Benchmark %-8s %u lights: %.3f ms/frame (%d frames)\n", rendererName(types[t]), numPointLights, ms, frames);
+    }
+
+    setRendererType(renderer, initialType);
+}
+
+// loads and unloads the model repeatedly, mesh and texture memory has to end up where it started
+bool testModelReload(Model* model, char* path, int rounds) {
+    MemoryCategory categories[] = {MEMORY_MESH_CPU, MEMORY_MESH_GPU, MEMORY_TEXTURE_GPU};
+    const int numCategories = sizeof(categories) / sizeof(categories[0]);
+
+    unloadModel(model);
+    long long baseline[sizeof(categories) / sizeof(categories[0])];
+    for (int c = 0; c < numCategories; c++) {
+        baseline[c] = memoryLive(categories[c]);
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < rounds; i++) {
+        *model = loadModel(path);
+        unloadModel(model);
+    }
+    double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency() / rounds;
+
+    bool passed = true;
+    for (int c = 0; c < numCategories; c++) {
+        if (memoryLive(categories[c]) != baseline[c]) {
+            printf("Model reload leaked %lld bytes of %s\n", memoryLive(categories[c]) - baseline[c], memoryCategoryName(categories[c]));
+            passed = false;
+        }
+    }
+    printf("Model reload %s: %d rounds, %.2f ms per load and unload\n", passed ? "passed" : "FAILED", rounds, ms);
+
+    *model = loadModel(path);
+    return passed;
 }
 
 int main(int argc, char *argv[]) {
+    initStartupProfiler();
+    int extraLights = 0;
+    int benchFrames = 0;
+    RendererType rendererType = RENDERER_FORWARD;
+    DepthPrepassMode prepassMode = DEPTH_PREPASS_AUTO;
+    bool occlusion = true;
+    bool streaming = true;
+    bool packing = false;
+    bool bindless = false;
+    int drawBenchFrames = 0;
+    int textureBudget = STREAMING_DEFAULT_BUDGET_MIB;
+    int frameRate = FRAME_PACER_DEFAULT_RATE;
+    int numWorkers = -1;
+    int jobTestRounds = 0;
+    bool jobBench = false;
+    const char* telemetryPath = NULL;
+    double frameBudget = 0.0;
+    int reloadRounds = 0;
+    int shaderBenchRounds = 0;
+    int mathTestRounds = 0;
+    int occlusionTestRounds = 0;
+    bool occlusionBench = false;
+    bool mathBench = false;
+    int transformBenchObjects = 0;
+    bool shaderReload = true;
+    bool lazyMaterials = true;
+    const char* packPath = NULL;
+    const char* lzBenchPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-lights") == 0 && i + 1 < argc) {
+            extraLights = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-renderer") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "deferred") == 0) {
+                rendererType = RENDERER_DEFERRED;
+            } else if (strcmp(argv[i], "forward") != 0) {
+                printf("Unknown renderer %s, using forward\n", argv[i]);
+            }
+        } else if (strcmp(argv[i], "-prepass") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "on") == 0) {
+                prepassMode = DEPTH_PREPASS_ON;
+            } else if (strcmp(argv[i], "off") == 0) {
+                prepassMode = DEPTH_PREPASS_OFF;
+            }
+        } else if (strcmp(argv[i], "-occlusion") == 0 && i + 1 < argc) {
+            occlusion = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "-streaming") == 0 && i + 1 < argc) {
+            streaming = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "-texpack") == 0 && i + 1 < argc) {
+            packing = strcmp(argv[++i], "on") == 0;
+        } else if (strcmp(argv[i], "-materials") == 0 && i + 1 < argc) {
+            bindless = strcmp(argv[++i], "bindless") == 0;
+        } else if (strcmp(argv[i], "-drawbench") == 0 && i + 1 < argc) {
+            drawBenchFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-texbudget") == 0 && i + 1 < argc) {
+            textureBudget = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-mipfilter") == 0 && i + 1 < argc) {
+            textureMipFilter = strcmp(argv[++i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+        } else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc) {
+            // 0 or "uncapped" disables the limiter
+            frameRate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-workers") == 0 && i + 1 < argc) {
+            numWorkers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jobtest") == 0 && i + 1 < argc) {
+            jobTestRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jobbench") == 0) {
+            jobBench = true;
+        } else if (strcmp(argv[i], "-telemetry") == 0 && i + 1 < argc) {
+            telemetryPath = argv[++i];
+        } else if (strcmp(argv[i], "-budget") == 0 && i + 1 < argc) {
+            frameBudget = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-membudget") == 0 && i + 2 < argc) {
+            // -membudget texture_gpu 256, in MiB, repeatable
+            int category = memoryCategoryFromName(argv[++i]);
+            long long budget = atoll(argv[++i]) * 1024 * 1024;
+            if (category < 0) {
+                printf("Unknown memory category %s\n", argv[i - 1]);
+            } else {
+                setMemoryBudget(category, budget);
+            }
+        } else if (strcmp(argv[i], "-mathtest") == 0 && i + 1 < argc) {
+            mathTestRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-mathbench") == 0) {
+            mathBench = true;
+        } else if (strcmp(argv[i], "-occlusiontest") == 0 && i + 1 < argc) {
+            occlusionTestRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-occlusionbench") == 0) {
+            occlusionBench = true;
+        } else if (strcmp(argv[i], "-pack") == 0 && i + 1 < argc) {
+            packPath = argv[++i];
+        } else if (strcmp(argv[i], "-lzbench") == 0 && i + 1 < argc) {
+            lzBenchPath = argv[++i];
+        } else if (strcmp(argv[i], "-lazymaterials") == 0 && i + 1 < argc) {
+            lazyMaterials = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "-hotreload") == 0 && i + 1 < argc) {
+            shaderReload = strcmp(argv[++i], "off") != 0;
+        } else if (strcmp(argv[i], "-transformbench") == 0 && i + 1 < argc) {
+            // 0 for the default object count
+            transformBenchObjects = atoi(argv[++i]);
+            transformBenchObjects = transformBenchObjects > 0 ? transformBenchObjects : TRANSFORM_BENCH_OBJECTS;
+        } else if (strcmp(argv[i], "-shaderbench") == 0 && i + 1 < argc) {
+            shaderBenchRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-startupbudget") == 0 && i + 2 < argc) {
+            // -startupbudget model 400, in ms, "total" for up to the first frame, repeatable
+            const char* phase = argv[++i];
+            setStartupBudget(phase, atof(argv[++i]));
+        } else if (strcmp(argv[i], "-reloadtest") == 0 && i + 1 < argc) {
+            reloadRounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-bench") == 0 && i + 1 < argc) {
+            benchFrames = atoi(argv[++i]);
+        }
+    }
+
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    // same depth format as the G-buffer, depth blits need an exact match
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 
+    beginStartupPhase("sdl init");
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
         return -1;
     }
 
+    initJobSystem(numWorkers);
+    printf("Job system: %d workers\n", jobWorkerCount());
+    endStartupPhase();
+
+    // job system, math, occlusion and compression checks need no window
+    if (jobTestRounds > 0 || jobBench || mathTestRounds > 0 || mathBench || transformBenchObjects > 0 || lzBenchPath ||
+        occlusionTestRounds > 0 || occlusionBench) {
+        bool passed = jobTestRounds > 0 ? testJobSystem(jobTestRounds) : true;
+        if (jobBench) {
+            benchmarkJobSystem();
+        }
+        if (mathTestRounds > 0) {
+            passed = testLinmath(mathTestRounds) && passed;
+        }
+        if (mathBench) {
+            benchmarkLinmath();
+        }
+        if (transformBenchObjects > 0) {
+            passed = benchmarkTransforms(transformBenchObjects) && passed;
+        }
+        if (occlusionTestRounds > 0) {
+            passed = testOcclusion(occlusionTestRounds) && passed;
+        }
+        if (occlusionBench) {
+            benchmarkOcclusion();
+        }
+        if (lzBenchPath) {
+            passed = io_benchmark_compression(lzBenchPath, IO_LZ_BENCH_ROUNDS) && passed;
+        }
+        freeJobSystem();
+        SDL_Quit();
+        return passed ? 0 : 1;
+    }
+
+    beginStartupPhase("window");
     SDL_Window *window = SDL_CreateWindow(
             "Learn openGL",
             SDL_WINDOWPOS_CENTERED,
@@ -122,6 +411,9 @@ int main(int argc, char *argv[]) {
     }
 
     SDL_GL_CreateContext(window);
+    endStartupPhase();
+
+    beginStartupPhase("gl loading");
     if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
         printf("Failed to load GL: %s\n", SDL_GetError());
         return -1;
@@ -131,56 +423,13 @@ int main(int argc, char *argv[]) {
     printf("Vendor:  %s\n", glGetString(GL_VENDOR));
     printf("Renderer:  %s\n", glGetString(GL_RENDERER));
     printf("Version:  %s\n", glGetString(GL_VERSION));
+    loadGLExtensions();
+    endStartupPhase();
     // stuff below causes seg fault for some reason
     //int numAttributes;
     //glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &numAttributes);
     //printf("Maximum number of vertex attribs supports: %s\n", numAttributes);
 
-    float vertices[] = {
-		// positions          // normals           // texture coords
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-		0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-		0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
-		0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-		0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-		0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-		0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-		0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-		0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
-		0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-		0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-		0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
-		0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-		0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
-	};
-
     glViewport(0, 0, WIDTH, HEIGHT);
 
     // wireframe rendering
@@ -190,130 +439,134 @@ int main(int argc, char *argv[]) {
 
     SDL_ShowCursor(false);
 
-    unsigned int shader_default = RenderShaderCreate("./shaders/default.vert", "./shaders/default.frag");
-    unsigned int shader_light = RenderShaderCreate("./shaders/light.vert", "./shaders/light.frag");
+    // files in the pack shadow the loose ones, edits to those would never be seen
+    if (packPath) {
+        beginStartupPhase("asset pack");
+        if (initVfs(packPath) && shaderReload) {
+            printf("Shader reload: off, shaders come from %s\n", packPath);
+            shaderReload = false;
+        }
+        endStartupPhase();
+    }
 
-    printf("Loading model...\n");
-    Model model = loadModel("./assets/backpack/backpack.obj");
-    printf("model loaded.\n");
+    // packed textures are fully resident, they replace streaming
+    if (packing) {
+        enableTexturePacking();
+        streaming = false;
+    }
+    // bindless handles freeze their textures, streamed ones change levels; arrays keep the bind path
+    if ((bindless || drawBenchFrames > 0) && !packing) {
+        streaming = false;
+    }
 
-    glUseProgram(shader_default);
+    // the startup programs compile while the model and its textures load
+    beginStartupPhase("renderer");
+    beginShaderBatch();
+    Renderer renderer = initRenderer(rendererType, WIDTH, HEIGHT, Z_NEAR, Z_FAR);
+    setDepthPrepassMode(&renderer, prepassMode);
+    renderer.occlusionEnabled = occlusion;
+    printf("Using %s renderer\n", rendererName(renderer.type));
+    if (shaderReload && initShaderReload(SHADER_RELOAD_DIRECTORY)) {
+        watchRendererShaders(&renderer);
+    }
+    endStartupPhase();
 
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
+    if (streaming) {
+        initTextureStreaming((size_t)textureBudget * 1024 * 1024);
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // arrays (-texpack on) and the bindless table (-materials bindless) are built from every texture at once
+    setLazyMaterials(lazyMaterials && !packing && !bindless && drawBenchFrames == 0);
 
-    unsigned int lightVAO;
-    glGenVertexArrays(1, &lightVAO);
-    glBindVertexArray(lightVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    beginStartupPhase("model");
+    printf("Loading model...\n");
+    char* modelPath = "./assets/backpack/backpack.obj";
+    Model model = loadModel(modelPath);
+    printf("model loaded.\n");
+    // before packing and bindless tables start referencing the model's textures
+    if (reloadRounds > 0) {
+        testModelReload(&model, modelPath, reloadRounds);
+    }
+    if (packing) {
+        packModelTextures(&model);
+        reportTexturePacking();
+    }
+    endStartupPhase();
+
+    // failures are logged like unbatched ones and the renderer keeps going
+    beginStartupPhase("shader batch");
+    finishShaderBatch();
+    bindRendererShaders(&renderer);
+    endStartupPhase();
+    if (shaderBenchRounds > 0) {
+        benchmarkShaderCompile(shaderBenchRounds);
+        should_quit = true;
+    }
+    beginStartupPhase("materials");
+    if ((bindless || drawBenchFrames > 0) && !packing && initBindlessMaterials(&model)) {
+        setBindlessMaterials(bindless);
+        reloadMaterialShaders(&renderer);
+    }
+    reportTextureCache();
+    reportShaderCache();
+    reportVfs();
+    reportMemory("after loading");
+    selectOccluders(&model, OCCLUSION_MAX_TRIANGLES);
+    endStartupPhase();
 
     float rotTimer = 0.0f;
 
-    // directional lighting
-    unsigned int lightDirection = glGetUniformLocation(shader_default, "dirLight.direction");
-    glUniform3f(lightDirection, -0.2f, -1.0f, -0.3f);
-
-    float pointLightPositions[] = {
-         0.7f,  0.2f,  2.0f,
-         2.3f, -3.3f, -4.0f,
-        -4.0f,  2.0f, -12.0f,
-         0.0f,  0.0f, -3.0f
-    };
-
-    unsigned int pointLightPos0 = glGetUniformLocation(shader_default, "pointLights[0].position");
-    glUniform3f(pointLightPos0, pointLightPositions[0], pointLightPositions[1], pointLightPositions[2]);
-
-    unsigned int pointLightAmbient0 = glGetUniformLocation(shader_default, "pointLights[0].ambient");
-    glUniform3f(pointLightAmbient0, 0.05f, 0.05f, 0.05f);
-
-    unsigned int pointLightDiffuse0 = glGetUniformLocation(shader_default, "pointLights[0].diffuse");
-    glUniform3f(pointLightDiffuse0, 0.8f, 0.8f, 0.8f);
-
-    unsigned int pointLightSpecular0 = glGetUniformLocation(shader_default, "pointLights[0].specular");
-    glUniform3f(pointLightSpecular0, 1.0f, 1.0f, 1.0f);
-
-    unsigned int pointLightConstant0 = glGetUniformLocation(shader_default, "pointLights[0].constant");
-    glUniform1f(pointLightConstant0, 1.0f);
-
-    unsigned int pointLightLinear0 = glGetUniformLocation(shader_default, "pointLights[0].linear");
-    glUniform1f(pointLightLinear0, 0.09f);
-
-    unsigned int pointLightQuadratic0 = glGetUniformLocation(shader_default, "pointLights[0].quadratic");
-    glUniform1f(pointLightQuadratic0, 0.032f);
-
-
-    unsigned int pointLightPos1 = glGetUniformLocation(shader_default, "pointLights[1].position");
-    glUniform3f(pointLightPos1, pointLightPositions[3], pointLightPositions[4], pointLightPositions[5]);
-
-    unsigned int pointLightAmbient1 = glGetUniformLocation(shader_default, "pointLights[1].ambient");
-    glUniform3f(pointLightAmbient1, 0.05f, 0.05f, 0.05f);
-
-    unsigned int pointLightDiffuse1 = glGetUniformLocation(shader_default, "pointLights[1].diffuse");
-    glUniform3f(pointLightDiffuse1, 0.8f, 0.8f, 0.8f);
-
-    unsigned int pointLightSpecular1 = glGetUniformLocation(shader_default, "pointLights[1].specular");
-    glUniform3f(pointLightSpecular1, 1.0f, 1.0f, 1.0f);
-
-    unsigned int pointLightConstant1 = glGetUniformLocation(shader_default, "pointLights[1].constant");
-    glUniform1f(pointLightConstant1, 1.0f);
-
-    unsigned int pointLightLinear1 = glGetUniformLocation(shader_default, "pointLights[1].linear");
-    glUniform1f(pointLightLinear1, 0.09f);
-
-    unsigned int pointLightQuadratic1 = glGetUniformLocation(shader_default, "pointLights[1].quadratic");
-    glUniform1f(pointLightQuadratic1, 0.032f);
-
-
-    unsigned int pointLightPos2 = glGetUniformLocation(shader_default, "pointLights[2].position");
-    glUniform3f(pointLightPos2, pointLightPositions[6], pointLightPositions[7], pointLightPositions[8]);
-
-    unsigned int pointLightAmbient2 = glGetUniformLocation(shader_default, "pointLights[2].ambient");
-    glUniform3f(pointLightAmbient2, 0.05f, 0.05f, 0.05f);
-
-    unsigned int pointLightDiffuse2 = glGetUniformLocation(shader_default, "pointLights[2].diffuse");
-    glUniform3f(pointLightDiffuse2, 0.8f, 0.8f, 0.8f);
-
-    unsigned int pointLightSpecular2 = glGetUniformLocation(shader_default, "pointLights[2].specular");
-    glUniform3f(pointLightSpecular2, 1.0f, 1.0f, 1.0f);
-
-    unsigned int pointLightConstant2 = glGetUniformLocation(shader_default, "pointLights[2].constant");
-    glUniform1f(pointLightConstant2, 1.0f);
-
-    unsigned int pointLightLinear2 = glGetUniformLocation(shader_default, "pointLights[2].linear");
-    glUniform1f(pointLightLinear2, 0.09f);
-
-    unsigned int pointLightQuadratic2 = glGetUniformLocation(shader_default, "pointLights[2].quadratic");
-    glUniform1f(pointLightQuadratic2, 0.032f);
-
-
-    unsigned int pointLightPos3 = glGetUniformLocation(shader_default, "pointLights[3].position");
-    glUniform3f(pointLightPos3, pointLightPositions[9], pointLightPositions[10], pointLightPositions[11]);
-
-    unsigned int pointLightAmbient3 = glGetUniformLocation(shader_default, "pointLights[3].ambient");
-    glUniform3f(pointLightAmbient3, 0.05f, 0.05f, 0.05f);
-
-    unsigned int pointLightDiffuse3 = glGetUniformLocation(shader_default, "pointLights[3].diffuse");
-    glUniform3f(pointLightDiffuse3, 0.8f, 0.8f, 0.8f);
+    beginStartupPhase("lights");
+    addPointLight( 0.7f,  0.2f,   2.0f, 1.0f, 0.09f, 0.032f, 1.0f, 1.0f, 1.0f);
+    addPointLight( 2.3f, -3.3f,  -4.0f, 1.0f, 0.09f, 0.032f, 1.0f, 1.0f, 1.0f);
+    addPointLight(-4.0f,  2.0f, -12.0f, 1.0f, 0.09f, 0.032f, 1.0f, 1.0f, 1.0f);
+    addPointLight( 0.0f,  0.0f,  -3.0f, 1.0f, 0.09f, 0.032f, 1.0f, 1.0f, 1.0f);
+
+    // small colored lights scattered around the model, for stress testing the clusters
+    srand(1);
+    for (int i = 0; i < extraLights; i++) {
+        addPointLight(randomRange(-20.0f, 20.0f), randomRange(-5.0f, 5.0f), randomRange(-30.0f, 10.0f),
+                      1.0f, 1.5f, 25.0f,
+                      randomRange(0.0f, 0.6f), randomRange(0.0f, 0.6f), randomRange(0.0f, 0.6f));
+    }
+    printf("%u point lights\n", numPointLights);
+    endStartupPhase();
 
-    unsigned int pointLightSpecular3 = glGetUniformLocation(shader_default, "pointLights[3].specular");
-    glUniform3f(pointLightSpecular3, 1.0f, 1.0f, 1.0f);
+    if (benchFrames > 0) {
+        benchmarkRenderers(&renderer, &model, window, benchFrames);
+        should_quit = true;
+    }
 
-    unsigned int pointLightConstant3 = glGetUniformLocation(shader_default, "pointLights[3].constant");
-    glUniform1f(pointLightConstant3, 1.0f);
+    if (drawBenchFrames > 0) {
+        FrameView frame;
+        setupFrameView(&frame);
+        benchmarkDrawCalls(&renderer, &model, &frame, drawBenchFrames);
+        should_quit = true;
+    }
 
-    unsigned int pointLightLinear3 = glGetUniformLocation(shader_default, "pointLights[3].linear");
-    glUniform1f(pointLightLinear3, 0.09f);
+    if (frameRate > 0) {
+        printf("Frame rate capped at %d fps, simulation at %d Hz\n", frameRate, SIMULATION_RATE);
+    } else {
+        printf("Frame rate uncapped, simulation at %d Hz\n", SIMULATION_RATE);
+    }
+    FixedTimestep timestep = initFixedTimestep(SIMULATION_RATE);
+    if (telemetryPath) {
+        // the frame budget defaults to the target frame time, or 60 fps when uncapped
+        if (frameBudget <= 0.0) {
+            frameBudget = 1000.0 / (frameRate > 0 ? frameRate : 60);
+        }
+        initTelemetry(telemetryPath, frameBudget);
+    }
+    FramePacer pacer = initFramePacer(frameRate);
+    unsigned int frameCount = 0;
+    bool startupPassed = true;
 
-    unsigned int pointLightQuadratic3 = glGetUniformLocation(shader_default, "pointLights[3].quadratic");
-    glUniform1f(pointLightQuadratic3, 0.032f);
+    // closed by reportStartup once the first frame is presented
+    beginStartupPhase("first frame");
 
-    next_time = SDL_GetTicks() + TICK_INTERVAL;
     while (!should_quit) {
+        beginTelemetryFrame();
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             switch (event.type) {
@@ -325,113 +578,59 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        input_handler();
-
-        rotTimer++;
-
-        // render begin
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(shader_default);
-
-        unsigned int spotLightPos = glGetUniformLocation(shader_default, "spotLight.position");
-        glUniform3f(spotLightPos, cameraPos[0], cameraPos[1], cameraPos[2]);
-
-        unsigned int spotLightDir = glGetUniformLocation(shader_default, "spotLight.direction");
-        glUniform3f(spotLightDir, cameraFront[0], cameraFront[1], cameraFront[2]);
-
-        unsigned int spotLightAmbient = glGetUniformLocation(shader_default, "spotLight.ambient");
-        glUniform3f(spotLightAmbient, 0.0f, 0.0f, 0.0f);
-
-        unsigned int spotLightDiffuse = glGetUniformLocation(shader_default, "spotLight.diffuse");
-        glUniform3f(spotLightDiffuse, 1.0f, 1.0f, 1.0f);
-
-        unsigned int spotLightSpecular = glGetUniformLocation(shader_default, "spotLight.specular");
-        glUniform3f(spotLightSpecular, 1.0f, 1.0f, 1.0f);
-
-        unsigned int spotLightConstant = glGetUniformLocation(shader_default, "spotLight.constant");
-        glUniform1f(spotLightConstant, 1.0f);
-
-        unsigned int spotLightLinear = glGetUniformLocation(shader_default, "spotLight.linear");
-        glUniform1f(spotLightLinear, 0.09f);
-
-        unsigned int spotLightQuadratic = glGetUniformLocation(shader_default, "spotLight.quadratic");
-        glUniform1f(spotLightQuadratic, 0.032f);
-
-        unsigned int spotLightCutOff = glGetUniformLocation(shader_default, "spotLight.cutOff");
-        glUniform1f(spotLightCutOff, cos(12.5f * (M_PI / 180)));
-
-        unsigned int spotLightOuterCutOff = glGetUniformLocation(shader_default, "spotLight.outerCutOff");
-        glUniform1f(spotLightOuterCutOff, cos(17.5f * (M_PI / 180)));
-
-        unsigned int shininess = glGetUniformLocation(shader_default, "material.shininess");
-        glUniform1f(shininess, 64.0f);
+        // programs only change between frames, a compile in flight never holds the frame up
+        updateShaderReload();
 
-
-        unsigned int viewPos = glGetUniformLocation(shader_default, "viewPos");
-        glUniform3f(viewPos, cameraPos[0], cameraPos[1], cameraPos[2]);
-
-        mat4x4 projection;
-        mat4x4_perspective(projection, fov * (M_PI / 180), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
-
-        unsigned int projectionLoc = glGetUniformLocation(shader_default, "projection");
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (const GLfloat*)projection);
-
-        mat4x4 view;
-        vec3 cameraOrigin;
-        vec3_add(cameraOrigin, cameraPos, cameraFront);
-        mat4x4_look_at(view, cameraPos, cameraOrigin, cameraUp);
-
-        unsigned int viewLoc = glGetUniformLocation(shader_default, "view");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (const GLfloat*)view);
-
-        mat4x4 objectModel;
-        mat4x4_identity(objectModel);
-        mat4x4_translate(objectModel, 0.0f, 0.0f, -5.0f);
-
-        unsigned int modelLoc = glGetUniformLocation(shader_default, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (const GLfloat*)objectModel);
-
-        assert(glGetError() == GL_NO_ERROR);
-        drawModel(&model, shader_default);
-        assert(glGetError() == GL_NO_ERROR);
-
-        glUseProgram(shader_light);
-
-        unsigned int lightProjectionLoc = glGetUniformLocation(shader_light, "projection");
-        glUniformMatrix4fv(lightProjectionLoc, 1, GL_FALSE, (const GLfloat*)projection);
-
-        unsigned int lightViewLoc = glGetUniformLocation(shader_light, "view");
-        glUniformMatrix4fv(lightViewLoc, 1, GL_FALSE, (const GLfloat*)view);
-
-        glBindVertexArray(lightVAO);
-        for (int i = 0; i < 4; i++) {
-
-            mat4x4 lightModel;
-            mat4x4_identity(lightModel);
-            mat4x4_translate(lightModel, pointLightPositions[i * 3], pointLightPositions[i * 3 + 1], pointLightPositions[i * 3 +2]);
-            // for whatever reason only the aniso func works
-            mat4x4_scale_aniso(lightModel, lightModel, 0.2f, 0.2f, 0.2f);
-
-            unsigned int lightModelLoc = glGetUniformLocation(shader_light, "model");
-            glUniformMatrix4fv(lightModelLoc, 1, GL_FALSE, (const GLfloat*)lightModel);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        int steps = advanceFixedTimestep(&timestep);
+        for (int i = 0; i < steps; i++) {
+            previousCamera = currentCamera;
+            input_handler(&currentCamera, (float)fixedTimestepSeconds(&timestep));
+            rotTimer += (float)fixedTimestepSeconds(&timestep);
         }
+        interpolateCamera(fixedTimestepAlpha(&timestep));
+        markTelemetryPhase(TELEMETRY_INPUT);
 
-        glBindVertexArray(0);
+        // render begin
+        FrameView frame;
+        setupFrameView(&frame);
+        renderFrame(&renderer, &model, pointLights, numPointLights, &frame);
 
         // render end; swaps buffers aka renders changes
         SDL_GL_SwapWindow(window);
+        markTelemetryPhase(TELEMETRY_SWAP);
+        if (frameCount == 0 && !reportStartup()) {
+            startupPassed = false;
+            should_quit = true;
+        }
 
-        SDL_Delay(time_left());
-        next_time += TICK_INTERVAL;
+        waitFramePacer(&pacer);
+        markTelemetryPhase(TELEMETRY_WAIT);
+        if (++frameCount % FRAME_PACER_REPORT_INTERVAL == 0) {
+            reportFramePacer(&pacer);
+            if (timestep.droppedSeconds > 0.0) {
+                printf("Simulation dropped %.2f s behind\n", timestep.droppedSeconds);
+            }
+        }
     }
 
+    reportMemory("at exit");
+    freeShaderReload();
+    freeRenderer(&renderer);
+    freeShaderCache();
+    freeBindlessMaterials();
+    unloadModel(&model);
+    freeLazyMaterials();
+    freeTextureStreaming();
+    freeTexturePacking();
+    freeVfs();
+    reportJobSystem();
+    freeJobSystem();
+    freeTelemetry();
+    freeMemoryTracking();
+
     SDL_DestroyWindow(window);
 
     SDL_Quit();
 
-    return 0;
+    return startupPassed ? 0 : 1;
 }
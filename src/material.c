@@ -0,0 +1,119 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "material.h"
+#include "memtrack.h"
+#include "texcache.h"
+#include "glext.h"
+
+static MaterialTable materials = {0};
+
+static unsigned int createDefaultTexture(void) {
+    unsigned char white[4] = {255, 255, 255, 255};
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, texture, MEMORY_TEXTURE_GPU, sizeof(white));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+// first map of the given type, the shaders sample no more than that
+static unsigned int firstTexture(const Mesh* mesh, const char* type) {
+    for (unsigned int i = 0; i < mesh->numTextures; i++) {
+        if (strcmp(type, mesh->textures[i].type) == 0 && mesh->textures[i].id != 0) {
+            return mesh->textures[i].id;
+        }
+    }
+    return materials.defaultTexture;
+}
+
+bool initBindlessMaterials(Model* model) {
+    if (!glExt.bindlessTexture) {
+        printf("Bindless textures not supported, using texture binds\n");
+        return false;
+    }
+
+    materials.defaultTexture = createDefaultTexture();
+
+    // diffuse and specular texture per material, deduplicated
+    unsigned int (*textures)[2] = calloc(MATERIAL_MAX, sizeof(*textures));
+    GLuint64* handles = calloc(MATERIAL_MAX * 2, sizeof(GLuint64));
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* mesh = &model->meshes[i];
+        unsigned int diffuse = firstTexture(mesh, "texture_diffuse");
+        unsigned int specular = firstTexture(mesh, "texture_specular");
+
+        unsigned int id = 0;
+        while (id < materials.numMaterials && (textures[id][0] != diffuse || textures[id][1] != specular)) {
+            id++;
+        }
+
+        if (id == materials.numMaterials) {
+            if (materials.numMaterials == MATERIAL_MAX) {
+                printf("Error: More than %d materials, sharing the last one\n", MATERIAL_MAX);
+                id = MATERIAL_MAX - 1;
+            } else {
+                textures[id][0] = diffuse;
+                textures[id][1] = specular;
+                handles[id * 2] = residentTextureHandle(diffuse);
+                handles[id * 2 + 1] = residentTextureHandle(specular);
+                materials.numMaterials++;
+            }
+        }
+
+        mesh->materialId = id;
+    }
+
+    glGenBuffers(1, &materials.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, materials.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, MATERIAL_MAX * 2 * sizeof(GLuint64), handles, GL_STATIC_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, materials.ubo, MEMORY_RENDER_GPU, MATERIAL_MAX * 2 * sizeof(GLuint64));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    free(textures);
+    free(handles);
+
+    printf("Bindless materials: %u materials, %u resident handles\n", materials.numMaterials, textureCacheStats.numResidentHandles);
+
+    materials.ready = true;
+    materials.active = true;
+    return true;
+}
+
+void setBindlessMaterials(bool enabled) {
+    materials.active = enabled && materials.ready;
+}
+
+bool bindlessMaterialsActive(void) {
+    return materials.active;
+}
+
+void bindMaterialTable(unsigned int shader) {
+    unsigned int block = glGetUniformBlockIndex(shader, "Materials");
+    if (block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader, block, MATERIAL_UBO_BINDING);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_UBO_BINDING, materials.ubo);
+}
+
+void freeBindlessMaterials(void) {
+    if (!materials.ready) {
+        return;
+    }
+
+    releaseTextureHandles();
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, materials.ubo);
+    untrackGpuObject(MEMORY_OBJECT_TEXTURE, materials.defaultTexture);
+    glDeleteBuffers(1, &materials.ubo);
+    glDeleteTextures(1, &materials.defaultTexture);
+    materials = (MaterialTable){0};
+}
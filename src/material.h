@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "model.h"
+
+// one uvec4 per material (diffuse and specular handle), fits the 16 KiB minimum uniform block size
+#define MATERIAL_MAX 1024
+#define MATERIAL_UBO_BINDING 1
+
+typedef struct materialTable {
+    unsigned int ubo;
+    unsigned int numMaterials;
+    // 1x1 white, stands in for missing maps
+    unsigned int defaultTexture;
+    bool ready;
+    bool active;
+} MaterialTable;
+
+// assigns material ids and uploads the handle table, false when bindless textures are unavailable
+bool initBindlessMaterials(Model* model);
+void setBindlessMaterials(bool enabled);
+bool bindlessMaterialsActive(void);
+void bindMaterialTable(unsigned int shader);
+void freeBindlessMaterials(void);
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <linmath.h>
+#include <SDL2/SDL.h>
+
+#include "mathtest.h"
+
+typedef struct mathTestResult {
+    const char* name;
+    unsigned int numCases;
+    unsigned int numDiffering;
+    double maxError;
+    double bound;
+} MathTestResult;
+
+static uint32_t randomState = 1;
+
+static float randomFloat(float min, float max) {
+    // xorshift, reproducible across platforms unlike rand()
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return min + (max - min) * (float)(randomState >> 8) / (float)(1 << 24);
+}
+
+static void randomMatrix(mat4x4 M, float range) {
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            M[c][r] = randomFloat(-range, range);
+        }
+    }
+}
+
+// rotation, anisotropic scale and translation, the kind of matrix a scene holds
+static void randomTransform(mat4x4 M) {
+    mat4x4 identity, rotated;
+    mat4x4_identity(identity);
+    mat4x4_rotate(rotated, identity, randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(0.1f, 1.0f),
+                  randomFloat(-3.14f, 3.14f));
+    mat4x4_scale_aniso(M, rotated, randomFloat(0.25f, 4.0f), randomFloat(0.25f, 4.0f), randomFloat(0.25f, 4.0f));
+    M[3][0] = randomFloat(-100.0f, 100.0f);
+    M[3][1] = randomFloat(-100.0f, 100.0f);
+    M[3][2] = randomFloat(-100.0f, 100.0f);
+}
+
+static void recordError(MathTestResult* result, float simd, float scalar, double scale) {
+    if (simd != scalar) {
+        result->numDiffering++;
+    }
+    double error = fabs((double)simd - (double)scalar) / (FLT_EPSILON * (scale > FLT_MIN ? scale : FLT_MIN));
+    result->maxError = error > result->maxError ? error : result->maxError;
+}
+
+static void testMul(MathTestResult* result) {
+    mat4x4 a, b, simd, scalar;
+    randomMatrix(a, 2.0f);
+    randomMatrix(b, 2.0f);
+    mat4x4_mul(simd, a, b);
+    mat4x4_mul_scalar(scalar, a, b);
+
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            double scale = 0.0;
+            for (int k = 0; k < 4; k++) {
+                scale += fabs((double)a[k][r] * b[c][k]);
+            }
+            recordError(result, simd[c][r], scalar[c][r], scale);
+        }
+    }
+
+    // the result may alias either input
+    mat4x4_mul(a, a, b);
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            if (a[c][r] != simd[c][r]) {
+                result->maxError = INFINITY;
+            }
+        }
+    }
+    result->numCases++;
+}
+
+static void testMulVec4(MathTestResult* result) {
+    mat4x4 M;
+    vec4 v, simd, scalar;
+    randomMatrix(M, 2.0f);
+    for (int i = 0; i < 4; i++) {
+        v[i] = randomFloat(-100.0f, 100.0f);
+    }
+    mat4x4_mul_vec4(simd, M, v);
+    mat4x4_mul_vec4_scalar(scalar, M, v);
+
+    for (int r = 0; r < 4; r++) {
+        double scale = 0.0;
+        for (int k = 0; k < 4; k++) {
+            scale += fabs((double)M[k][r] * v[k]);
+        }
+        recordError(result, simd[r], scalar[r], scale);
+    }
+    result->numCases++;
+}
+
+static void testInvert(MathTestResult* result) {
+    mat4x4 M, simd, scalar;
+    if (result->numCases % 4 == 0) {
+        mat4x4_perspective(M, randomFloat(0.3f, 2.0f), randomFloat(0.5f, 2.5f), randomFloat(0.01f, 1.0f), randomFloat(10.0f, 1000.0f));
+    } else {
+        randomTransform(M);
+    }
+    mat4x4_invert(simd, M);
+    mat4x4_invert_scalar(scalar, M);
+
+    double scale = 0.0;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            scale = fmax(scale, fabs(scalar[c][r]));
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            recordError(result, simd[c][r], scalar[c][r], scale);
+        }
+    }
+    result->numCases++;
+}
+
+static void testLookAt(MathTestResult* result) {
+    vec3 eye = {randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f)};
+    vec3 center = {randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f)};
+    vec3 up = {randomFloat(-0.2f, 0.2f), 1.0f, randomFloat(-0.2f, 0.2f)};
+    mat4x4 simd, scalar;
+    mat4x4_look_at(simd, eye, center, up);
+    mat4x4_look_at_scalar(scalar, eye, center, up);
+
+    // normalizing f x up divides its rounding error by the sine between them, and fused or unfused products round
+    // differently, so the basis error scales with 1 / sine and the translation also with the eye
+    double f[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+    double side[3] = {f[1] * up[2] - f[2] * up[1], f[2] * up[0] - f[0] * up[2], f[0] * up[1] - f[1] * up[0]};
+    double sine = sqrt((side[0] * side[0] + side[1] * side[1] + side[2] * side[2]) /
+                       ((f[0] * f[0] + f[1] * f[1] + f[2] * f[2]) * (up[0] * up[0] + up[1] * up[1] + up[2] * up[2])));
+    double scale = 1.0 / (sine > FLT_EPSILON ? sine : FLT_EPSILON);
+    double translationScale = scale * (1.0 + fabs(eye[0]) + fabs(eye[1]) + fabs(eye[2]));
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            recordError(result, simd[c][r], scalar[c][r], c == 3 ? translationScale : scale);
+        }
+    }
+    result->numCases++;
+}
+
+bool testLinmath(int rounds) {
+    MathTestResult results[] = {
+        {"mat4x4_mul", 0, 0, 0.0, MATH_TEST_DOT_BOUND},
+        {"mat4x4_mul_vec4", 0, 0, 0.0, MATH_TEST_DOT_BOUND},
+        {"mat4x4_invert", 0, 0, 0.0, MATH_TEST_INVERT_BOUND},
+        {"mat4x4_look_at", 0, 0, 0.0, MATH_TEST_LOOK_AT_BOUND},
+    };
+    void (*tests[])(MathTestResult*) = {testMul, testMulVec4, testInvert, testLookAt};
+    const int numTests = sizeof(tests) / sizeof(tests[0]);
+
+    randomState = 1;
+    for (int round = 0; round < rounds; round++) {
+        for (int t = 0; t < numTests; t++) {
+            for (int i = 0; i < MATH_TEST_CASES; i++) {
+                tests[t](&results[t]);
+            }
+        }
+    }
+
+    bool ok = true;
+    printf("Linmath test, %s kernels:\n", LINMATH_SIMD_NAME);
+    for (int t = 0; t < numTests; t++) {
+        const MathTestResult* result = &results[t];
+        bool passed = result->maxError <= result->bound;
+        ok = ok && passed;
+        printf("  %-16s %s: %u cases, %u values differ from scalar, max error %.2f of %.0f eps\n", result->name,
+               passed ? "passed" : "FAILED", result->numCases, result->numDiffering, result->maxError, result->bound);
+    }
+    return ok;
+}
+
+// microbenchmark, every call reads and writes memory so nothing folds away
+
+typedef struct mathBenchData {
+    mat4x4* a;
+    mat4x4* b;
+    mat4x4* out;
+    vec4* vectors;
+    vec3* eyes;
+} MathBenchData;
+
+static void benchMul(MathBenchData* data, int i, bool simd) {
+    if (simd) {
+        mat4x4_mul(data->out[i], data->a[i], data->b[i]);
+    } else {
+        mat4x4_mul_scalar(data->out[i], data->a[i], data->b[i]);
+    }
+}
+
+static void benchMulVec4(MathBenchData* data, int i, bool simd) {
+    if (simd) {
+        mat4x4_mul_vec4(data->out[i][0], data->a[i], data->vectors[i]);
+    } else {
+        mat4x4_mul_vec4_scalar(data->out[i][0], data->a[i], data->vectors[i]);
+    }
+}
+
+static void benchInvert(MathBenchData* data, int i, bool simd) {
+    if (simd) {
+        mat4x4_invert(data->out[i], data->b[i]);
+    } else {
+        mat4x4_invert_scalar(data->out[i], data->b[i]);
+    }
+}
+
+static void benchLookAt(MathBenchData* data, int i, bool simd) {
+    vec3 center = {0.0f, 0.0f, 0.0f};
+    vec3 up = {0.0f, 1.0f, 0.0f};
+    if (simd) {
+        mat4x4_look_at(data->out[i], data->eyes[i], center, up);
+    } else {
+        mat4x4_look_at_scalar(data->out[i], data->eyes[i], center, up);
+    }
+}
+
+void benchmarkLinmath(void) {
+    MathBenchData data = {
+        malloc(MATH_BENCH_MATRICES * sizeof(mat4x4)),
+        malloc(MATH_BENCH_MATRICES * sizeof(mat4x4)),
+        malloc(MATH_BENCH_MATRICES * sizeof(mat4x4)),
+        malloc(MATH_BENCH_MATRICES * sizeof(vec4)),
+        malloc(MATH_BENCH_MATRICES * sizeof(vec3)),
+    };
+
+    randomState = 7;
+    for (int i = 0; i < MATH_BENCH_MATRICES; i++) {
+        randomMatrix(data.a[i], 2.0f);
+        randomTransform(data.b[i]);
+        for (int k = 0; k < 4; k++) {
+            data.vectors[i][k] = randomFloat(-10.0f, 10.0f);
+        }
+        for (int k = 0; k < 3; k++) {
+            data.eyes[i][k] = randomFloat(-50.0f, 50.0f);
+        }
+    }
+
+    const char* names[] = {"mat4x4_mul", "mat4x4_mul_vec4", "mat4x4_invert", "mat4x4_look_at"};
+    void (*kernels[])(MathBenchData*, int, bool) = {benchMul, benchMulVec4, benchInvert, benchLookAt};
+
+    printf("Linmath benchmark, %s kernels, %d calls each:\n", LINMATH_SIMD_NAME, MATH_BENCH_MATRICES * MATH_BENCH_REPEAT);
+    for (unsigned int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        double ns[2];
+        for (int simd = 0; simd < 2; simd++) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int repeat = 0; repeat < MATH_BENCH_REPEAT; repeat++) {
+                for (int i = 0; i < MATH_BENCH_MATRICES; i++) {
+                    kernels[k](&data, i, simd);
+                }
+            }
+            ns[simd] = (double)(SDL_GetPerformanceCounter() - start) * 1e9 / SDL_GetPerformanceFrequency() /
+                       ((double)MATH_BENCH_MATRICES * MATH_BENCH_REPEAT);
+        }
+        printf("  %-16s scalar %6.2f ns, simd %6.2f ns, %.2fx\n", names[k], ns[0], ns[1], ns[0] / ns[1]);
+    }
+
+    free(data.a);
+    free(data.b);
+    free(data.out);
+    free(data.vectors);
+    free(data.eyes);
+}
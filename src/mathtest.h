@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+// random cases per kernel and round
+#define MATH_TEST_CASES 10000
+// largest accepted error of a dot product style kernel, in FLT_EPSILON times the summed magnitudes
+#define MATH_TEST_DOT_BOUND 4.0
+// largest accepted error of the inverse, in FLT_EPSILON times the largest inverse element
+#define MATH_TEST_INVERT_BOUND 256.0
+// of look_at, in FLT_EPSILON over the sine between forward and up; -mfma contracts the scalar reference differently
+#define MATH_TEST_LOOK_AT_BOUND 16.0
+#define MATH_BENCH_MATRICES 1024
+#define MATH_BENCH_REPEAT 2000
+
+// compares the SIMD linmath kernels against the scalar ones, run from the command line
+bool testLinmath(int rounds);
+void benchmarkLinmath(void);
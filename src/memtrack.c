@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "memtrack.h"
+
+typedef struct memoryHeader {
+    size_t size;
+    MemoryCategory category;
+} MemoryHeader;
+
+_Static_assert(sizeof(MemoryHeader) <= MEMORY_HEADER_SIZE, "memory header does not fit");
+
+typedef struct memoryObjectEntry {
+    // kind in the high bits, 0 marks an empty slot since GL never hands out name 0
+    uint64_t key;
+    MemoryCategory category;
+    size_t bytes;
+} MemoryObjectEntry;
+
+typedef struct memoryTracker {
+    MemoryCounter counters[MEMORY_CATEGORY_COUNT];
+
+    // open addressing with linear probing, only touched on the GL thread
+    MemoryObjectEntry* objects;
+    unsigned int sizeObjects;
+    unsigned int numObjects;
+} MemoryTracker;
+
+static const char* categoryNames[MEMORY_CATEGORY_COUNT] = {
+    "mesh_cpu",
+    "mesh_gpu",
+    "texture_gpu",
+    "render_gpu",
+    "shader",
+    "io_scratch",
+};
+
+static const bool categoryGpu[MEMORY_CATEGORY_COUNT] = {
+    false,
+    true,
+    true,
+    true,
+    true,
+    false,
+};
+
+static MemoryTracker tracker = {0};
+
+static void chargeMemory(MemoryCategory category, long long bytes, int objects) {
+    MemoryCounter* counter = &tracker.counters[category];
+    long long live = atomic_fetch_add_explicit(&counter->live, bytes, memory_order_relaxed) + bytes;
+    if (objects > 0) {
+        atomic_fetch_add_explicit(&counter->numLive, objects, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counter->numTotal, objects, memory_order_relaxed);
+    } else if (objects < 0) {
+        atomic_fetch_sub_explicit(&counter->numLive, -objects, memory_order_relaxed);
+    }
+
+    long long peak = atomic_load_explicit(&counter->peak, memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&counter->peak, &peak, live, memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    // only the crossing prints, not every allocation past it
+    if (counter->budget > 0) {
+        bool over = live > counter->budget;
+        if (atomic_exchange_explicit(&counter->overBudget, over, memory_order_relaxed) != over && over) {
+            printf("Warning: %s memory %.1f MiB is over its %.1f MiB budget\n", categoryNames[category],
+                   live / (1024.0 * 1024.0), counter->budget / (1024.0 * 1024.0));
+        }
+    }
+}
+
+void* trackedMalloc(MemoryCategory category, size_t size) {
+    if (size > SIZE_MAX - MEMORY_HEADER_SIZE) {
+        return NULL;
+    }
+
+    unsigned char* block = malloc(MEMORY_HEADER_SIZE + size);
+    if (!block) {
+        return NULL;
+    }
+
+    MemoryHeader* header = (MemoryHeader*)block;
+    header->size = size;
+    header->category = category;
+    chargeMemory(category, (long long)size, 1);
+    return block + MEMORY_HEADER_SIZE;
+}
+
+void* trackedCalloc(MemoryCategory category, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* data = trackedMalloc(category, count * size);
+    if (data) {
+        memset(data, 0, count * size);
+    }
+    return data;
+}
+
+void* trackedRealloc(MemoryCategory category, void* ptr, size_t size) {
+    if (!ptr) {
+        return trackedMalloc(category, size);
+    }
+    if (size > SIZE_MAX - MEMORY_HEADER_SIZE) {
+        return NULL;
+    }
+
+    unsigned char* block = (unsigned char*)ptr - MEMORY_HEADER_SIZE;
+    MemoryHeader old = *(MemoryHeader*)block;
+
+    // on failure the old block stays valid and charged
+    block = realloc(block, MEMORY_HEADER_SIZE + size);
+    if (!block) {
+        return NULL;
+    }
+
+    ((MemoryHeader*)block)->size = size;
+    chargeMemory(old.category, (long long)size - (long long)old.size, 0);
+    return block + MEMORY_HEADER_SIZE;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    unsigned char* block = (unsigned char*)ptr - MEMORY_HEADER_SIZE;
+    const MemoryHeader* header = (const MemoryHeader*)block;
+    chargeMemory(header->category, -(long long)header->size, -1);
+    free(block);
+}
+
+static uint64_t objectKey(MemoryObject kind, unsigned int name) {
+    return (uint64_t)(kind + 1) << 32 | name;
+}
+
+static unsigned int objectSlot(uint64_t key) {
+    // fibonacci hashing spreads the sequential names GL hands out
+    return (unsigned int)((key * 11400714819323198485ull) >> 32) & (tracker.sizeObjects - 1);
+}
+
+static MemoryObjectEntry* findObject(uint64_t key) {
+    if (tracker.sizeObjects == 0) {
+        return NULL;
+    }
+
+    for (unsigned int slot = objectSlot(key);; slot = (slot + 1) & (tracker.sizeObjects - 1)) {
+        MemoryObjectEntry* entry = &tracker.objects[slot];
+        if (entry->key == key) {
+            return entry;
+        }
+        if (entry->key == 0) {
+            return NULL;
+        }
+    }
+}
+
+static MemoryObjectEntry* insertObject(uint64_t key) {
+    // keeps the load under 3/4 so probes stay short
+    if ((tracker.numObjects + 1) * 4 > tracker.sizeObjects * 3) {
+        MemoryObjectEntry* old = tracker.objects;
+        unsigned int sizeOld = tracker.sizeObjects;
+
+        tracker.sizeObjects = sizeOld ? sizeOld * 2 : MEMORY_OBJECT_TABLE_SIZE;
+        tracker.objects = calloc(tracker.sizeObjects, sizeof(MemoryObjectEntry));
+        for (unsigned int i = 0; i < sizeOld; i++) {
+            if (old[i].key != 0) {
+                unsigned int slot = objectSlot(old[i].key);
+                while (tracker.objects[slot].key != 0) {
+                    slot = (slot + 1) & (tracker.sizeObjects - 1);
+                }
+                tracker.objects[slot] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    unsigned int slot = objectSlot(key);
+    while (tracker.objects[slot].key != 0) {
+        slot = (slot + 1) & (tracker.sizeObjects - 1);
+    }
+    tracker.objects[slot].key = key;
+    tracker.numObjects++;
+    return &tracker.objects[slot];
+}
+
+static void removeObject(MemoryObjectEntry* entry) {
+    // backward shift deletion, no tombstones to skip later
+    unsigned int mask = tracker.sizeObjects - 1;
+    unsigned int hole = (unsigned int)(entry - tracker.objects);
+    for (unsigned int slot = (hole + 1) & mask; tracker.objects[slot].key != 0; slot = (slot + 1) & mask) {
+        unsigned int home = objectSlot(tracker.objects[slot].key);
+        // moves the entry back unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            tracker.objects[hole] = tracker.objects[slot];
+            hole = slot;
+        }
+    }
+    tracker.objects[hole].key = 0;
+    tracker.numObjects--;
+}
+
+void trackGpuObject(MemoryObject kind, unsigned int name, MemoryCategory category, size_t bytes) {
+    if (name == 0) {
+        return;
+    }
+
+    uint64_t key = objectKey(kind, name);
+    MemoryObjectEntry* entry = findObject(key);
+    if (entry && entry->category == category) {
+        // resized in place, still the same object
+        chargeMemory(category, (long long)bytes - (long long)entry->bytes, 0);
+        entry->bytes = bytes;
+        return;
+    }
+
+    if (entry) {
+        chargeMemory(entry->category, -(long long)entry->bytes, -1);
+    } else {
+        entry = insertObject(key);
+    }
+    entry->category = category;
+    entry->bytes = bytes;
+    chargeMemory(category, (long long)bytes, 1);
+}
+
+void untrackGpuObject(MemoryObject kind, unsigned int name) {
+    MemoryObjectEntry* entry = findObject(objectKey(kind, name));
+    if (!entry) {
+        return;
+    }
+
+    chargeMemory(entry->category, -(long long)entry->bytes, -1);
+    removeObject(entry);
+}
+
+long long memoryLive(MemoryCategory category) {
+    return atomic_load_explicit(&tracker.counters[category].live, memory_order_relaxed);
+}
+
+long long memoryPeak(MemoryCategory category) {
+    return atomic_load_explicit(&tracker.counters[category].peak, memory_order_relaxed);
+}
+
+void setMemoryBudget(MemoryCategory category, long long bytes) {
+    tracker.counters[category].budget = bytes;
+}
+
+const char* memoryCategoryName(MemoryCategory category) {
+    return categoryNames[category];
+}
+
+int memoryCategoryFromName(const char* name) {
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        if (strcmp(name, categoryNames[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void reportMemory(const char* label) {
+    const double MiB = 1024.0 * 1024.0;
+    double totals[2] = {0.0, 0.0};
+
+    printf("Memory (%s):\n", label);
+    for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        const MemoryCounter* counter = &tracker.counters[i];
+        long long live = atomic_load_explicit(&counter->live, memory_order_relaxed);
+        totals[categoryGpu[i]] += live / MiB;
+
+        printf("  %-12s %s %9.2f MiB live, %9.2f MiB peak, %6u live of %7u allocations", categoryNames[i],
+               categoryGpu[i] ? "GPU" : "CPU", live / MiB, atomic_load_explicit(&counter->peak, memory_order_relaxed) / MiB,
+               atomic_load_explicit(&counter->numLive, memory_order_relaxed),
+               atomic_load_explicit(&counter->numTotal, memory_order_relaxed));
+        if (counter->budget > 0) {
+            printf(", budget %.2f MiB%s", counter->budget / MiB, live > counter->budget ? " EXCEEDED" : "");
+        }
+        printf("\n");
+    }
+    printf("  total        CPU %9.2f MiB live, GPU %9.2f MiB live\n", totals[0], totals[1]);
+}
+
+void freeMemoryTracking(void) {
+    free(tracker.objects);
+    tracker.objects = NULL;
+    tracker.sizeObjects = 0;
+    tracker.numObjects = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// tracked allocations carry their size and category in a header in front of the returned pointer
+#define MEMORY_HEADER_SIZE 16
+// GL objects tracked before the first table growth, a power of two
+#define MEMORY_OBJECT_TABLE_SIZE 1024
+
+typedef enum memoryCategory {
+    // vertex and index copies kept next to the GL buffers
+    MEMORY_MESH_CPU,
+    MEMORY_MESH_GPU,
+    MEMORY_TEXTURE_GPU,
+    // g-buffer, uniform ring, cluster buffers and other per frame GL storage
+    MEMORY_RENDER_GPU,
+    // drivers keep the sources and the compiled code, charged as the source size
+    MEMORY_SHADER,
+    // file reads and cooked texture entries, freed once uploaded
+    MEMORY_IO_SCRATCH,
+    MEMORY_CATEGORY_COUNT,
+} MemoryCategory;
+
+// GL names are only unique within a kind
+typedef enum memoryObject {
+    MEMORY_OBJECT_BUFFER,
+    MEMORY_OBJECT_TEXTURE,
+    MEMORY_OBJECT_PROGRAM,
+} MemoryObject;
+
+typedef struct memoryCounter {
+    atomic_llong live;
+    atomic_llong peak;
+    atomic_uint numLive;
+    atomic_uint numTotal;
+    // 0 for none, a warning is printed every time live crosses it
+    long long budget;
+    atomic_bool overBudget;
+} MemoryCounter;
+
+// safe from any thread, NULL on failure like the libc functions
+void* trackedMalloc(MemoryCategory category, size_t size);
+void* trackedCalloc(MemoryCategory category, size_t count, size_t size);
+// keeps the category of ptr, a NULL ptr allocates in category
+void* trackedRealloc(MemoryCategory category, void* ptr, size_t size);
+void trackedFree(void* ptr);
+
+// GL thread only; tracking an object again replaces its size, e.g. after glBufferData or a streamed level
+void trackGpuObject(MemoryObject kind, unsigned int name, MemoryCategory category, size_t bytes);
+void untrackGpuObject(MemoryObject kind, unsigned int name);
+
+long long memoryLive(MemoryCategory category);
+long long memoryPeak(MemoryCategory category);
+void setMemoryBudget(MemoryCategory category, long long bytes);
+const char* memoryCategoryName(MemoryCategory category);
+// category from its report name, -1 when unknown
+int memoryCategoryFromName(const char* name);
+void reportMemory(const char* label);
+void freeMemoryTracking(void);
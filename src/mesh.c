@@ -2,9 +2,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stb/stb_image.h>
 
 #include "mesh.h"
+#include "texcache.h"
+#include "streaming.h"
+#include "texpack.h"
+#include "memtrack.h"
 
 void setupMesh(Mesh* mesh) {
     glGenVertexArrays(1, &mesh->VAO);
@@ -15,9 +18,11 @@ void setupMesh(Mesh* mesh) {
     glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
 
     glBufferData(GL_ARRAY_BUFFER, mesh->numVertices * sizeof(Vertex), mesh->vertices, GL_STATIC_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, mesh->VBO, MEMORY_MESH_GPU, mesh->numVertices * sizeof(Vertex));
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->numIndices * sizeof(unsigned int), mesh->indices, GL_STATIC_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, mesh->EBO, MEMORY_MESH_GPU, mesh->numIndices * sizeof(unsigned int));
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -31,68 +36,61 @@ void setupMesh(Mesh* mesh) {
     glBindVertexArray(0);
 }
 
-void drawMesh(Mesh *mesh, unsigned int shader) {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    for (unsigned int i = 0; i < mesh->numTextures; i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        Texture *texture = &mesh->textures[i];
-        int number = 0;
-
-        if (strcmp("texture_diffuse", texture->type) == 0) {
-            number = diffuseNr;
-            ++diffuseNr;
-        } else if (strcmp("texture_specular", texture->type) == 0) {
-            number = specularNr;
-            ++specularNr;
-        }
-
-        char uniformName[256];
-        sprintf(uniformName, "material.%s%i", texture->type, number);
-        glUniform1i(glGetUniformLocation(shader, uniformName), i);
+void freeMesh(Mesh* mesh) {
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, mesh->VBO);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, mesh->EBO);
+    glDeleteVertexArrays(1, &mesh->VAO);
+    glDeleteBuffers(1, &mesh->VBO);
+    glDeleteBuffers(1, &mesh->EBO);
+    mesh->VAO = mesh->VBO = mesh->EBO = 0;
+}
 
-        glBindTexture(GL_TEXTURE_2D, texture->id);
+bool meshOutsideFrustum(const Mesh* mesh, mat4x4 modelViewProjection) {
+    unsigned int outside = 0x3f;
+    for (int corner = 0; corner < 8; corner++) {
+        vec4 position = {
+            (corner & 1) ? mesh->aabbMax[0] : mesh->aabbMin[0],
+            (corner & 2) ? mesh->aabbMax[1] : mesh->aabbMin[1],
+            (corner & 4) ? mesh->aabbMax[2] : mesh->aabbMin[2],
+            1.0f,
+        };
+
+        vec4 clip;
+        mat4x4_mul_vec4(clip, modelViewProjection, position);
+
+        unsigned int planes = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            planes |= (clip[axis] < -clip[3]) << (axis * 2);
+            planes |= (clip[axis] > clip[3]) << (axis * 2 + 1);
+        }
+        outside &= planes;
+        if (outside == 0) {
+            return false;
+        }
     }
-
-    glBindVertexArray(mesh->VAO);
-    glDrawElements(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    glActiveTexture(GL_TEXTURE0);
+    return true;
 }
 
-unsigned int initTexture(const char* imageName) {
-    stbi_set_flip_vertically_on_load(true);
-
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(imageName, &width, &height, &nrChannels, 0);
-    if (!data) {
-        printf("Error: Failed to load texture %s\n", imageName);
+unsigned int initTexture(const char* imageName, bool srgb) {
+    // decoded, mipmapped and block compressed once, then served from the cache
+    if (texturePackingActive()) {
+        // uploaded later as array layers by packModelTextures
         return 0;
     }
-
-    GLenum format = GL_RGB;
-    if (nrChannels == 1) {
-        format = GL_RED;
-    } else if (nrChannels == 3) {
-        format = GL_RGB;
-    } else if (nrChannels == 4) {
-        format = GL_RGBA;
+    if (textureStreamingActive()) {
+        return streamTexture(imageName, srgb);
     }
+    return loadCachedTexture(imageName, srgb);
+}
 
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
+void freeTexture(unsigned int texture) {
+    // packed textures are 0, their arrays go with freeTexturePacking
+    if (texture == 0) {
+        return;
+    }
 
-    return texture;
+    releaseStreamedTexture(texture);
+    releaseTextureHandle(texture);
+    untrackGpuObject(MEMORY_OBJECT_TEXTURE, texture);
+    glDeleteTextures(1, &texture);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <linmath.h>
 #include <assimp/cimport.h>
 #include <assimp/scene.h>
@@ -19,6 +20,9 @@ typedef struct texture {
     unsigned int id;
     char* type;
     aiString path;
+    // with texture packing id is a 2D array, uvTransform is scale xy and offset zw inside the layer
+    int layer;
+    vec4 uvTransform;
 } Texture;
 
 typedef struct mesh {
@@ -30,8 +34,27 @@ typedef struct mesh {
     size_t numTextures;
 
     unsigned int VAO, VBO, EBO;
+    // index into the bindless material table
+    unsigned int materialId;
+
+    // object space bounds
+    vec3 aabbMin;
+    vec3 aabbMax;
+    // texture coordinate units per object space unit, for picking streamed mip levels
+    float uvDensity;
+    // cleared by occlusion culling for the current frame
+    bool visible;
+    bool occluder;
+    // with lazy materials the texture ids stay 0 until the draw list first records the mesh
+    bool materialLoaded;
+    // set while recording, only for meshes still waiting for their textures
+    bool materialRequested;
 } Mesh;
 
 void setupMesh(Mesh* mesh);
-void drawMesh(Mesh* mesh, unsigned int shader);
-unsigned int initTexture(const char* imageName);
+// GL objects only, the CPU copies belong to the model's arena
+void freeMesh(Mesh* mesh);
+// true when all corners of the bounds lie outside the same clip plane
+bool meshOutsideFrustum(const Mesh* mesh, mat4x4 modelViewProjection);
+unsigned int initTexture(const char* imageName, bool srgb);
+void freeTexture(unsigned int texture);
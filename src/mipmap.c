@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "mipmap.h"
+#include "jobs.h"
+
+// destination rows filtered together, bounds the per worker scratch
+#define MIP_BAND_ROWS 16
+
+// filter taps for one axis, source indices are already clamped to the edge
+typedef struct mipAxis {
+    int size;
+    int dstSize;
+    int taps;
+    int* index;
+    float* weight;
+} MipAxis;
+
+typedef struct mipJob {
+    const unsigned char* src;
+    unsigned char* dst;
+    int width;
+    int height;
+    int channels;
+    bool gammaCorrect;
+    const MipAxis* axisX;
+    const MipAxis* axisY;
+    int firstRow;
+    int lastRow;
+} MipJob;
+
+static float srgbToLinear[256];
+// linear value halfway between two consecutive sRGB codes
+static float srgbThresholds[255];
+static bool srgbTablesReady = false;
+
+static float srgbDecode(float value) {
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static void initSrgbTables(void) {
+    if (srgbTablesReady) {
+        return;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        srgbToLinear[i] = srgbDecode(i / 255.0f);
+    }
+    for (int i = 0; i < 255; i++) {
+        srgbThresholds[i] = srgbDecode((i + 0.5f) / 255.0f);
+    }
+    srgbTablesReady = true;
+}
+
+static unsigned char encodeSrgb(float value) {
+    int low = 0;
+    int high = 255;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (value < srgbThresholds[mid]) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return (unsigned char)low;
+}
+
+static unsigned char encodeLinear(float value) {
+    int result = (int)(value * 255.0f + 0.5f);
+    return (unsigned char)(result < 0 ? 0 : (result > 255 ? 255 : result));
+}
+
+int mipLevelSize(int size, int level) {
+    int result = size >> level;
+    return result > 0 ? result : 1;
+}
+
+int mipLevelCount(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = mipLevelSize(width, 1);
+        height = mipLevelSize(height, 1);
+        levels++;
+    }
+    return levels;
+}
+
+static float besselI0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    float half = x * 0.5f;
+    for (int k = 1; k < 32; k++) {
+        term *= half / k;
+        float squared = term * term;
+        sum += squared;
+        if (squared < sum * 1e-8f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static float sinc(float x) {
+    if (fabsf(x) < 1e-6f) {
+        return 1.0f;
+    }
+    return sinf((float)M_PI * x) / ((float)M_PI * x);
+}
+
+static float kaiser(float x) {
+    if (fabsf(x) >= 1.0f) {
+        return 0.0f;
+    }
+    return besselI0(MIP_KAISER_ALPHA * sqrtf(1.0f - x * x)) / besselI0(MIP_KAISER_ALPHA);
+}
+
+static void initMipAxis(MipAxis* axis, int size, MipFilter filter) {
+    axis->size = size;
+    axis->dstSize = mipLevelSize(size, 1);
+
+    float scale = (float)size / axis->dstSize;
+    float radius = filter == MIP_FILTER_KAISER ? MIP_KAISER_WIDTH * scale : scale * 0.5f;
+    axis->taps = (int)ceilf(radius * 2.0f) + 1;
+    axis->index = malloc(sizeof(int) * axis->dstSize * axis->taps);
+    axis->weight = malloc(sizeof(float) * axis->dstSize * axis->taps);
+
+    for (int x = 0; x < axis->dstSize; x++) {
+        float center = (x + 0.5f) * scale;
+        int first = (int)floorf(center - radius);
+        int* index = &axis->index[x * axis->taps];
+        float* weight = &axis->weight[x * axis->taps];
+        float total = 0.0f;
+
+        for (int k = 0; k < axis->taps; k++) {
+            int i = first + k;
+            if (filter == MIP_FILTER_KAISER) {
+                float t = (i + 0.5f - center) / scale;
+                weight[k] = sinc(t) * kaiser(t / MIP_KAISER_WIDTH);
+            } else {
+                // area of the source texel inside the destination footprint
+                float low = fmaxf((float)i, center - radius);
+                float high = fminf((float)(i + 1), center + radius);
+                weight[k] = fmaxf(high - low, 0.0f);
+            }
+            index[k] = i < 0 ? 0 : (i >= size ? size - 1 : i);
+            total += weight[k];
+        }
+
+        for (int k = 0; k < axis->taps; k++) {
+            weight[k] /= total;
+        }
+    }
+}
+
+static void freeMipAxis(MipAxis* axis) {
+    free(axis->index);
+    free(axis->weight);
+}
+
+// expands one source row to linear RGBA floats
+static void decodeRow(const MipJob* job, int y, float* out) {
+    const unsigned char* row = job->src + (size_t)y * job->width * job->channels;
+    int colorChannels = job->channels == 2 ? 1 : (job->channels < 3 ? job->channels : 3);
+
+    for (int x = 0; x < job->width; x++) {
+        const unsigned char* pixel = row + x * job->channels;
+        for (int c = 0; c < 4; c++) {
+            float value = 0.0f;
+            if (c < job->channels) {
+                value = job->gammaCorrect && c < colorChannels ? srgbToLinear[pixel[c]] : pixel[c] / 255.0f;
+            }
+            out[x * 4 + c] = value;
+        }
+    }
+}
+
+static void encodeRow(const MipJob* job, int y, const float* in) {
+    int dstWidth = job->axisX->dstSize;
+    unsigned char* row = job->dst + (size_t)y * dstWidth * job->channels;
+    int colorChannels = job->channels == 2 ? 1 : (job->channels < 3 ? job->channels : 3);
+
+    for (int x = 0; x < dstWidth; x++) {
+        for (int c = 0; c < job->channels; c++) {
+            float value = in[x * 4 + c];
+            row[x * job->channels + c] = job->gammaCorrect && c < colorChannels ? encodeSrgb(value) : encodeLinear(value);
+        }
+    }
+}
+
+static void filterHorizontal(const MipAxis* axis, const float* in, float* out) {
+    for (int x = 0; x < axis->dstSize; x++) {
+        const int* index = &axis->index[x * axis->taps];
+        const float* weight = &axis->weight[x * axis->taps];
+#if defined(__SSE2__)
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < axis->taps; k++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&in[index[k] * 4]), _mm_set1_ps(weight[k])));
+        }
+        _mm_storeu_ps(&out[x * 4], sum);
+#else
+        float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int k = 0; k < axis->taps; k++) {
+            for (int c = 0; c < 4; c++) {
+                sum[c] += in[index[k] * 4 + c] * weight[k];
+            }
+        }
+        for (int c = 0; c < 4; c++) {
+            out[x * 4 + c] = sum[c];
+        }
+#endif
+    }
+}
+
+// accumulates weight * row into out, both dstWidth RGBA pixels
+static void accumulateRow(const float* row, float weight, int count, float* out) {
+#if defined(__SSE2__)
+    __m128 w = _mm_set1_ps(weight);
+    for (int i = 0; i < count * 4; i += 4) {
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_loadu_ps(&out[i]), _mm_mul_ps(_mm_loadu_ps(&row[i]), w)));
+    }
+#else
+    for (int i = 0; i < count * 4; i++) {
+        out[i] += row[i] * weight;
+    }
+#endif
+}
+
+static void filterRows(const MipJob* job) {
+    const MipAxis* axisX = job->axisX;
+    const MipAxis* axisY = job->axisY;
+    int dstWidth = axisX->dstSize;
+
+    // source rows a band can touch
+    int maxRows = (MIP_BAND_ROWS - 1) * ((job->height + axisY->dstSize - 1) / axisY->dstSize) + axisY->taps + 1;
+    float* source = malloc(sizeof(float) * 4 * job->width);
+    float* horizontal = malloc(sizeof(float) * 4 * dstWidth * maxRows);
+    float* output = malloc(sizeof(float) * 4 * dstWidth);
+
+    for (int y0 = job->firstRow; y0 < job->lastRow; y0 += MIP_BAND_ROWS) {
+        int y1 = y0 + MIP_BAND_ROWS < job->lastRow ? y0 + MIP_BAND_ROWS : job->lastRow;
+
+        int minRow = job->height;
+        int maxRow = 0;
+        for (int i = y0 * axisY->taps; i < y1 * axisY->taps; i++) {
+            minRow = axisY->index[i] < minRow ? axisY->index[i] : minRow;
+            maxRow = axisY->index[i] > maxRow ? axisY->index[i] : maxRow;
+        }
+
+        for (int row = minRow; row <= maxRow; row++) {
+            decodeRow(job, row, source);
+            filterHorizontal(axisX, source, &horizontal[(size_t)(row - minRow) * dstWidth * 4]);
+        }
+
+        for (int y = y0; y < y1; y++) {
+            for (int i = 0; i < dstWidth * 4; i++) {
+                output[i] = 0.0f;
+            }
+            for (int k = 0; k < axisY->taps; k++) {
+                int row = axisY->index[y * axisY->taps + k];
+                accumulateRow(&horizontal[(size_t)(row - minRow) * dstWidth * 4], axisY->weight[y * axisY->taps + k], dstWidth, output);
+            }
+            encodeRow(job, y, output);
+        }
+    }
+
+    free(source);
+    free(horizontal);
+    free(output);
+}
+
+static void filterRowRange(void* data, int begin, int end) {
+    MipJob job = *(const MipJob*)data;
+    job.firstRow = begin;
+    job.lastRow = end;
+    filterRows(&job);
+}
+
+void buildMipLevel(const unsigned char* src, int width, int height, int channels, MipFilter filter, bool gammaCorrect, unsigned char* dst) {
+    initSrgbTables();
+
+    MipAxis axisX, axisY;
+    initMipAxis(&axisX, width, filter);
+    initMipAxis(&axisY, height, filter);
+
+    int dstHeight = axisY.dstSize;
+    MipJob job = {src, dst, width, height, channels, gammaCorrect, &axisX, &axisY, 0, dstHeight};
+    parallelFor(dstHeight, MIP_ROWS_PER_JOB, filterRowRange, &job);
+
+    freeMipAxis(&axisX);
+    freeMipAxis(&axisY);
+}
+
+const char* mipFilterName(MipFilter filter) {
+    return filter == MIP_FILTER_KAISER ? "kaiser" : "box";
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Kaiser windowed sinc, radius in destination texels
+#define MIP_KAISER_WIDTH 3.0f
+#define MIP_KAISER_ALPHA 4.0f
+// destination rows per job, smaller levels are filtered on the calling thread
+#define MIP_ROWS_PER_JOB 32
+
+typedef enum mipFilter {
+    MIP_FILTER_BOX,
+    MIP_FILTER_KAISER,
+} MipFilter;
+
+int mipLevelCount(int width, int height);
+int mipLevelSize(int size, int level);
+
+// filters src (width x height) down to the next level; gammaCorrect filters colour in linear space, alpha is always linear
+void buildMipLevel(const unsigned char* src, int width, int height, int channels, MipFilter filter, bool gammaCorrect, unsigned char* dst);
+const char* mipFilterName(MipFilter filter);
@@ -1,36 +1,232 @@
 #include <glad/glad.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include <assimp/cfileio.h>
 
 #include "model.h"
+#include "startup.h"
+#include "memtrack.h"
+#include "vfs.h"
+#include "io.h"
 
-static Texture* cachedTextures = NULL;
-static unsigned int numCachedTextures = 0;
-static unsigned int sizeCachedTextures = 0;
+typedef struct lazyMaterials {
+    bool active;
+    // mid grey diffuse and black specular, 1x1 each
+    unsigned int fallback[2];
+} LazyMaterials;
+
+static LazyMaterials lazy = {0};
+
+// counting pass, sizes the arena so loading never reallocates
+static void measureNode(const aiNode* node, const aiScene* scene, size_t* arenaBytes, unsigned int* numTextureRefs) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+
+        unsigned int numIndices = 0;
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+            numIndices += mesh->mFaces[f].mNumIndices;
+        }
+
+        unsigned int numTextures = 0;
+        if (scene->mNumMaterials > 0) {
+            const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+            numTextures = aiGetMaterialTextureCount(material, aiTextureType_DIFFUSE) +
+                          aiGetMaterialTextureCount(material, aiTextureType_SPECULAR);
+        }
+
+        *arenaBytes += arenaSize(mesh->mNumVertices * sizeof(Vertex));
+        *arenaBytes += arenaSize(numIndices * sizeof(unsigned int));
+        *arenaBytes += arenaSize(numTextures * sizeof(Texture));
+        *numTextureRefs += numTextures;
+    }
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        measureNode(node->mChildren[i], scene, arenaBytes, numTextureRefs);
+    }
+}
+
+// assimp opens the model and everything it references through these while a pack is mounted
+typedef struct importFile {
+    // first, assimp hands the aiFile back
+    struct aiFile file;
+    // packed files are read straight from the mapping, compressed ones from their decoded copy, the rest from disk
+    const char* data;
+    size_t size;
+    size_t position;
+    File decoded;
+    FILE* loose;
+} ImportFile;
+
+static size_t readImportFile(struct aiFile* file, char* buffer, size_t size, size_t count) {
+    ImportFile* import = (ImportFile*)file;
+    if (import->loose) {
+        return fread(buffer, size, count, import->loose);
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    size_t items = (import->size - import->position) / size;
+    items = items < count ? items : count;
+    memcpy(buffer, import->data + import->position, items * size);
+    import->position += items * size;
+    return items;
+}
+
+static size_t writeImportFile(struct aiFile* file, const char* buffer, size_t size, size_t count) {
+    // packs are read only, models never write
+    (void)file;
+    (void)buffer;
+    (void)size;
+    (void)count;
+    return 0;
+}
+
+static size_t tellImportFile(struct aiFile* file) {
+    ImportFile* import = (ImportFile*)file;
+    return import->loose ? (size_t)ftell(import->loose) : import->position;
+}
+
+static size_t importFileSize(struct aiFile* file) {
+    ImportFile* import = (ImportFile*)file;
+    if (import->loose) {
+        long position = ftell(import->loose);
+        fseek(import->loose, 0, SEEK_END);
+        long size = ftell(import->loose);
+        fseek(import->loose, position, SEEK_SET);
+        return (size_t)size;
+    }
+    return import->size;
+}
+
+static enum aiReturn seekImportFile(struct aiFile* file, size_t offset, enum aiOrigin origin) {
+    ImportFile* import = (ImportFile*)file;
+    if (import->loose) {
+        int whence = origin == aiOrigin_SET ? SEEK_SET : origin == aiOrigin_CUR ? SEEK_CUR : SEEK_END;
+        return fseek(import->loose, (long)offset, whence) == 0 ? aiReturn_SUCCESS : aiReturn_FAILURE;
+    }
+
+    // assimp passes negative offsets from the end as wrapped around size_t
+    size_t base = origin == aiOrigin_SET ? 0 : origin == aiOrigin_CUR ? import->position : import->size;
+    size_t position = base + offset;
+    if (position > import->size) {
+        return aiReturn_FAILURE;
+    }
+    import->position = position;
+    return aiReturn_SUCCESS;
+}
+
+static void flushImportFile(struct aiFile* file) {
+    (void)file;
+}
+
+static struct aiFile* openImportFile(struct aiFileIO* io, const char* path, const char* mode) {
+    (void)io;
+    VfsFile packed;
+    bool inPack = vfsFind(path, &packed);
+    FILE* loose = inPack ? NULL : fopen(path, mode);
+    if (!inPack && !loose) {
+        return NULL;
+    }
+
+    File decoded = {0};
+    if (inPack && packed.compression != PACK_COMPRESSION_NONE) {
+        decoded = io_file_read(path);
+        if (!decoded.is_valid) {
+            return NULL;
+        }
+        packed.data = decoded.data;
+    }
+
+    ImportFile* import = malloc(sizeof(ImportFile));
+    *import = (ImportFile){
+        .file = {
+            .ReadProc = readImportFile,
+            .WriteProc = writeImportFile,
+            .TellProc = tellImportFile,
+            .FileSizeProc = importFileSize,
+            .SeekProc = seekImportFile,
+            .FlushProc = flushImportFile,
+        },
+        .data = inPack ? packed.data : NULL,
+        .size = inPack ? packed.size : 0,
+        .decoded = decoded,
+        .loose = loose,
+    };
+    return &import->file;
+}
+
+static void closeImportFile(struct aiFileIO* io, struct aiFile* file) {
+    (void)io;
+    ImportFile* import = (ImportFile*)file;
+    if (import->loose) {
+        fclose(import->loose);
+    }
+    if (import->decoded.is_valid) {
+        io_file_free(&import->decoded);
+    }
+    free(import);
+}
 
 Model loadModel(char* path) {
-    Model model;
-    const aiScene* scene = aiImportFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    Model model = {0};
+    beginStartupPhase("import");
+    struct aiFileIO packIO = {.OpenProc = openImportFile, .CloseProc = closeImportFile};
+    const aiScene* scene = aiImportFileEx(path, aiProcess_Triangulate | aiProcess_FlipUVs, vfsActive() ? &packIO : NULL);
+    endStartupPhase();
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         printf("Assimp error: %s\n", aiGetErrorString());
+        aiReleaseImport(scene);
+        return model;
     }
 
-    unsigned int index = strrchr(path, '/') - path;
-    model.directory = calloc(index + 1, sizeof(char));
-    strncpy(model.directory, path, index);
-    model.directory[index] = '\0';
+    const char* slash = strrchr(path, '/');
+    size_t directoryLength = slash ? (size_t)(slash - path) : 1;
 
     unsigned int numMeshes = countMeshes(scene->mRootNode);
-    model.meshes = calloc(numMeshes, sizeof(Mesh));
+    size_t arenaBytes = arenaSize(directoryLength + 1) + arenaSize(numMeshes * sizeof(Mesh));
+    unsigned int numTextureRefs = 0;
+    measureNode(scene->mRootNode, scene, &arenaBytes, &numTextureRefs);
+    // unique textures are at most one per reference
+    arenaBytes += arenaSize(numTextureRefs * sizeof(Texture));
+
+    model.arena = initArena(MEMORY_MESH_CPU, arenaBytes);
+    if (!model.arena.data) {
+        aiReleaseImport(scene);
+        return model;
+    }
+
+    model.directory = arenaAlloc(&model.arena, directoryLength + 1, sizeof(char));
+    memcpy(model.directory, slash ? path : ".", directoryLength);
+
+    model.meshes = arenaAlloc(&model.arena, numMeshes, sizeof(Mesh));
     model.numMeshes = numMeshes;
+    model.textures = arenaAlloc(&model.arena, numTextureRefs, sizeof(Texture));
 
     unsigned int meshIndex = 0;
+    beginStartupPhase("meshes and textures");
     processNode(&model, scene->mRootNode, scene, &meshIndex);
+    endStartupPhase();
+
+    // the meshes hold their own copies, the scene is not needed past loading
+    aiReleaseImport(scene);
 
     return model;
 }
 
+void unloadModel(Model* model) {
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        freeMesh(&model->meshes[i]);
+    }
+    for (unsigned int i = 0; i < model->numTextures; i++) {
+        freeTexture(model->textures[i].id);
+    }
+
+    freeArena(&model->arena);
+    *model = (Model){0};
+}
+
 unsigned int countMeshes(const aiNode* node) {
     unsigned int result = node->mNumMeshes;
 
@@ -55,7 +251,11 @@ void processNode(Model *model, const aiNode *node, const aiScene *scene, unsigne
 }
 
 Mesh processMesh(Model* model, const aiMesh* mesh, const aiScene* scene) {
-    Vertex *vertices = calloc(mesh->mNumVertices, sizeof(Vertex));
+    Mesh result = {0};
+    result.visible = true;
+    result.materialLoaded = !lazy.active;
+
+    Vertex *vertices = arenaAlloc(&model->arena, mesh->mNumVertices, sizeof(Vertex));
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
         Vertex vertex = {0};
 
@@ -73,6 +273,14 @@ Mesh processMesh(Model* model, const aiMesh* mesh, const aiScene* scene) {
         }
 
         vertices[i] = vertex;
+
+        if (i == 0) {
+            vec3_dup(result.aabbMin, vertex.Position);
+            vec3_dup(result.aabbMax, vertex.Position);
+        } else {
+            vec3_min(result.aabbMin, result.aabbMin, vertex.Position);
+            vec3_max(result.aabbMax, result.aabbMax, vertex.Position);
+        }
     }
 
     unsigned int numIndices = 0;
@@ -80,7 +288,7 @@ Mesh processMesh(Model* model, const aiMesh* mesh, const aiScene* scene) {
         numIndices += mesh->mFaces[i].mNumIndices;
     }
 
-    unsigned int *indices = calloc(numIndices, sizeof(unsigned int));
+    unsigned int *indices = arenaAlloc(&model->arena, numIndices, sizeof(unsigned int));
     unsigned int iIndices = 0;
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
         aiFace face = mesh->mFaces[i];
@@ -90,104 +298,176 @@ Mesh processMesh(Model* model, const aiMesh* mesh, const aiScene* scene) {
         }
     }
 
-    unsigned int numDiffuseMaps = 0;
-    unsigned int numSpecularMaps = 0;
-
-    Texture* diffuseMaps = NULL;
-    Texture* specularMaps = NULL;
-
-    if (scene->mNumMaterials > 0) {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        diffuseMaps = loadMaterialTextures(model, material, aiTextureType_DIFFUSE, "texture_diffuse", &numDiffuseMaps);
-        specularMaps = loadMaterialTextures(model, material, aiTextureType_SPECULAR, "texture_specular", &numSpecularMaps);
+    float surfaceArea = 0.0f;
+    float uvArea = 0.0f;
+    for (unsigned int i = 0; i + 2 < numIndices; i += 3) {
+        const Vertex* a = &vertices[indices[i]];
+        const Vertex* b = &vertices[indices[i + 1]];
+        const Vertex* c = &vertices[indices[i + 2]];
+
+        vec3 ab, ac, normal;
+        vec3_sub(ab, b->Position, a->Position);
+        vec3_sub(ac, c->Position, a->Position);
+        vec3_mul_cross(normal, ab, ac);
+        surfaceArea += vec3_len(normal) * 0.5f;
+
+        float u0 = b->TexCoords[0] - a->TexCoords[0], v0 = b->TexCoords[1] - a->TexCoords[1];
+        float u1 = c->TexCoords[0] - a->TexCoords[0], v1 = c->TexCoords[1] - a->TexCoords[1];
+        uvArea += fabsf(u0 * v1 - u1 * v0) * 0.5f;
     }
+    result.uvDensity = surfaceArea > 0.0f ? sqrtf(uvArea / surfaceArea) : 0.0f;
 
     Texture* textures = NULL;
-    unsigned int numTextures = numDiffuseMaps + numSpecularMaps;
-    if (numTextures > 0) {
-        textures = calloc(numTextures, sizeof(Texture));
-
-        if (diffuseMaps != NULL) {
-            memcpy(textures, diffuseMaps, sizeof(Texture) * numDiffuseMaps);
-            free(diffuseMaps);
-        }
+    unsigned int numTextures = 0;
+    if (scene->mNumMaterials > 0) {
+        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        unsigned int numDiffuseMaps = aiGetMaterialTextureCount(material, aiTextureType_DIFFUSE);
+        unsigned int numSpecularMaps = aiGetMaterialTextureCount(material, aiTextureType_SPECULAR);
 
-        if (specularMaps != NULL) {
-            memcpy(&textures[numDiffuseMaps], specularMaps, sizeof(Texture) * numSpecularMaps);
-            free(specularMaps);
-        }
+        // diffuse maps first, then specular, written straight into the mesh's list
+        textures = arenaAlloc(&model->arena, numDiffuseMaps + numSpecularMaps, sizeof(Texture));
+        numTextures += loadMaterialTextures(model, material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
+        numTextures += loadMaterialTextures(model, material, aiTextureType_SPECULAR, "texture_specular", &textures[numTextures]);
     }
 
-    Mesh result = {0};
     result.vertices = vertices;
     result.numVertices = mesh->mNumVertices;
     result.indices = indices;
     result.numIndices = numIndices;
     result.textures = textures;
     result.numTextures = numTextures;
+    // nothing to wait for
+    if (numTextures == 0) {
+        result.materialLoaded = true;
+    }
+    model->numLoadedMaterials += result.materialLoaded;
 
     setupMesh(&result);
     return result;
 }
 
-Texture* loadMaterialTextures(Model* model, const aiMaterial* mat, unsigned int type, char* typeName, unsigned int* numTextures) {
-    *numTextures = aiGetMaterialTextureCount(mat, type);
-    if (*numTextures == 0) {
-        return NULL;
+static Texture* findModelTexture(Model* model, const char* name) {
+    for (unsigned int i = 0; i < model->numTextures; i++) {
+        if (strcmp(name, model->textures[i].path.data) == 0) {
+            return &model->textures[i];
+        }
     }
+    return NULL;
+}
 
-    if (cachedTextures == NULL) {
-        sizeCachedTextures = 2;
-        cachedTextures = calloc(sizeCachedTextures, sizeof(Texture));
+static unsigned int loadModelTexture(const Model* model, const char* name, const char* typeName) {
+    char texturePath[MODEL_MAX_PATH];
+    if (snprintf(texturePath, sizeof(texturePath), "%s/%s", model->directory, name) >= (int)sizeof(texturePath)) {
+        printf("Error: Texture path too long: %s/%s\n", model->directory, name);
     }
 
-    Texture* textures = calloc(*numTextures, sizeof(Texture));
+    // diffuse maps hold sRGB colour, everything else is data
+    return initTexture(texturePath, strcmp(typeName, "texture_diffuse") == 0);
+}
+
+unsigned int loadMaterialTextures(Model* model, const aiMaterial* mat, unsigned int type, char* typeName, Texture* textures) {
+    unsigned int numTextures = aiGetMaterialTextureCount(mat, type);
 
-    for (unsigned int i = 0; i < *numTextures; i++) {
+    for (unsigned int i = 0; i < numTextures; i++) {
         aiString str;
         aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
 
-        Texture* cachedTexture = NULL;
-        for (unsigned int iCache = 0; iCache < numCachedTextures; iCache++) {
-            if (strcmp(str.data, cachedTextures[iCache].path.data) == 0) {
-                cachedTexture = &cachedTextures[iCache];
-            }
-        }
-
-        if (cachedTexture == NULL) {
-
-            unsigned int dirLength = strlen(model->directory);
-            char* texturePath = calloc(str.length + dirLength + 2, sizeof(char));
-            strcpy(texturePath, model->directory);
-            strcat(texturePath, "/");
-            strcat(texturePath, str.data);
+        // every texture of the model is loaded once, meshes share the GL object
+        Texture* loadedTexture = findModelTexture(model, str.data);
 
+        if (loadedTexture == NULL) {
             Texture texture = {0};
-            texture.id = initTexture(texturePath);
+            // lazy materials only remember the path here
+            texture.id = lazy.active ? 0 : loadModelTexture(model, str.data, typeName);
             texture.type = typeName;
             texture.path = str;
             textures[i] = texture;
-            free(texturePath);
 
-            if (numCachedTextures == sizeCachedTextures) {
-                sizeCachedTextures = sizeCachedTextures * 2;
-                cachedTextures = realloc(cachedTextures, sizeCachedTextures * sizeof(Texture));
-            }
-
-            cachedTextures[numCachedTextures] = texture;
-            numCachedTextures++;
+            model->textures[model->numTextures++] = texture;
         } else {
-            textures[i] = *cachedTexture;
+            textures[i] = *loadedTexture;
+        }
+    }
+
+    return numTextures;
+}
+
+static unsigned int createFallbackTexture(unsigned char value) {
+    unsigned char texel[4] = {value, value, value, 255};
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, texture, MEMORY_TEXTURE_GPU, sizeof(texel));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+void setLazyMaterials(bool enabled) {
+    if (enabled && lazy.fallback[0] == 0) {
+        lazy.fallback[0] = createFallbackTexture(128);
+        lazy.fallback[1] = createFallbackTexture(0);
+    }
+    lazy.active = enabled;
+}
+
+bool lazyMaterialsActive(void) {
+    return lazy.active;
+}
+
+static void loadMeshMaterial(Model* model, Mesh* mesh) {
+    for (unsigned int t = 0; t < mesh->numTextures; t++) {
+        Texture* shared = findModelTexture(model, mesh->textures[t].path.data);
+        // a texture that failed before is tried again by the next mesh using it
+        if (shared->id == 0) {
+            shared->id = loadModelTexture(model, shared->path.data, shared->type);
         }
+        mesh->textures[t].id = shared->id;
     }
 
-    return textures;
+    mesh->materialLoaded = true;
+    mesh->materialRequested = false;
+    model->numLoadedMaterials++;
 }
 
-void drawModel(Model *model, unsigned int shader) {
+void loadRequestedMaterials(Model* model, unsigned int maxMeshes) {
+    if (model->numLoadedMaterials == model->numMeshes) {
+        return;
+    }
 
+    unsigned int numLoaded = 0;
     for (unsigned int i = 0; i < model->numMeshes; i++) {
-        drawMesh(&model->meshes[i], shader);
+        Mesh* mesh = &model->meshes[i];
+        if (!mesh->materialRequested) {
+            continue;
+        }
+        if (numLoaded < maxMeshes) {
+            loadMeshMaterial(model, mesh);
+            numLoaded++;
+        } else {
+            mesh->materialRequested = false;
+        }
     }
 
+    if (numLoaded > 0 && model->numLoadedMaterials == model->numMeshes) {
+        printf("Lazy materials: all %u meshes loaded\n", model->numMeshes);
+    }
+}
+
+unsigned int fallbackMaterialTexture(int slot) {
+    return lazy.fallback[slot];
+}
+
+void freeLazyMaterials(void) {
+    for (int i = 0; i < 2; i++) {
+        if (lazy.fallback[i] != 0) {
+            untrackGpuObject(MEMORY_OBJECT_TEXTURE, lazy.fallback[i]);
+            glDeleteTextures(1, &lazy.fallback[i]);
+        }
+    }
+    lazy = (LazyMaterials){0};
 }
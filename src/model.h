@@ -3,11 +3,24 @@
 #include <stdbool.h>
 
 #include "mesh.h"
+#include "arena.h"
+
+// directory plus texture name, assimp caps the name at 1024
+#define MODEL_MAX_PATH 2048
+// meshes whose textures are loaded per frame at most, the others keep the fallback a little longer
+#define MODEL_MATERIALS_PER_FRAME 8
 
 typedef struct model {
     Mesh* meshes;
     unsigned int numMeshes;
     char* directory;
+    // every texture the meshes reference, each loaded once
+    Texture* textures;
+    unsigned int numTextures;
+    // meshes with their textures loaded, all of them without lazy materials
+    unsigned int numLoadedMaterials;
+    // holds everything above and the meshes' vertices, indices and texture lists
+    Arena arena;
 } Model;
 
 typedef struct aiScene aiScene;
@@ -17,8 +30,21 @@ typedef struct aiMesh aiMesh;
 typedef struct aiFace aiFace;
 
 Model loadModel(char* path);
+// releases the arena and the model's GL objects; packed texture arrays stay with texpack,
+// and a bindless material table built from the model has to be freed first
+void unloadModel(Model* model);
 void processNode(Model* model, const aiNode* node, const aiScene* scene, unsigned int* meshIndex);
 Mesh processMesh(Model* model, const aiMesh* mesh, const aiScene* scene);
 unsigned int countMeshes(const aiNode* node);
-Texture* loadMaterialTextures(Model* model, const aiMaterial* mat, unsigned int type, char* typeName, unsigned int* numTextures);
-void drawModel(Model* model, unsigned int shader);
+// fills textures with the material's maps of type and returns how many
+unsigned int loadMaterialTextures(Model* model, const aiMaterial* mat, unsigned int type, char* typeName, Texture* textures);
+
+// models loaded afterwards only record texture paths and draw with a flat fallback until first recorded;
+// texture arrays and bindless tables need every texture up front, keep it off for them. Needs the GL context
+void setLazyMaterials(bool enabled);
+bool lazyMaterialsActive(void);
+// GL thread, after the draw list was recorded; meshes that are not loaded this frame have to be requested again
+void loadRequestedMaterials(Model* model, unsigned int maxMeshes);
+// diffuse 0 and specular 1
+unsigned int fallbackMaterialTexture(int slot);
+void freeLazyMaterials(void);
@@ -0,0 +1,617 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "occlusion.h"
+#include "jobs.h"
+
+// triangles with a vertex closer than this in clip w are not clipped, just skipped,
+// which can only make the buffer occlude less
+#define OCCLUSION_MIN_W 1.0e-3f
+
+OcclusionBuffer initOcclusionBuffer(void) {
+    OcclusionBuffer buffer = {0};
+
+    buffer.depth = aligned_alloc(32, OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float));
+    buffer.triangles = calloc(OCCLUSION_MAX_TRIANGLES * 9, sizeof(float));
+    buffer.triangleTiles = calloc(OCCLUSION_MAX_TRIANGLES * 4, sizeof(uint16_t));
+
+    return buffer;
+}
+
+static float aabbArea(const Mesh* mesh) {
+    float x = mesh->aabbMax[0] - mesh->aabbMin[0];
+    float y = mesh->aabbMax[1] - mesh->aabbMin[1];
+    float z = mesh->aabbMax[2] - mesh->aabbMin[2];
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+// marks the meshes with the largest bounds as occluders until the triangle budget is spent
+void selectOccluders(Model* model, unsigned int triangleBudget) {
+    unsigned int used = 0;
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        model->meshes[i].occluder = false;
+    }
+
+    while (true) {
+        Mesh* best = NULL;
+        for (unsigned int i = 0; i < model->numMeshes; i++) {
+            Mesh* mesh = &model->meshes[i];
+            unsigned int triangles = mesh->numIndices / 3;
+            if (mesh->occluder || used + triangles > triangleBudget) {
+                continue;
+            }
+
+            if (best == NULL || aabbArea(mesh) > aabbArea(best)) {
+                best = mesh;
+            }
+        }
+
+        if (best == NULL) {
+            break;
+        }
+
+        best->occluder = true;
+        used += best->numIndices / 3;
+    }
+}
+
+static void clearDepth(OcclusionBuffer* buffer) {
+    for (int i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; i++) {
+        buffer->depth[i] = 1.0f;
+    }
+}
+
+static int clampInt(int value, int min, int max) {
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+static void addOccluder(OcclusionBuffer* buffer, const Mesh* mesh, mat4x4 modelViewProjection) {
+    if (mesh->numVertices > buffer->vertexCapacity) {
+        free(buffer->vertices);
+        buffer->vertexCapacity = mesh->numVertices;
+        buffer->vertices = calloc(buffer->vertexCapacity, sizeof(vec4));
+    }
+
+    for (size_t i = 0; i < mesh->numVertices; i++) {
+        vec4 position = {mesh->vertices[i].Position[0], mesh->vertices[i].Position[1], mesh->vertices[i].Position[2], 1.0f};
+        mat4x4_mul_vec4(buffer->vertices[i], modelViewProjection, position);
+    }
+
+    for (size_t i = 0; i + 2 < mesh->numIndices; i += 3) {
+        if (buffer->numTriangles == OCCLUSION_MAX_TRIANGLES) {
+            return;
+        }
+
+        float* out = &buffer->triangles[buffer->numTriangles * 9];
+        bool skip = false;
+
+        for (int v = 0; v < 3; v++) {
+            const float* clip = buffer->vertices[mesh->indices[i + v]];
+            if (clip[3] < OCCLUSION_MIN_W) {
+                skip = true;
+                break;
+            }
+
+            float invW = 1.0f / clip[3];
+            out[v * 3 + 0] = (clip[0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+            out[v * 3 + 1] = (clip[1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+            out[v * 3 + 2] = clip[2] * invW * 0.5f + 0.5f;
+        }
+
+        if (skip) {
+            continue;
+        }
+
+        float minX = fminf(out[0], fminf(out[3], out[6]));
+        float maxX = fmaxf(out[0], fmaxf(out[3], out[6]));
+        float minY = fminf(out[1], fminf(out[4], out[7]));
+        float maxY = fmaxf(out[1], fmaxf(out[4], out[7]));
+        float minZ = fminf(out[2], fminf(out[5], out[8]));
+
+        if (maxX < 0.0f || minX >= OCCLUSION_WIDTH || maxY < 0.0f || minY >= OCCLUSION_HEIGHT || minZ > 1.0f) {
+            continue;
+        }
+
+        uint16_t* tiles = &buffer->triangleTiles[buffer->numTriangles * 4];
+        tiles[0] = clampInt((int)minX / OCCLUSION_TILE_WIDTH, 0, OCCLUSION_TILES_X - 1);
+        tiles[1] = clampInt((int)maxX / OCCLUSION_TILE_WIDTH, 0, OCCLUSION_TILES_X - 1);
+        tiles[2] = clampInt((int)minY / OCCLUSION_TILE_HEIGHT, 0, OCCLUSION_TILES_Y - 1);
+        tiles[3] = clampInt((int)maxY / OCCLUSION_TILE_HEIGHT, 0, OCCLUSION_TILES_Y - 1);
+
+        buffer->numTriangles++;
+    }
+}
+
+static void binTriangles(OcclusionBuffer* buffer) {
+    memset(buffer->binCounts, 0, sizeof(buffer->binCounts));
+
+    for (unsigned int t = 0; t < buffer->numTriangles; t++) {
+        const uint16_t* tiles = &buffer->triangleTiles[t * 4];
+        for (int ty = tiles[2]; ty <= tiles[3]; ty++) {
+            for (int tx = tiles[0]; tx <= tiles[1]; tx++) {
+                buffer->binCounts[tx + ty * OCCLUSION_TILES_X]++;
+            }
+        }
+    }
+
+    uint32_t total = 0;
+    for (int i = 0; i < OCCLUSION_TILE_COUNT; i++) {
+        buffer->binOffsets[i] = total;
+        total += buffer->binCounts[i];
+        buffer->binCounts[i] = 0;
+    }
+    buffer->binOffsets[OCCLUSION_TILE_COUNT] = total;
+
+    if (total > buffer->binCapacity) {
+        free(buffer->bins);
+        buffer->binCapacity = total;
+        buffer->bins = calloc(buffer->binCapacity, sizeof(uint32_t));
+    }
+
+    for (unsigned int t = 0; t < buffer->numTriangles; t++) {
+        const uint16_t* tiles = &buffer->triangleTiles[t * 4];
+        for (int ty = tiles[2]; ty <= tiles[3]; ty++) {
+            for (int tx = tiles[0]; tx <= tiles[1]; tx++) {
+                int tile = tx + ty * OCCLUSION_TILES_X;
+                buffer->bins[buffer->binOffsets[tile] + buffer->binCounts[tile]] = t;
+                buffer->binCounts[tile]++;
+            }
+        }
+    }
+}
+
+// rasterizes every triangle binned to one tile, keeping the nearest depth per pixel.
+// tiles never share pixels so they can be rasterized in any order or in parallel.
+// wide picks the AVX2 loop when it is compiled in, both write the same depths
+static void rasterizeTile(OcclusionBuffer* buffer, int tile, bool wide) {
+#if !defined(__AVX2__)
+    (void)wide;
+#endif
+    int tileX0 = (tile % OCCLUSION_TILES_X) * OCCLUSION_TILE_WIDTH;
+    int tileY0 = (tile / OCCLUSION_TILES_X) * OCCLUSION_TILE_HEIGHT;
+
+    for (uint32_t b = buffer->binOffsets[tile]; b < buffer->binOffsets[tile] + buffer->binCounts[tile]; b++) {
+        const float* tri = &buffer->triangles[buffer->bins[b] * 9];
+
+        float x0 = tri[0], y0 = tri[1], z0 = tri[2];
+        float x1 = tri[3], y1 = tri[4], z1 = tri[5];
+        float x2 = tri[6], y2 = tri[7], z2 = tri[8];
+
+        float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        if (area == 0.0f) {
+            continue;
+        }
+
+        // occluders are drawn double sided, flip clockwise triangles
+        if (area < 0.0f) {
+            float tx = x1, ty = y1, tz = z1;
+            x1 = x2; y1 = y2; z1 = z2;
+            x2 = tx; y2 = ty; z2 = tz;
+            area = -area;
+        }
+
+        // edge functions A * x + B * y + C, positive inside
+        float a0 = y1 - y2, b0 = x2 - x1, c0 = -(a0 * x1 + b0 * y1);
+        float a1 = y2 - y0, b1 = x0 - x2, c1 = -(a1 * x2 + b1 * y2);
+        float a2 = y0 - y1, b2 = x1 - x0, c2 = -(a2 * x0 + b2 * y0);
+
+        // depth plane z = zA * x + zB * y + zC from the barycentrics of vertex 1 and 2
+        float invArea = 1.0f / area;
+        float zA = (a1 * (z1 - z0) + a2 * (z2 - z0)) * invArea;
+        float zB = (b1 * (z1 - z0) + b2 * (z2 - z0)) * invArea;
+        float zC = z0 + (c1 * (z1 - z0) + c2 * (z2 - z0)) * invArea;
+
+        int minX = clampInt((int)floorf(fminf(x0, fminf(x1, x2))), tileX0, tileX0 + OCCLUSION_TILE_WIDTH - 1);
+        int maxX = clampInt((int)ceilf(fmaxf(x0, fmaxf(x1, x2))), tileX0, tileX0 + OCCLUSION_TILE_WIDTH - 1);
+        int minY = clampInt((int)floorf(fminf(y0, fminf(y1, y2))), tileY0, tileY0 + OCCLUSION_TILE_HEIGHT - 1);
+        int maxY = clampInt((int)ceilf(fmaxf(y0, fmaxf(y1, y2))), tileY0, tileY0 + OCCLUSION_TILE_HEIGHT - 1);
+
+        for (int y = minY; y <= maxY; y++) {
+            float py = y + 0.5f;
+            float row0 = b0 * py + c0;
+            float row1 = b1 * py + c1;
+            float row2 = b2 * py + c2;
+            float rowZ = zB * py + zC;
+            float* depthRow = &buffer->depth[y * OCCLUSION_WIDTH];
+
+            int x = minX;
+
+#if defined(__AVX2__)
+            // eight pixels per step; the tile width is a multiple of 8 so aligned blocks stay inside the tile
+            x = wide ? minX & ~7 : minX;
+            __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+            __m256 zero = _mm256_setzero_ps();
+            for (; wide && x <= maxX; x += 8) {
+                __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), offsets);
+
+                __m256 w0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a0), px), _mm256_set1_ps(row0));
+                __m256 w1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a1), px), _mm256_set1_ps(row1));
+                __m256 w2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a2), px), _mm256_set1_ps(row2));
+
+                __m256 inside = _mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ),
+                                _mm256_and_ps(_mm256_cmp_ps(w1, zero, _CMP_GE_OQ), _mm256_cmp_ps(w2, zero, _CMP_GE_OQ)));
+                if (_mm256_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(zA), px), _mm256_set1_ps(rowZ));
+                __m256 current = _mm256_load_ps(&depthRow[x]);
+                __m256 nearest = _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside);
+                _mm256_store_ps(&depthRow[x], nearest);
+            }
+#endif
+
+            for (; x <= maxX; x++) {
+                float px = x + 0.5f;
+                if (a0 * px + row0 < 0.0f || a1 * px + row1 < 0.0f || a2 * px + row2 < 0.0f) {
+                    continue;
+                }
+
+                float z = zA * px + rowZ;
+                if (z < depthRow[x]) {
+                    depthRow[x] = z;
+                }
+            }
+        }
+    }
+}
+
+typedef struct rasterJob {
+    OcclusionBuffer* buffer;
+    bool wide;
+} RasterJob;
+
+static void rasterizeTiles(void* data, int begin, int end) {
+    RasterJob* job = data;
+    for (int tile = begin; tile < end; tile++) {
+        rasterizeTile(job->buffer, tile, job->wide);
+    }
+}
+
+static void rasterizeOccluders(OcclusionBuffer* buffer, bool wide, bool parallel) {
+    RasterJob job = {buffer, wide};
+    if (parallel) {
+        parallelFor(OCCLUSION_TILE_COUNT, 1, rasterizeTiles, &job);
+    } else {
+        rasterizeTiles(&job, 0, OCCLUSION_TILE_COUNT);
+    }
+}
+
+// true when some pixel under the screen rect of the bounding box is farther than its nearest corner
+static bool testBounds(OcclusionBuffer* buffer, const Mesh* mesh, mat4x4 modelViewProjection) {
+    float minX = INFINITY, maxX = -INFINITY;
+    float minY = INFINITY, maxY = -INFINITY;
+    float minZ = INFINITY;
+
+    for (int corner = 0; corner < 8; corner++) {
+        vec4 position = {
+            (corner & 1) ? mesh->aabbMax[0] : mesh->aabbMin[0],
+            (corner & 2) ? mesh->aabbMax[1] : mesh->aabbMin[1],
+            (corner & 4) ? mesh->aabbMax[2] : mesh->aabbMin[2],
+            1.0f,
+        };
+
+        vec4 clip;
+        mat4x4_mul_vec4(clip, modelViewProjection, position);
+        if (clip[3] < OCCLUSION_MIN_W) {
+            // crosses the near plane, treat as visible
+            return true;
+        }
+
+        float invW = 1.0f / clip[3];
+        float x = (clip[0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        float y = (clip[1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        float z = clip[2] * invW * 0.5f + 0.5f;
+
+        minX = fminf(minX, x);
+        maxX = fmaxf(maxX, x);
+        minY = fminf(minY, y);
+        maxY = fmaxf(maxY, y);
+        minZ = fminf(minZ, z);
+    }
+
+    if (maxX < 0.0f || minX >= OCCLUSION_WIDTH || maxY < 0.0f || minY >= OCCLUSION_HEIGHT || minZ > 1.0f) {
+        // off screen; frustum culling is not this module's job
+        return true;
+    }
+
+    int x0 = clampInt((int)floorf(minX), 0, OCCLUSION_WIDTH - 1);
+    int x1 = clampInt((int)ceilf(maxX), 0, OCCLUSION_WIDTH - 1);
+    int y0 = clampInt((int)floorf(minY), 0, OCCLUSION_HEIGHT - 1);
+    int y1 = clampInt((int)ceilf(maxY), 0, OCCLUSION_HEIGHT - 1);
+
+    for (int y = y0; y <= y1; y++) {
+        const float* depthRow = &buffer->depth[y * OCCLUSION_WIDTH];
+        for (int x = x0; x <= x1; x++) {
+            if (depthRow[x] >= minZ) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void prepareOccluders(OcclusionBuffer* buffer, Model* model, mat4x4 modelViewProjection) {
+    buffer->numTriangles = 0;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        if (model->meshes[i].occluder) {
+            addOccluder(buffer, &model->meshes[i], modelViewProjection);
+        }
+    }
+    binTriangles(buffer);
+}
+
+void cullModel(OcclusionBuffer* buffer, Model* model, mat4x4 modelViewProjection) {
+    prepareOccluders(buffer, model, modelViewProjection);
+    clearDepth(buffer);
+    rasterizeOccluders(buffer, true, true);
+
+    buffer->numTested = 0;
+    buffer->numCulled = 0;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* mesh = &model->meshes[i];
+        mesh->visible = testBounds(buffer, mesh, modelViewProjection);
+
+        buffer->numTested++;
+        if (!mesh->visible) {
+            buffer->numCulled++;
+        }
+    }
+}
+
+void freeOcclusionBuffer(OcclusionBuffer* buffer) {
+    free(buffer->depth);
+    free(buffer->triangles);
+    free(buffer->triangleTiles);
+    free(buffer->bins);
+    free(buffer->vertices);
+}
+
+// synthetic meshes for the test and the benchmark, positions and indices only
+static Mesh boxMesh(float x0, float y0, float z0, float x1, float y1, float z1, bool occluder) {
+    static const unsigned int faces[36] = {
+        0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3,
+    };
+
+    Mesh mesh = {.numVertices = 8, .numIndices = 36, .visible = true, .occluder = occluder};
+    mesh.vertices = calloc(8, sizeof(Vertex));
+    mesh.indices = malloc(sizeof(faces));
+    memcpy(mesh.indices, faces, sizeof(faces));
+    for (int corner = 0; corner < 8; corner++) {
+        mesh.vertices[corner].Position[0] = (corner & 1) ? x1 : x0;
+        mesh.vertices[corner].Position[1] = (corner & 2) ? y1 : y0;
+        mesh.vertices[corner].Position[2] = (corner & 4) ? z1 : z0;
+    }
+    vec3 min = {x0, y0, z0};
+    vec3 max = {x1, y1, z1};
+    memcpy(mesh.aabbMin, min, sizeof(vec3));
+    memcpy(mesh.aabbMax, max, sizeof(vec3));
+    return mesh;
+}
+
+// a rectangle facing the camera, split into divisions x divisions quads
+static Mesh wallMesh(float x0, float y0, float x1, float y1, float z, int divisions) {
+    int side = divisions + 1;
+    Mesh mesh = {.visible = true, .occluder = true};
+    mesh.numVertices = (size_t)side * side;
+    mesh.numIndices = (size_t)divisions * divisions * 6;
+    mesh.vertices = calloc(mesh.numVertices, sizeof(Vertex));
+    mesh.indices = malloc(mesh.numIndices * sizeof(unsigned int));
+
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            float* position = mesh.vertices[y * side + x].Position;
+            position[0] = x0 + (x1 - x0) * x / divisions;
+            position[1] = y0 + (y1 - y0) * y / divisions;
+            position[2] = z;
+        }
+    }
+
+    unsigned int* index = mesh.indices;
+    for (int y = 0; y < divisions; y++) {
+        for (int x = 0; x < divisions; x++) {
+            unsigned int corner = y * side + x;
+            unsigned int quad[6] = {corner, corner + 1, corner + side + 1, corner, corner + side + 1, corner + side};
+            memcpy(index, quad, sizeof(quad));
+            index += 6;
+        }
+    }
+
+    vec3 min = {x0, y0, z};
+    vec3 max = {x1, y1, z};
+    memcpy(mesh.aabbMin, min, sizeof(vec3));
+    memcpy(mesh.aabbMax, max, sizeof(vec3));
+    return mesh;
+}
+
+static void freeSyntheticModel(Model* model) {
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        free(model->meshes[i].vertices);
+        free(model->meshes[i].indices);
+    }
+    free(model->meshes);
+    *model = (Model){0};
+}
+
+// camera at the origin looking down -z, x and y shifted a little per round
+static void syntheticViewProjection(mat4x4 viewProjection, float shiftX, float shiftY) {
+    mat4x4 projection, view;
+    mat4x4_perspective(projection, 1.0471976f, (float)OCCLUSION_WIDTH / OCCLUSION_HEIGHT, 0.1f, 100.0f);
+    mat4x4_translate(view, shiftX, shiftY, 0.0f);
+    mat4x4_mul(viewProjection, projection, view);
+}
+
+typedef struct occlusionScene {
+    const char* name;
+    // bit i set when mesh i has to be culled
+    uint32_t expectedCulled;
+} OcclusionScene;
+
+static Model buildTestScene(int scene) {
+    Model model = {0};
+    model.meshes = calloc(8, sizeof(Mesh));
+    Mesh* m = model.meshes;
+
+    if (scene == 0) {
+        // one wall, boxes behind it, in front of it, sticking out beside it, through the near plane and off screen
+        m[0] = boxMesh(-4.0f, -2.0f, -5.2f, 4.0f, 2.0f, -5.0f, true);
+        m[1] = boxMesh(-1.0f, -1.0f, -9.0f, 1.0f, 1.0f, -8.0f, false);
+        m[2] = boxMesh(-1.0f, -1.0f, -3.0f, 1.0f, 1.0f, -2.5f, false);
+        m[3] = boxMesh(5.0f, -0.5f, -9.0f, 9.0f, 0.5f, -8.0f, false);
+        m[4] = boxMesh(-0.5f, -0.5f, -1.0f, 0.5f, 0.5f, 0.5f, false);
+        m[5] = boxMesh(50.0f, -0.5f, -9.0f, 51.0f, 0.5f, -8.0f, false);
+        model.numMeshes = 6;
+    } else if (scene == 1) {
+        // a near wall on the left overlapping a far one on the right, boxes behind each and one across the seam
+        m[0] = wallMesh(-4.0f, -2.0f, 0.5f, 2.0f, -5.0f, 4);
+        m[1] = wallMesh(0.0f, -4.0f, 8.0f, 4.0f, -10.0f, 4);
+        m[2] = boxMesh(-3.0f, -1.0f, -8.0f, -1.0f, 1.0f, -7.0f, false);
+        m[3] = boxMesh(1.0f, -1.0f, -8.0f, 3.0f, 1.0f, -7.0f, false);
+        m[4] = boxMesh(1.0f, -1.0f, -13.0f, 3.0f, 1.0f, -12.0f, false);
+        m[5] = boxMesh(-1.0f, -1.0f, -13.0f, 1.0f, 1.0f, -12.0f, false);
+        model.numMeshes = 6;
+    } else {
+        // the walls of scene 1 without being picked as occluders hide nothing
+        m[0] = wallMesh(-4.0f, -2.0f, 0.5f, 2.0f, -5.0f, 4);
+        m[1] = wallMesh(0.0f, -4.0f, 8.0f, 4.0f, -10.0f, 4);
+        m[0].occluder = m[1].occluder = false;
+        m[2] = boxMesh(-3.0f, -1.0f, -8.0f, -1.0f, 1.0f, -7.0f, false);
+        m[3] = boxMesh(1.0f, -1.0f, -13.0f, 3.0f, 1.0f, -12.0f, false);
+        model.numMeshes = 4;
+    }
+    return model;
+}
+
+bool testOcclusion(int rounds) {
+    static const OcclusionScene scenes[] = {
+        {"wall", 1u << 1},
+        {"two walls", 1u << 2 | 1u << 4 | 1u << 5},
+        {"no occluders", 0},
+    };
+    int numScenes = sizeof(scenes) / sizeof(scenes[0]);
+
+    OcclusionBuffer buffer = initOcclusionBuffer();
+    float* reference = malloc(OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float));
+    bool passed = true;
+    unsigned int numCompared = 0;
+
+    for (int round = 0; round < rounds && passed; round++) {
+        for (int s = 0; s < numScenes && passed; s++) {
+            Model model = buildTestScene(s);
+            mat4x4 viewProjection;
+            syntheticViewProjection(viewProjection, 0.01f * (round % 7) - 0.03f, 0.01f * (round % 5) - 0.02f);
+
+            cullModel(&buffer, &model, viewProjection);
+            uint32_t culled = 0;
+            for (unsigned int i = 0; i < model.numMeshes; i++) {
+                culled |= (uint32_t)!model.meshes[i].visible << i;
+            }
+            if (culled != scenes[s].expectedCulled) {
+                printf("Occlusion test failed: %s round %d culled mask %x, expected %x\n", scenes[s].name, round, culled,
+                       scenes[s].expectedCulled);
+                passed = false;
+            }
+
+            // the buffer cullModel left behind has to match every kernel on one thread and over the job system
+            memcpy(reference, buffer.depth, OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float));
+            for (int mode = 0; mode < 3 && passed; mode++) {
+                clearDepth(&buffer);
+                rasterizeOccluders(&buffer, mode > 0, mode == 2);
+                passed = memcmp(reference, buffer.depth, OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float)) == 0;
+                if (!passed) {
+                    printf("Occlusion test failed: %s round %d depth differs in %s mode\n", scenes[s].name, round,
+                           mode == 0 ? "scalar" : mode == 1 ? "wide" : "parallel wide");
+                }
+                numCompared++;
+            }
+            freeSyntheticModel(&model);
+        }
+    }
+
+#if defined(__AVX2__)
+    const char* kernels = "scalar and AVX2";
+#else
+    const char* kernels = "scalar only, AVX2 not compiled in";
+#endif
+    printf("Occlusion test %s: %d rounds of %d scenes, %u depth buffers compared, %s\n", passed ? "passed" : "FAILED",
+           rounds, numScenes, numCompared, kernels);
+    free(reference);
+    freeOcclusionBuffer(&buffer);
+    return passed;
+}
+
+static double elapsedMs(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void benchmarkOcclusion(void) {
+    Model model = {0};
+    model.meshes = calloc(OCCLUSION_BENCH_WALLS + OCCLUSION_BENCH_BOXES, sizeof(Mesh));
+
+    // walls on a 4 wide grid at staggered depths, overlapping each other on screen
+    for (int i = 0; i < OCCLUSION_BENCH_WALLS; i++) {
+        float x = -6.0f + (i % 4) * 3.0f;
+        float y = -3.0f + (i / 4 % 4) * 1.5f;
+        float z = -6.0f - (i % 5) * 1.5f;
+        model.meshes[model.numMeshes++] = wallMesh(x, y, x + 3.5f, y + 2.0f, z, OCCLUSION_BENCH_WALL_DIVISIONS);
+    }
+
+    uint32_t state = 29;
+    for (int i = 0; i < OCCLUSION_BENCH_BOXES; i++) {
+        float r[3];
+        for (int k = 0; k < 3; k++) {
+            state = state * 1664525u + 1013904223u;
+            r[k] = (float)(state >> 8) / (float)(1u << 24);
+        }
+        float x = -8.0f + r[0] * 16.0f;
+        float y = -4.0f + r[1] * 8.0f;
+        float z = -3.0f - r[2] * 20.0f;
+        model.meshes[model.numMeshes++] = boxMesh(x, y, z - 0.3f, x + 0.3f, y + 0.3f, z, false);
+    }
+
+    OcclusionBuffer buffer = initOcclusionBuffer();
+    mat4x4 viewProjection;
+    syntheticViewProjection(viewProjection, 0.0f, 0.0f);
+    prepareOccluders(&buffer, &model, viewProjection);
+
+    // rasterization alone with each kernel on one thread and over the job system, then all of cullModel
+    double ms[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int repeat = 0; repeat < OCCLUSION_BENCH_REPEAT; repeat++) {
+        for (int mode = 0; mode < 3; mode++) {
+            clearDepth(&buffer);
+            Uint64 start = SDL_GetPerformanceCounter();
+            rasterizeOccluders(&buffer, mode > 0, mode == 2);
+            ms[mode] += elapsedMs(start);
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        cullModel(&buffer, &model, viewProjection);
+        ms[3] += elapsedMs(start);
+    }
+    for (int i = 0; i < 4; i++) {
+        ms[i] /= OCCLUSION_BENCH_REPEAT;
+    }
+
+    printf("Occlusion benchmark, %u occluder triangles, %d boxes tested, %u culled:\n", buffer.numTriangles,
+           OCCLUSION_BENCH_BOXES, buffer.numCulled);
+    printf("  raster scalar        %8.3f ms\n", ms[0]);
+#if defined(__AVX2__)
+    printf("  raster AVX2          %8.3f ms, %.2fx\n", ms[1], ms[0] / ms[1]);
+#endif
+    printf("  raster over %2d jobs  %8.3f ms, %.2fx\n", jobWorkerCount() + 1, ms[2], ms[0] / ms[2]);
+    printf("  cullModel            %8.3f ms\n", ms[3]);
+
+    freeOcclusionBuffer(&buffer);
+    freeSyntheticModel(&model);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <linmath.h>
+
+#include "model.h"
+
+// low resolution depth buffer the occluders are rasterized into on the CPU
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_WIDTH 32
+#define OCCLUSION_TILE_HEIGHT 16
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_HEIGHT)
+#define OCCLUSION_TILE_COUNT (OCCLUSION_TILES_X * OCCLUSION_TILES_Y)
+
+// triangle budget for the meshes picked as occluders
+#define OCCLUSION_MAX_TRIANGLES 65536
+
+// synthetic benchmark scene: a grid of subdivided walls in front of and behind many small boxes
+#define OCCLUSION_BENCH_WALLS 16
+#define OCCLUSION_BENCH_WALL_DIVISIONS 40
+#define OCCLUSION_BENCH_BOXES 4096
+#define OCCLUSION_BENCH_REPEAT 50
+
+typedef struct occlusionBuffer {
+    // window space depth in [0, 1], 1 is the far plane
+    float *depth;
+
+    // screen space x, y, z of all three vertices per occluder triangle
+    float *triangles;
+    uint16_t *triangleTiles;
+    unsigned int numTriangles;
+
+    // per tile lists of triangle indices
+    uint32_t binOffsets[OCCLUSION_TILE_COUNT + 1];
+    uint32_t binCounts[OCCLUSION_TILE_COUNT];
+    uint32_t *bins;
+    size_t binCapacity;
+
+    // clip space scratch for the mesh being transformed
+    vec4 *vertices;
+    size_t vertexCapacity;
+
+    unsigned int numTested;
+    unsigned int numCulled;
+} OcclusionBuffer;
+
+OcclusionBuffer initOcclusionBuffer(void);
+void selectOccluders(Model* model, unsigned int triangleBudget);
+void cullModel(OcclusionBuffer* buffer, Model* model, mat4x4 modelViewProjection);
+void freeOcclusionBuffer(OcclusionBuffer* buffer);
+
+// fixed scenes with known culled sets, and scalar against AVX2 and serial against parallel depth buffers
+bool testOcclusion(int rounds);
+// rasterization and culling times on the synthetic occluder heavy scene
+void benchmarkOcclusion(void);
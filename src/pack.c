@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "pack.h"
+
+bool normalizePackPath(const char* path, char* out, size_t size) {
+    // start of every kept segment, to drop them again on ".."
+    size_t starts[PACK_MAX_PATH / 2];
+    unsigned int numSegments = 0;
+    size_t length = 0;
+
+    // packs only hold relative paths, absolute ones always come from disk
+    if (size == 0 || path[0] == '/') {
+        return false;
+    }
+
+    const char* segment = path;
+    while (*segment) {
+        const char* end = strchr(segment, '/');
+        size_t segmentLength = end ? (size_t)(end - segment) : strlen(segment);
+
+        if (segmentLength == 2 && segment[0] == '.' && segment[1] == '.') {
+            if (numSegments == 0) {
+                return false;
+            }
+            length = starts[--numSegments];
+        } else if (segmentLength > 0 && !(segmentLength == 1 && segment[0] == '.')) {
+            size_t separator = numSegments > 0;
+            if (length + separator + segmentLength + 1 > size || numSegments == sizeof(starts) / sizeof(starts[0])) {
+                return false;
+            }
+
+            starts[numSegments++] = length;
+            if (separator) {
+                out[length++] = '/';
+            }
+            memcpy(out + length, segment, segmentLength);
+            length += segmentLength;
+        }
+
+        segment += segmentLength + (end != NULL);
+    }
+
+    out[length] = '\0';
+    return length > 0;
+}
+
+uint64_t hashPackPath(const char* path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = path; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+const PackEntry* findPackEntry(const unsigned char* pack, const char* normalizedPath, uint64_t hash) {
+    const PackHeader* header = (const PackHeader*)pack;
+    const PackEntry* entries = (const PackEntry*)(pack + header->entriesOffset);
+    const uint32_t* slots = (const uint32_t*)(pack + header->slotsOffset);
+    const char* names = (const char*)(pack + header->namesOffset);
+
+    // slots hold entry index + 1, 0 ends the probe
+    for (uint32_t slot = hash & (header->numSlots - 1);; slot = (slot + 1) & (header->numSlots - 1)) {
+        uint32_t index = slots[slot];
+        if (index == 0) {
+            return NULL;
+        }
+
+        const PackEntry* entry = &entries[index - 1];
+        if (entry->hash == hash && strcmp(names + entry->nameOffset, normalizedPath) == 0) {
+            return entry;
+        }
+    }
+}
+
+bool validPackHeader(const unsigned char* pack, size_t size) {
+    if (size < sizeof(PackHeader)) {
+        return false;
+    }
+
+    const PackHeader* header = (const PackHeader*)pack;
+    if (memcmp(header->magic, "PACK", 4) != 0 || header->version != PACK_VERSION || header->size != size) {
+        return false;
+    }
+
+    // a power of two with at least one empty slot, or probing would not end
+    if (header->numSlots == 0 || (header->numSlots & (header->numSlots - 1)) != 0 || header->numSlots <= header->numEntries) {
+        return false;
+    }
+
+    // tables after the header and aligned, each checked against the size before adding to its offset
+    if (header->entriesOffset < sizeof(PackHeader) || header->entriesOffset % _Alignof(PackEntry) != 0 ||
+        header->entriesOffset > size || header->numEntries > (size - header->entriesOffset) / sizeof(PackEntry) ||
+        header->slotsOffset % _Alignof(uint32_t) != 0 || header->slotsOffset > size ||
+        header->numSlots > (size - header->slotsOffset) / sizeof(uint32_t)) {
+        return false;
+    }
+
+    if (header->entriesOffset + (uint64_t)header->numEntries * sizeof(PackEntry) > header->slotsOffset ||
+        header->slotsOffset + (uint64_t)header->numSlots * sizeof(uint32_t) > header->namesOffset ||
+        header->namesOffset > header->dataOffset || header->dataOffset > size) {
+        return false;
+    }
+
+    const PackEntry* entries = (const PackEntry*)(pack + header->entriesOffset);
+    const uint32_t* slots = (const uint32_t*)(pack + header->slotsOffset);
+    for (uint32_t i = 0; i < header->numEntries; i++) {
+        const PackEntry* entry = &entries[i];
+        if (entry->offset < header->dataOffset || entry->offset > size || entry->storedSize > size - entry->offset ||
+            entry->nameOffset >= header->dataOffset - header->namesOffset ||
+            (entry->compression == PACK_COMPRESSION_NONE && entry->storedSize != entry->size)) {
+            return false;
+        }
+    }
+    // one slot per entry and the rest empty, so probes always end
+    uint32_t numUsed = 0;
+    for (uint32_t i = 0; i < header->numSlots; i++) {
+        if (slots[i] > header->numEntries) {
+            return false;
+        }
+        numUsed += slots[i] != 0;
+    }
+    if (numUsed != header->numEntries) {
+        return false;
+    }
+
+    // and every entry is found by probing from its hash before an empty slot
+    for (uint32_t i = 0; i < header->numEntries; i++) {
+        uint32_t slot = entries[i].hash & (header->numSlots - 1);
+        while (slots[slot] != i + 1) {
+            if (slots[slot] == 0) {
+                return false;
+            }
+            slot = (slot + 1) & (header->numSlots - 1);
+        }
+    }
+
+    // the name block has to end in a terminator for the lookups to stop
+    return header->dataOffset > header->namesOffset && pack[header->dataOffset - 1] == '\0';
+}
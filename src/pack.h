@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// on disk layout, shared by the runtime and tools/assetpack.c:
+// header, entries sorted by hash, hash slots, NUL terminated names, then the data of every entry
+#define PACK_VERSION 1
+// entry data starts on a multiple of this, enough for any of the stored headers
+#define PACK_ALIGNMENT 64
+// slots per entry at least, the slot count is a power of two
+#define PACK_SLOTS_PER_ENTRY 2
+#define PACK_MAX_PATH 1024
+
+typedef enum packCompression {
+    PACK_COMPRESSION_NONE,
+    // the entry holds an LZ container from lz.h, storedSize is the container's
+    PACK_COMPRESSION_LZ,
+} PackCompression;
+
+typedef struct packHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t numSlots;
+    uint64_t entriesOffset;
+    uint64_t slotsOffset;
+    uint64_t namesOffset;
+    uint64_t dataOffset;
+    // of the whole file, a truncated pack is rejected
+    uint64_t size;
+} PackHeader;
+
+typedef struct packEntry {
+    uint64_t hash;
+    // from the start of the pack
+    uint64_t offset;
+    // bytes once unpacked, and as stored
+    uint64_t size;
+    uint64_t storedSize;
+    // modification time of the packed file, cooked caches compare it against their source
+    int64_t sourceTime;
+    // into the name block
+    uint32_t nameOffset;
+    uint32_t compression;
+} PackEntry;
+
+// relative and without "." or ".." segments, e.g. "./shaders/../assets/a.png" becomes "assets/a.png"
+bool normalizePackPath(const char* path, char* out, size_t size);
+// of a normalized path
+uint64_t hashPackPath(const char* path);
+// O(1) through the slot table of a whole pack in memory, NULL when the path is not packed
+const PackEntry* findPackEntry(const unsigned char* pack, const char* normalizedPath, uint64_t hash);
+// header, tables and entry bounds, once at mount so lookups can trust them
+bool validPackHeader(const unsigned char* pack, size_t size);
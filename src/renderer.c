@@ -0,0 +1,584 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+#include <SDL2/SDL.h>
+
+#include "renderer.h"
+#include "shader.h"
+#include "shaderreload.h"
+#include "telemetry.h"
+#include "memtrack.h"
+
+static const char* passNames[RENDER_PASS_COUNT] = {
+    "depth",
+    "color",
+    "geometry",
+    "lighting",
+    "lights",
+};
+
+static const float cubeVertices[] = {
+    // positions          // normals           // texture coords
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+    0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+};
+
+// material shaders switch to handle tables with bindless textures, or to sampler arrays when textures are packed
+static const char* materialDefines(void) {
+    static char defines[128];
+    if (bindlessMaterialsActive()) {
+        snprintf(defines, sizeof(defines), "#extension GL_ARB_bindless_texture : require\n#define MATERIAL_BINDLESS\n#define MATERIAL_MAX %d\n", MATERIAL_MAX);
+        return defines;
+    }
+    return texturePackingActive() ? "#define MATERIAL_ARRAYS\n" : "";
+}
+
+// block bindings are program state, set again whenever a program is created
+static void bindFrameBlocks(unsigned int shader) {
+    unsigned int camera = glGetUniformBlockIndex(shader, "Camera");
+    if (camera != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader, camera, CAMERA_UBO_BINDING);
+    }
+
+    unsigned int lights = glGetUniformBlockIndex(shader, "Lights");
+    if (lights != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader, lights, LIGHTS_UBO_BINDING);
+    }
+}
+
+Renderer initRenderer(RendererType type, int width, int height, float near, float far) {
+    Renderer renderer = {0};
+    renderer.width = width;
+    renderer.height = height;
+
+    renderer.shaderDefault = RenderShaderCreateDefines("./shaders/default.vert", "./shaders/default.frag", materialDefines());
+    renderer.shaderLight = RenderShaderCreate("./shaders/light.vert", "./shaders/light.frag");
+
+    glGenBuffers(1, &renderer.lightVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.lightVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, renderer.lightVBO, MEMORY_RENDER_GPU, sizeof(cubeVertices));
+
+    glGenVertexArrays(1, &renderer.lightVAO);
+    glBindVertexArray(renderer.lightVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.lightVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // a mat4 attribute takes four locations, one column each; storage is sized on the first frame
+    glGenBuffers(1, &renderer.lightInstanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.lightInstanceVBO);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4x4), (void*)(column * sizeof(vec4)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+
+    // the full screen triangle is generated from gl_VertexID, core profile still wants a VAO bound
+    glGenVertexArrays(1, &renderer.screenVAO);
+    glBindVertexArray(0);
+
+    renderer.clusters = initClusterGrid(near, far);
+
+    renderer.shaderDepth = RenderShaderCreate("./shaders/depth.vert", "./shaders/depth.frag");
+    for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glGenQueries(2, renderer.sampleQueries[i]);
+    }
+    renderer.timer = initGpuTimer(passNames, RENDER_PASS_COUNT);
+
+    renderer.occlusionEnabled = true;
+    renderer.occlusion = initOcclusionBuffer();
+
+    renderer.ring = initRingBuffer(RENDERER_RING_SEGMENT_SIZE);
+
+    setRendererType(&renderer, type);
+    setDepthPrepassMode(&renderer, DEPTH_PREPASS_AUTO);
+
+    // batched programs are still compiling, whoever opened the batch binds after finishing it
+    if (!shaderBatchOpen()) {
+        bindRendererShaders(&renderer);
+    }
+
+    return renderer;
+}
+
+void bindRendererShaders(Renderer* renderer) {
+    // programs that failed in the batch become -1, the same as a failed unbatched create
+    renderer->shaderDefault = batchedShader(renderer->shaderDefault);
+    renderer->shaderLight = batchedShader(renderer->shaderLight);
+    renderer->shaderDepth = batchedShader(renderer->shaderDepth);
+    if (renderer->shaderGeometry) {
+        renderer->shaderGeometry = batchedShader(renderer->shaderGeometry);
+        renderer->shaderDeferred = batchedShader(renderer->shaderDeferred);
+    }
+
+    bindFrameBlocks(renderer->shaderDefault);
+    bindFrameBlocks(renderer->shaderLight);
+    bindFrameBlocks(renderer->shaderDepth);
+    if (renderer->shaderGeometry) {
+        bindFrameBlocks(renderer->shaderGeometry);
+        bindFrameBlocks(renderer->shaderDeferred);
+    }
+}
+
+void setRendererType(Renderer* renderer, RendererType type) {
+    renderer->type = type;
+
+    if (type == RENDERER_DEFERRED && renderer->gbuffer.FBO == 0) {
+        renderer->shaderGeometry = RenderShaderCreateDefines("./shaders/default.vert", "./shaders/gbuffer.frag", materialDefines());
+        renderer->shaderDeferred = RenderShaderCreate("./shaders/deferred.vert", "./shaders/deferred.frag");
+        if (!shaderBatchOpen()) {
+            bindFrameBlocks(renderer->shaderGeometry);
+            bindFrameBlocks(renderer->shaderDeferred);
+        }
+        renderer->gbuffer = initGBuffer(renderer->width, renderer->height);
+    }
+}
+
+static void swapFrameBlocks(unsigned int shader, void* data) {
+    (void)data;
+    bindFrameBlocks(shader);
+}
+
+// the renderer has to stay at this address while the programs are watched
+void watchRendererShaders(Renderer* renderer) {
+    watchShaderProgram(&renderer->shaderDefault, "./shaders/default.vert", "./shaders/default.frag", materialDefines,
+                       swapFrameBlocks, NULL);
+    watchShaderProgram(&renderer->shaderLight, "./shaders/light.vert", "./shaders/light.frag", NULL, swapFrameBlocks, NULL);
+    watchShaderProgram(&renderer->shaderDepth, "./shaders/depth.vert", "./shaders/depth.frag", NULL, swapFrameBlocks, NULL);
+    watchShaderProgram(&renderer->shaderGeometry, "./shaders/default.vert", "./shaders/gbuffer.frag", materialDefines,
+                       swapFrameBlocks, NULL);
+    watchShaderProgram(&renderer->shaderDeferred, "./shaders/deferred.vert", "./shaders/deferred.frag", NULL,
+                       swapFrameBlocks, NULL);
+}
+
+// after the material path changed
+void reloadMaterialShaders(Renderer* renderer) {
+    RenderShaderDelete(renderer->shaderDefault);
+    renderer->shaderDefault = RenderShaderCreateDefines("./shaders/default.vert", "./shaders/default.frag", materialDefines());
+    bindFrameBlocks(renderer->shaderDefault);
+
+    if (renderer->shaderGeometry) {
+        RenderShaderDelete(renderer->shaderGeometry);
+        renderer->shaderGeometry = RenderShaderCreateDefines("./shaders/default.vert", "./shaders/gbuffer.frag", materialDefines());
+        bindFrameBlocks(renderer->shaderGeometry);
+    }
+}
+
+void setDepthPrepassMode(Renderer* renderer, DepthPrepassMode mode) {
+    renderer->prepassMode = mode;
+    renderer->prepassActive = mode == DEPTH_PREPASS_ON;
+}
+
+const char* rendererName(RendererType type) {
+    switch (type) {
+        case RENDERER_FORWARD:
+            return "forward";
+        case RENDERER_DEFERRED:
+            return "deferred";
+    }
+    return "unknown";
+}
+
+// writes the camera and flashlight blocks into this frame's ring segment and binds them for every shader
+static void uploadFrameBlocks(Renderer* renderer, FrameView* view) {
+    RingBuffer* ring = &renderer->ring;
+    beginRingBufferFrame(ring);
+
+    RingAllocation cameraAllocation = allocRingBuffer(ring, sizeof(CameraBlock), ring->uniformAlignment);
+    RingAllocation lightsAllocation = allocRingBuffer(ring, sizeof(LightsBlock), ring->uniformAlignment);
+    if (!cameraAllocation.data || !lightsAllocation.data) {
+        printf("Error: Ring buffer segment of %zu bytes is full\n", ring->segmentSize);
+        return;
+    }
+
+    CameraBlock* camera = cameraAllocation.data;
+    mat4x4 viewProjection;
+    mat4x4_dup(camera->projection, view->projection);
+    mat4x4_dup(camera->view, view->view);
+    mat4x4_mul(viewProjection, view->projection, view->view);
+    mat4x4_invert(camera->inverseViewProjection, viewProjection);
+    camera->viewPos[0] = view->position[0];
+    camera->viewPos[1] = view->position[1];
+    camera->viewPos[2] = view->position[2];
+    camera->viewPos[3] = 1.0f;
+
+    SpotLightBlock* spotLight = &((LightsBlock*)lightsAllocation.data)->spotLight;
+    *spotLight = (SpotLightBlock){
+        .position = {view->position[0], view->position[1], view->position[2]},
+        .direction = {view->front[0], view->front[1], view->front[2]},
+        .cutOff = cos(12.5f * (M_PI / 180)),
+        .outerCutOff = cos(17.5f * (M_PI / 180)),
+        .ambient = {0.0f, 0.0f, 0.0f},
+        .diffuse = {1.0f, 1.0f, 1.0f},
+        .specular = {1.0f, 1.0f, 1.0f},
+        .constant = 1.0f,
+        .linear = 0.09f,
+        .quadratic = 0.032f,
+    };
+
+    flushRingBuffer(ring);
+    bindRingBufferRange(ring, GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, cameraAllocation);
+    bindRingBufferRange(ring, GL_UNIFORM_BUFFER, LIGHTS_UBO_BINDING, lightsAllocation);
+}
+
+// projection, view and camera position come from the Camera block
+static void setCameraUniforms(unsigned int shader, FrameView* view) {
+    glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (const GLfloat*)view->model);
+}
+
+// directional light and material constants shared by both lighting shaders, the flashlight is in the Lights block
+static void setLightUniforms(unsigned int shader) {
+    glUniform3f(glGetUniformLocation(shader, "dirLight.direction"), -0.2f, -1.0f, -0.3f);
+    glUniform1f(glGetUniformLocation(shader, "material.shininess"), 64.0f);
+}
+
+static void renderForward(Renderer* renderer, FrameView* view) {
+    unsigned int shader = renderer->shaderDefault;
+    unsigned int slot = renderer->timer.frame % GPU_TIMER_LATENCY;
+
+    // in auto mode the pre-pass also runs now and then just to measure overdraw
+    bool prepass = renderer->prepassActive ||
+        (renderer->prepassMode == DEPTH_PREPASS_AUTO && renderer->timer.frame % DEPTH_PREPASS_PROBE_INTERVAL == 0);
+
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (prepass) {
+        beginGpuTimer(&renderer->timer, RENDER_PASS_DEPTH);
+        glBeginQuery(GL_SAMPLES_PASSED, renderer->sampleQueries[slot][0]);
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glUseProgram(renderer->shaderDepth);
+        setCameraUniforms(renderer->shaderDepth, view);
+        submitDrawListDepth(&renderer->drawList);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glEndQuery(GL_SAMPLES_PASSED);
+        endGpuTimer(&renderer->timer);
+
+        // only the front most fragment of every pixel survives
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    beginGpuTimer(&renderer->timer, RENDER_PASS_COLOR);
+    if (prepass) {
+        glBeginQuery(GL_SAMPLES_PASSED, renderer->sampleQueries[slot][1]);
+    }
+
+    glUseProgram(shader);
+    setCameraUniforms(shader, view);
+    setLightUniforms(shader);
+    bindClusterGrid(&renderer->clusters, shader, renderer->width, renderer->height);
+
+    assert(glGetError() == GL_NO_ERROR);
+    submitDrawList(&renderer->drawList, shader);
+    assert(glGetError() == GL_NO_ERROR);
+
+    if (prepass) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        renderer->samplesPending[slot] = true;
+
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    endGpuTimer(&renderer->timer);
+}
+
+// the pre-pass depth tests like a plain forward pass would, so its samples are what would get shaded
+// without it, while the GL_EQUAL color pass shades each covered pixel exactly once
+static void collectOverdraw(Renderer* renderer) {
+    unsigned int slot = renderer->timer.frame % GPU_TIMER_LATENCY;
+    if (!renderer->samplesPending[slot]) {
+        return;
+    }
+    renderer->samplesPending[slot] = false;
+
+    GLuint available = 0;
+    glGetQueryObjectuiv(renderer->sampleQueries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint shaded = 0;
+    GLuint covered = 0;
+    glGetQueryObjectuiv(renderer->sampleQueries[slot][0], GL_QUERY_RESULT, &shaded);
+    glGetQueryObjectuiv(renderer->sampleQueries[slot][1], GL_QUERY_RESULT, &covered);
+    if (covered == 0) {
+        return;
+    }
+
+    renderer->overdraw = (float)shaded / (float)covered;
+
+    if (renderer->prepassMode == DEPTH_PREPASS_AUTO) {
+        // a little hysteresis so it does not flip every probe around the threshold
+        float threshold = DEPTH_PREPASS_OVERDRAW_THRESHOLD;
+        if (renderer->prepassActive) {
+            threshold *= 0.9f;
+        }
+        renderer->prepassActive = renderer->overdraw > threshold;
+    }
+}
+
+static void renderDeferred(Renderer* renderer, FrameView* view) {
+    // geometry pass, no lighting
+    beginGpuTimer(&renderer->timer, RENDER_PASS_GEOMETRY);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->gbuffer.FBO);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(renderer->shaderGeometry);
+    setCameraUniforms(renderer->shaderGeometry, view);
+    submitDrawList(&renderer->drawList, renderer->shaderGeometry);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    endGpuTimer(&renderer->timer);
+
+    // lighting pass, every light is evaluated once per visible pixel
+    beginGpuTimer(&renderer->timer, RENDER_PASS_LIGHTING);
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    unsigned int shader = renderer->shaderDeferred;
+    glUseProgram(shader);
+    setLightUniforms(shader);
+    bindGBufferTextures(&renderer->gbuffer, shader);
+    bindClusterGrid(&renderer->clusters, shader, renderer->width, renderer->height);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(renderer->screenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    // light cubes are still drawn forward and need the scene depth
+    blitGBufferDepth(&renderer->gbuffer);
+    endGpuTimer(&renderer->timer);
+}
+
+static void renderLightCubes(Renderer* renderer, const PointLight* lights, unsigned int numLights) {
+    if (numLights == 0) {
+        return;
+    }
+
+    TransformSet* transforms = &renderer->lightTransforms;
+    resizeTransformSet(transforms, numLights);
+    if (transforms->count != numLights) {
+        return;
+    }
+    for (unsigned int i = 0; i < numLights; i++) {
+        for (int k = 0; k < 3; k++) {
+            transforms->position[k][i] = lights[i].position[k];
+            transforms->scale[k][i] = 0.2f;
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->lightInstanceVBO);
+    GLsizeiptr size = (GLsizeiptr)(numLights * sizeof(mat4x4));
+    if (numLights > renderer->lightInstanceCapacity) {
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        trackGpuObject(MEMORY_OBJECT_BUFFER, renderer->lightInstanceVBO, MEMORY_RENDER_GPU, (size_t)size);
+        renderer->lightInstanceCapacity = numLights;
+    }
+
+    // invalidating lets the driver hand out fresh storage instead of waiting on last frame's draw
+    float* instances = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!instances) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+    composeTransforms(transforms, NULL, false, instances);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(renderer->shaderLight);
+    glBindVertexArray(renderer->lightVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)numLights);
+    glBindVertexArray(0);
+}
+
+void renderFrame(Renderer* renderer, Model* model, const PointLight* lights, unsigned int numLights, FrameView* view) {
+    updateClusterGrid(&renderer->clusters, lights, numLights, view->view, view->projection);
+
+    mat4x4 viewProjection;
+    mat4x4 modelViewProjection;
+    mat4x4_mul(viewProjection, view->projection, view->view);
+    mat4x4_mul(modelViewProjection, viewProjection, view->model);
+
+    if (renderer->occlusionEnabled) {
+        cullModel(&renderer->occlusion, model, modelViewProjection);
+    }
+
+    if (textureStreamingActive()) {
+        requestModelTextures(model, view->model, modelViewProjection, view->position, view->projection,
+                             renderer->height);
+        updateTextureStreaming();
+    }
+
+    // culling, material lookups and sorting happen on the job system, the passes below only replay
+    mat4x4 modelView;
+    mat4x4_mul(modelView, view->view, view->model);
+    recordDrawList(&renderer->drawList, model, modelView, view->projection);
+    if (lazyMaterialsActive()) {
+        loadRequestedMaterials(model, MODEL_MATERIALS_PER_FRAME);
+    }
+    markTelemetryPhase(TELEMETRY_CULL);
+
+    uploadFrameBlocks(renderer, view);
+    markTelemetryPhase(TELEMETRY_UNIFORMS);
+
+    if (renderer->type == RENDERER_DEFERRED) {
+        renderDeferred(renderer, view);
+    } else {
+        renderForward(renderer, view);
+    }
+    markTelemetryPhase(TELEMETRY_MODEL);
+
+    beginGpuTimer(&renderer->timer, RENDER_PASS_LIGHT_CUBES);
+    renderLightCubes(renderer, lights, numLights);
+    endGpuTimer(&renderer->timer);
+    markTelemetryPhase(TELEMETRY_LIGHTS);
+
+    endRingBufferFrame(&renderer->ring);
+    advanceGpuTimer(&renderer->timer);
+    collectOverdraw(renderer);
+
+    if (renderer->timer.frame % RENDERER_REPORT_INTERVAL == 0) {
+        reportGpuTimer(&renderer->timer);
+        if (renderer->type == RENDERER_FORWARD) {
+            printf("Overdraw %.2f, depth pre-pass %s\n", renderer->overdraw, renderer->prepassActive ? "on" : "off");
+        }
+        if (renderer->occlusionEnabled) {
+            printf("Occlusion culled %u of %u meshes\n", renderer->occlusion.numCulled, renderer->occlusion.numTested);
+        }
+        printf("Draw list: %u draws, %u frustum culled, recorded in %.3f ms\n", renderer->drawList.numCommands,
+               atomic_load(&renderer->drawList.numFrustumCulled), renderer->drawList.recordMs);
+        if (lazyMaterialsActive()) {
+            printf("Lazy materials: %u of %u meshes loaded\n", model->numLoadedMaterials, model->numMeshes);
+        }
+        reportClusterGrid(&renderer->clusters);
+        reportTextureStreaming();
+        reportRingBuffer(&renderer->ring);
+    }
+}
+
+// draw submission rate of the forward color pass with texture binds and with bindless materials
+void benchmarkDrawCalls(Renderer* renderer, Model* model, FrameView* view, int frames) {
+    bool initialBindless = bindlessMaterialsActive();
+
+    for (int bindless = 0; bindless < 2; bindless++) {
+        setBindlessMaterials(bindless);
+        if (bindlessMaterialsActive() != (bool)bindless) {
+            printf("Draw benchmark: bindless materials unavailable\n");
+            continue;
+        }
+        reloadMaterialShaders(renderer);
+
+        uploadFrameBlocks(renderer, view);
+
+        unsigned int shader = renderer->shaderDefault;
+        glUseProgram(shader);
+        setCameraUniforms(shader, view);
+        setLightUniforms(shader);
+        bindClusterGrid(&renderer->clusters, shader, renderer->width, renderer->height);
+
+        mat4x4 modelView;
+        mat4x4_mul(modelView, view->view, view->model);
+        recordDrawList(&renderer->drawList, model, modelView, view->projection);
+        unsigned int numVisible = renderer->drawList.numCommands;
+
+        submitDrawList(&renderer->drawList, shader);
+        glFinish();
+
+        double submitSeconds = 0.0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < frames; frame++) {
+            Uint64 submitStart = SDL_GetPerformanceCounter();
+            for (int i = 0; i < DRAW_BENCH_REPEAT; i++) {
+                submitDrawList(&renderer->drawList, shader);
+            }
+            submitSeconds += (double)(SDL_GetPerformanceCounter() - submitStart) / SDL_GetPerformanceFrequency();
+            glFinish();
+        }
+        double totalSeconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+        double draws = (double)numVisible * DRAW_BENCH_REPEAT * frames;
+        endRingBufferFrame(&renderer->ring);
+
+        printf("Draw benchmark %-8s %.0f draws: %.2f M draws/s submitted, %.2f M draws/s completed\n",
+               bindless ? "bindless" : "bind", draws, draws / submitSeconds / 1e6, draws / totalSeconds / 1e6);
+    }
+
+    setBindlessMaterials(initialBindless);
+    reloadMaterialShaders(renderer);
+}
+
+void freeRenderer(Renderer* renderer) {
+    freeClusterGrid(&renderer->clusters);
+    freeGpuTimer(&renderer->timer);
+    freeOcclusionBuffer(&renderer->occlusion);
+    freeRingBuffer(&renderer->ring);
+    freeDrawList(&renderer->drawList);
+
+    for (unsigned int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glDeleteQueries(2, renderer->sampleQueries[i]);
+    }
+    RenderShaderDelete(renderer->shaderDepth);
+
+    if (renderer->gbuffer.FBO != 0) {
+        freeGBuffer(&renderer->gbuffer);
+        RenderShaderDelete(renderer->shaderGeometry);
+        RenderShaderDelete(renderer->shaderDeferred);
+    }
+
+    glDeleteVertexArrays(1, &renderer->lightVAO);
+    glDeleteVertexArrays(1, &renderer->screenVAO);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, renderer->lightVBO);
+    glDeleteBuffers(1, &renderer->lightVBO);
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, renderer->lightInstanceVBO);
+    glDeleteBuffers(1, &renderer->lightInstanceVBO);
+    freeTransformSet(&renderer->lightTransforms);
+    RenderShaderDelete(renderer->shaderDefault);
+    RenderShaderDelete(renderer->shaderLight);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <linmath.h>
+
+#include "model.h"
+#include "light.h"
+#include "cluster.h"
+#include "deferred.h"
+#include "gputimer.h"
+#include "occlusion.h"
+#include "streaming.h"
+#include "texpack.h"
+#include "material.h"
+#include "ringbuffer.h"
+#include "drawlist.h"
+#include "transforms.h"
+
+// forward renderer turns on the depth pre-pass above this many shaded fragments per covered pixel
+#define DEPTH_PREPASS_OVERDRAW_THRESHOLD 1.5f
+// frames between overdraw measurements while the pre-pass is off
+#define DEPTH_PREPASS_PROBE_INTERVAL 120
+#define RENDERER_REPORT_INTERVAL 300
+// model draws per frame in benchmarkDrawCalls
+#define DRAW_BENCH_REPEAT 64
+// uniform block bindings for per-frame data, material.h uses binding 1
+#define CAMERA_UBO_BINDING 2
+#define LIGHTS_UBO_BINDING 3
+// per-frame bytes of the dynamic data ring buffer
+#define RENDERER_RING_SEGMENT_SIZE (64 * 1024)
+
+typedef enum rendererType {
+    RENDERER_FORWARD,
+    RENDERER_DEFERRED,
+} RendererType;
+
+typedef enum depthPrepassMode {
+    DEPTH_PREPASS_OFF,
+    DEPTH_PREPASS_ON,
+    DEPTH_PREPASS_AUTO,
+} DepthPrepassMode;
+
+enum renderPass {
+    RENDER_PASS_DEPTH,
+    RENDER_PASS_COLOR,
+    RENDER_PASS_GEOMETRY,
+    RENDER_PASS_LIGHTING,
+    RENDER_PASS_LIGHT_CUBES,
+    RENDER_PASS_COUNT,
+};
+
+typedef struct frameView {
+    mat4x4 projection;
+    mat4x4 view;
+    mat4x4 model;
+    vec3 position;
+    vec3 front;
+} FrameView;
+
+// std140 mirrors of the Camera and Lights uniform blocks in the shaders
+typedef struct cameraBlock {
+    mat4x4 projection;
+    mat4x4 view;
+    mat4x4 inverseViewProjection;
+    vec4 viewPos;
+} CameraBlock;
+
+typedef struct spotLightBlock {
+    vec3 position;
+    float pad0;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+    float pad1[3];
+    vec3 ambient;
+    float pad2;
+    vec3 diffuse;
+    float pad3;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+    float pad4[2];
+} SpotLightBlock;
+
+typedef struct lightsBlock {
+    SpotLightBlock spotLight;
+} LightsBlock;
+
+typedef struct renderer {
+    RendererType type;
+    int width;
+    int height;
+
+    unsigned int shaderDefault;
+    unsigned int shaderLight;
+    // only created once the deferred path is first used
+    unsigned int shaderGeometry;
+    unsigned int shaderDeferred;
+    GBuffer gbuffer;
+
+    unsigned int lightVAO, lightVBO;
+    // one matrix per light cube, composed straight into the mapped buffer every frame
+    TransformSet lightTransforms;
+    unsigned int lightInstanceVBO;
+    unsigned int lightInstanceCapacity;
+    unsigned int screenVAO;
+
+    ClusterGrid clusters;
+
+    DepthPrepassMode prepassMode;
+    bool prepassActive;
+    unsigned int shaderDepth;
+    // samples passed by the depth pre-pass and the color pass, per frame in flight
+    unsigned int sampleQueries[GPU_TIMER_LATENCY][2];
+    bool samplesPending[GPU_TIMER_LATENCY];
+    float overdraw;
+
+    GpuTimer timer;
+
+    bool occlusionEnabled;
+    OcclusionBuffer occlusion;
+
+    // camera and light blocks, written once per frame instead of per shader with glUniform
+    RingBuffer ring;
+
+    // recorded once per frame, replayed by every pass
+    DrawList drawList;
+} Renderer;
+
+Renderer initRenderer(RendererType type, int width, int height, float near, float far);
+void setRendererType(Renderer* renderer, RendererType type);
+// uniform block bindings of every created program, after a shader batch finished
+void bindRendererShaders(Renderer* renderer);
+void setDepthPrepassMode(Renderer* renderer, DepthPrepassMode mode);
+void reloadMaterialShaders(Renderer* renderer);
+// hot reload of every program the renderer creates, see shaderreload.h
+void watchRendererShaders(Renderer* renderer);
+void renderFrame(Renderer* renderer, Model* model, const PointLight* lights, unsigned int numLights, FrameView* view);
+void benchmarkDrawCalls(Renderer* renderer, Model* model, FrameView* view, int frames);
+void freeRenderer(Renderer* renderer);
+const char* rendererName(RendererType type);
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "ringbuffer.h"
+#include "memtrack.h"
+#include "glext.h"
+
+RingBuffer initRingBuffer(size_t segmentSize) {
+    RingBuffer ring = {0};
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ring.uniformAlignment);
+    // segments start aligned for any binding
+    segmentSize = (segmentSize + ring.uniformAlignment - 1) / ring.uniformAlignment * ring.uniformAlignment;
+    ring.segmentSize = segmentSize;
+
+    size_t size = segmentSize * RING_BUFFER_FRAMES;
+    glGenBuffers(1, &ring.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+
+    if (glExt.bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExt.createBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+        ring.data = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        ring.persistent = ring.data != NULL;
+    }
+
+    if (!ring.persistent) {
+        if (glExt.bufferStorage) {
+            // storage is immutable now, start over with a fresh buffer
+            glDeleteBuffers(1, &ring.buffer);
+            glGenBuffers(1, &ring.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+        }
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        ring.data = malloc(size);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    trackGpuObject(MEMORY_OBJECT_BUFFER, ring.buffer, MEMORY_RENDER_GPU, size);
+
+    return ring;
+}
+
+void beginRingBufferFrame(RingBuffer* ring) {
+    GLsync fence = ring->fences[ring->segment];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            while (result == GL_TIMEOUT_EXPIRED) {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, RING_BUFFER_WAIT_TIMEOUT);
+            }
+            ring->stats.numStalls++;
+            ring->stats.stallMs += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        }
+
+        glDeleteSync(fence);
+        ring->fences[ring->segment] = NULL;
+    }
+
+    ring->head = ring->segment * ring->segmentSize;
+    ring->flushed = ring->head;
+}
+
+RingAllocation allocRingBuffer(RingBuffer* ring, size_t size, size_t alignment) {
+    RingAllocation allocation = {0};
+
+    size_t offset = (ring->head + alignment - 1) / alignment * alignment;
+    size_t end = (ring->segment + 1) * ring->segmentSize;
+    if (offset + size > end) {
+        ring->stats.numOverflows++;
+        return allocation;
+    }
+
+    allocation.data = ring->data + offset;
+    allocation.offset = offset;
+    allocation.size = size;
+    ring->head = offset + size;
+
+    ring->stats.numAllocations++;
+    size_t used = ring->head - ring->segment * ring->segmentSize;
+    ring->stats.peakBytes = used > ring->stats.peakBytes ? used : ring->stats.peakBytes;
+
+    return allocation;
+}
+
+void flushRingBuffer(RingBuffer* ring) {
+    if (ring->persistent || ring->flushed == ring->head) {
+        return;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, ring->flushed, ring->head - ring->flushed, ring->data + ring->flushed);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    ring->flushed = ring->head;
+}
+
+void bindRingBufferRange(const RingBuffer* ring, GLenum target, unsigned int index, RingAllocation allocation) {
+    glBindBufferRange(target, index, ring->buffer, allocation.offset, allocation.size);
+}
+
+void endRingBufferFrame(RingBuffer* ring) {
+    flushRingBuffer(ring);
+
+    ring->fences[ring->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring->segment = (ring->segment + 1) % RING_BUFFER_FRAMES;
+    ring->stats.numFrames++;
+}
+
+void reportRingBuffer(const RingBuffer* ring) {
+    const RingBufferStats* stats = &ring->stats;
+    printf("Ring buffer (%s): %u frames, %u allocations, peak %zu of %zu bytes, %u overflows, %u stalls (%.2f ms)\n",
+           ring->persistent ? "persistent" : "glBufferSubData", stats->numFrames, stats->numAllocations,
+           stats->peakBytes, ring->segmentSize, stats->numOverflows, stats->numStalls, stats->stallMs);
+}
+
+void freeRingBuffer(RingBuffer* ring) {
+    for (unsigned int i = 0; i < RING_BUFFER_FRAMES; i++) {
+        if (ring->fences[i]) {
+            glDeleteSync(ring->fences[i]);
+        }
+    }
+
+    if (ring->persistent) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    } else {
+        free(ring->data);
+    }
+
+    untrackGpuObject(MEMORY_OBJECT_BUFFER, ring->buffer);
+    glDeleteBuffers(1, &ring->buffer);
+}
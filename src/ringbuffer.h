@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <glad/glad.h>
+
+// frames the CPU may run ahead of the GPU, each owns one segment of the ring
+#define RING_BUFFER_FRAMES 3
+// nanoseconds between fence polls while stalled
+#define RING_BUFFER_WAIT_TIMEOUT 1000000
+
+typedef struct ringAllocation {
+    // write here, NULL when the frame's segment is full
+    void* data;
+    size_t offset;
+    size_t size;
+} RingAllocation;
+
+typedef struct ringBufferStats {
+    unsigned int numFrames;
+    unsigned int numAllocations;
+    unsigned int numOverflows;
+    // frames whose segment was still in use by the GPU
+    unsigned int numStalls;
+    double stallMs;
+    size_t peakBytes;
+} RingBufferStats;
+
+typedef struct ringBuffer {
+    unsigned int buffer;
+    size_t segmentSize;
+    // persistently mapped when buffer storage is available, otherwise a CPU copy uploaded with glBufferSubData
+    bool persistent;
+    unsigned char* data;
+
+    unsigned int segment;
+    size_t head;
+    size_t flushed;
+    GLsync fences[RING_BUFFER_FRAMES];
+
+    int uniformAlignment;
+    RingBufferStats stats;
+} RingBuffer;
+
+RingBuffer initRingBuffer(size_t segmentSize);
+// waits until the GPU is done with the segment this frame reuses
+void beginRingBufferFrame(RingBuffer* ring);
+RingAllocation allocRingBuffer(RingBuffer* ring, size_t size, size_t alignment);
+// makes everything allocated so far visible to the GPU, a no-op for coherent mappings
+void flushRingBuffer(RingBuffer* ring);
+void bindRingBufferRange(const RingBuffer* ring, GLenum target, unsigned int index, RingAllocation allocation);
+void endRingBufferFrame(RingBuffer* ring);
+void reportRingBuffer(const RingBuffer* ring);
+void freeRingBuffer(RingBuffer* ring);
@@ -1,70 +1,488 @@
 #include <glad/glad.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
 
 #include "shader.h"
-#include "io.h"
+#include "glext.h"
+#include "shadersource.h"
+#include "memtrack.h"
 
-unsigned int RenderShaderCreate(const char *path_vert, const char *path_frag) {
-    int success;
-    char log[512];
+typedef struct shaderVariant {
+    // hash of the paths and the define set, 0 marks an empty slot
+    uint64_t key;
+    // hash of both expanded stages, requests that expand to the same source share a program
+    uint64_t sourceHash;
+    unsigned int program;
+    unsigned int numUsers;
+} ShaderVariant;
 
-    File file_vertex = io_file_read(path_vert);
-    if (!file_vertex.is_valid) {
-        printf("Error reading shader: %s\n", path_vert);
-        return -1;
+// a program dropped from the cache while still in use, deleted with its last user
+typedef struct retiredProgram {
+    unsigned int program;
+    unsigned int numUsers;
+} RetiredProgram;
+
+typedef struct shaderCache {
+    // open addressing, only ever cleared as a whole
+    ShaderVariant variants[SHADER_CACHE_SIZE];
+    unsigned int numVariants;
+    RetiredProgram retired[SHADER_CACHE_SIZE];
+    unsigned int numRetired;
+
+    unsigned int numLookups;
+    unsigned int numHits;
+    unsigned int numShared;
+    unsigned int numCompiles;
+} ShaderCache;
+
+// programs submitted together, their compiles overlap whatever the caller does before finishShaderBatch
+typedef struct shaderBatchEntry {
+    ShaderBuild build;
+    const char *vertexPath;
+    const char *fragmentPath;
+    char *defines;
+    bool finished;
+} ShaderBatchEntry;
+
+typedef struct shaderBatch {
+    bool open;
+    ShaderBatchEntry entries[SHADER_BATCH_SIZE];
+    unsigned int numEntries;
+    // names of the programs that failed, already deleted
+    unsigned int failed[SHADER_BATCH_SIZE];
+    unsigned int numFailed;
+    Uint64 start;
+} ShaderBatch;
+
+static ShaderCache cache = {0};
+static ShaderBatch batch = {0};
+
+static void deleteProgram(unsigned int shader) {
+    untrackGpuObject(MEMORY_OBJECT_PROGRAM, shader);
+    glDeleteProgram(shader);
+}
+
+static uint64_t variantKey(const char *path_vert, const char *path_frag, const char *defines) {
+    // the terminators keep "a" + "bc" apart from "ab" + "c"
+    uint64_t key = hashShaderText(SHADER_HASH_SEED, path_vert, strlen(path_vert) + 1);
+    key = hashShaderText(key, path_frag, strlen(path_frag) + 1);
+    key = hashShaderText(key, defines, strlen(defines));
+    return key ? key : 1;
+}
+
+static ShaderVariant *findVariant(uint64_t key) {
+    for (unsigned int slot = key & (SHADER_CACHE_SIZE - 1);; slot = (slot + 1) & (SHADER_CACHE_SIZE - 1)) {
+        if (cache.variants[slot].key == key) {
+            return &cache.variants[slot];
+        }
+        if (cache.variants[slot].key == 0) {
+            return NULL;
+        }
     }
+}
 
-    File file_fragment = io_file_read(path_frag);
-    if (!file_vertex.is_valid) {
-        printf("Error reading shader: %s\n", path_frag);
-        return -1;
+static void placeVariant(ShaderVariant variant) {
+    unsigned int slot = variant.key & (SHADER_CACHE_SIZE - 1);
+    while (cache.variants[slot].key != 0) {
+        slot = (slot + 1) & (SHADER_CACHE_SIZE - 1);
     }
+    cache.variants[slot] = variant;
+    cache.numVariants++;
+}
+
+static bool insertVariant(uint64_t key, uint64_t sourceHash, unsigned int program) {
+    // a full cache still hands out programs, they are just compiled again next time
+    if ((cache.numVariants + 1) * 4 > SHADER_CACHE_SIZE * 3) {
+        return false;
+    }
+
+    placeVariant((ShaderVariant){key, sourceHash, program, 1});
+    return true;
+}
+
+// rare enough, a batched program that failed to build, to rebuild the table without it
+static void removeVariants(unsigned int program) {
+    ShaderVariant old[SHADER_CACHE_SIZE];
+    memcpy(old, cache.variants, sizeof(old));
+    memset(cache.variants, 0, sizeof(cache.variants));
+    cache.numVariants = 0;
 
-    unsigned int vertex, fragment;
+    for (unsigned int i = 0; i < SHADER_CACHE_SIZE; i++) {
+        if (old[i].key != 0 && old[i].program != program) {
+            placeVariant(old[i]);
+        }
+    }
+}
+
+static ShaderVariant *variantOfProgram(unsigned int program, bool used) {
+    for (unsigned int i = 0; i < SHADER_CACHE_SIZE; i++) {
+        ShaderVariant *variant = &cache.variants[i];
+        if (variant->key != 0 && variant->program == program && (!used || variant->numUsers > 0)) {
+            return variant;
+        }
+    }
+    return NULL;
+}
+
+static ShaderVariant *variantOfSource(uint64_t sourceHash) {
+    for (unsigned int i = 0; i < SHADER_CACHE_SIZE; i++) {
+        if (cache.variants[i].key != 0 && cache.variants[i].sourceHash == sourceHash) {
+            return &cache.variants[i];
+        }
+    }
+    return NULL;
+}
+
+// "0 a.frag, 1 b.glsl", what the source string numbers in a compile log refer to
+static char *describeSource(const ShaderSource *source) {
+    char *description = malloc(source->numFiles * (SHADER_MAX_PATH + 16) + 1);
+    size_t length = 0;
+    description[0] = '\0';
+    for (unsigned int i = 0; i < source->numFiles; i++) {
+        length += sprintf(description + length, "%s%u %s", i > 0 ? ", " : "", i, source->files[i]);
+    }
+    return description;
+}
+
+static bool preprocessStages(const char *path_vert, const char *path_frag, const char *defines, ShaderSource stages[2]) {
+    stages[0] = preprocessShader(path_vert, defines);
+    if (!stages[0].valid) {
+        return false;
+    }
+
+    stages[1] = preprocessShader(path_frag, defines);
+    if (!stages[1].valid) {
+        freeShaderSource(&stages[0]);
+        return false;
+    }
+    return true;
+}
+
+static uint64_t hashStages(const ShaderSource stages[2]) {
+    return hashShaderText(hashShaderText(SHADER_HASH_SEED, stages[0].text, stages[0].length + 1), stages[1].text, stages[1].length);
+}
+
+static ShaderBuild compileStages(const ShaderSource stages[2]) {
+    ShaderBuild build = {0};
 
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, (const char *const *)&file_vertex, NULL);
-    glCompileShader(vertex);
+    build.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertex, 1, (const char *const *)&stages[0].text, NULL);
+    glCompileShader(build.vertex);
 
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, NULL, log);
-        printf("Error shader vertex compilation failed! Logs: %s\n", log);
+    // fragment shader
+    build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragment, 1, (const char *const *)&stages[1].text, NULL);
+    glCompileShader(build.fragment);
+
+    // linking a failed stage fails too, the stage logs are read in finishShaderBuild
+    build.program = glCreateProgram();
+    glAttachShader(build.program, build.vertex);
+    glAttachShader(build.program, build.fragment);
+    glLinkProgram(build.program);
+
+    build.sourceBytes = stages[0].length + stages[1].length;
+    build.sourceHash = hashStages(stages);
+    build.files[0] = describeSource(&stages[0]);
+    build.files[1] = describeSource(&stages[1]);
+    return build;
+}
+
+unsigned int RenderShaderCreate(const char *path_vert, const char *path_frag) {
+    return RenderShaderCreateDefines(path_vert, path_frag, "");
+}
+
+unsigned int RenderShaderCreateDefines(const char *path_vert, const char *path_frag, const char *defines) {
+    uint64_t key = variantKey(path_vert, path_frag, defines);
+    cache.numLookups++;
+
+    ShaderVariant *variant = findVariant(key);
+    if (variant) {
+        cache.numHits++;
+        variant->numUsers++;
+        return variant->program;
+    }
+
+    ShaderSource stages[2];
+    if (!preprocessStages(path_vert, path_frag, defines, stages)) {
         return -1;
     }
 
-    // fragment shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, (const char *const *)&file_fragment, NULL);
-    glCompileShader(fragment);
+    // defines that do not change the expanded source, e.g. in another order, reuse the program
+    uint64_t sourceHash = hashStages(stages);
+    ShaderVariant *same = variantOfSource(sourceHash);
+    unsigned int shader;
+    if (same) {
+        cache.numShared++;
+        shader = same->program;
+    } else if (batch.open && batch.numEntries < SHADER_BATCH_SIZE) {
+        // the name is valid right away, its status is only read in finishShaderBatch
+        cache.numCompiles++;
+        ShaderBatchEntry *entry = &batch.entries[batch.numEntries++];
+        *entry = (ShaderBatchEntry){
+            .build = compileStages(stages),
+            .vertexPath = path_vert,
+            .fragmentPath = path_frag,
+            .defines = malloc(strlen(defines) + 1),
+        };
+        strcpy(entry->defines, defines);
+        shader = entry->build.program;
+    } else {
+        cache.numCompiles++;
+        ShaderBuild build = compileStages(stages);
+        shader = finishShaderBuild(&build);
+    }
+    freeShaderSource(&stages[0]);
+    freeShaderSource(&stages[1]);
 
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, NULL, log);
-        printf("Error shader fragment comilation failed! Log: %s\n", log);
+    // a shared program has to stay counted even when the new key does not fit
+    if (shader != (unsigned int)-1 && !insertVariant(key, sourceHash, shader) && same) {
+        same->numUsers++;
+    }
+    return shader;
+}
+
+ShaderBuild beginShaderBuild(const char *path_vert, const char *path_frag, const char *defines) {
+    ShaderSource stages[2];
+    if (!preprocessStages(path_vert, path_frag, defines, stages)) {
+        return (ShaderBuild){0};
+    }
+
+    ShaderBuild build = compileStages(stages);
+    freeShaderSource(&stages[0]);
+    freeShaderSource(&stages[1]);
+    return build;
+}
+
+bool shaderBuildReady(const ShaderBuild *build) {
+    if (!glExt.parallelShaderCompile || build->program == 0) {
+        return true;
+    }
+
+    int done;
+    glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+unsigned int finishShaderBuild(ShaderBuild *build) {
+    int success;
+    char log[512];
+    unsigned int shader = build->program;
+    if (shader == 0) {
         return -1;
     }
 
-    // shader program
-    unsigned int shader = glCreateProgram();
-    glAttachShader(shader, vertex);
-    glAttachShader(shader, fragment);
-    glLinkProgram(shader);
+    glGetShaderiv(build->vertex, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(build->vertex, 512, NULL, log);
+        printf("Error shader vertex compilation failed! Sources: %s. Logs: %s\n", build->files[0], log);
+    }
+
+    if (success) {
+        glGetShaderiv(build->fragment, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(build->fragment, 512, NULL, log);
+            printf("Error shader fragment comilation failed! Sources: %s. Log: %s\n", build->files[1], log);
+        }
+    }
+
+    if (success) {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shader, 512, NULL, log);
+            printf("Error shader program linking failed. Log: %s\n", log);
+        }
+    }
 
-    glGetProgramiv(shader, GL_LINK_STATUS, &success);
+    // once shaders are linked to program there no longer needed
+    glDeleteShader(build->vertex);
+    glDeleteShader(build->fragment);
+    free(build->files[0]);
+    free(build->files[1]);
+
+    size_t sourceBytes = build->sourceBytes;
+    *build = (ShaderBuild){0};
     if (!success) {
-        glGetProgramInfoLog(shader, 512, NULL, log);
-        printf("Error shader program linking failed. Log: %s\n", log);
+        glDeleteProgram(shader);
         return -1;
     }
 
-    // once shaders are linked to program there no longer needed
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    trackGpuObject(MEMORY_OBJECT_PROGRAM, shader, MEMORY_SHADER, sourceBytes);
+    return shader;
+}
 
-    free(file_vertex.data);
-    free(file_fragment.data);
+void RenderShaderDelete(unsigned int shader) {
+    // failed builds have nothing to delete
+    if (shader == (unsigned int)-1) {
+        return;
+    }
+
+    // cached variants stay compiled for the next request
+    ShaderVariant *variant = variantOfProgram(shader, true);
+    if (!variant) {
+        variant = variantOfProgram(shader, false);
+    }
+    if (variant) {
+        variant->numUsers -= variant->numUsers > 0;
+        return;
+    }
+
+    for (unsigned int i = 0; i < cache.numRetired; i++) {
+        RetiredProgram *retired = &cache.retired[i];
+        if (retired->program == shader) {
+            if (--retired->numUsers == 0) {
+                deleteProgram(shader);
+                *retired = cache.retired[--cache.numRetired];
+            }
+            return;
+        }
+    }
+
+    // built outside the cache, e.g. by the hot reload
+    deleteProgram(shader);
+}
+
+void invalidateShaderCache(void) {
+    // programs shared by several variants are counted once, with all their users
+    for (unsigned int i = 0; i < SHADER_CACHE_SIZE; i++) {
+        ShaderVariant *variant = &cache.variants[i];
+        if (variant->key == 0) {
+            continue;
+        }
+
+        unsigned int r = 0;
+        while (r < cache.numRetired && cache.retired[r].program != variant->program) {
+            r++;
+        }
+        if (r == cache.numRetired) {
+            cache.retired[cache.numRetired++] = (RetiredProgram){variant->program, 0};
+        }
+        cache.retired[r].numUsers += variant->numUsers;
+    }
 
+    for (unsigned int r = 0; r < cache.numRetired;) {
+        if (cache.retired[r].numUsers == 0) {
+            deleteProgram(cache.retired[r].program);
+            cache.retired[r] = cache.retired[--cache.numRetired];
+        } else {
+            r++;
+        }
+    }
+
+    memset(cache.variants, 0, sizeof(cache.variants));
+    cache.numVariants = 0;
+}
+
+void beginShaderBatch(void) {
+    batch.open = true;
+    batch.numFailed = 0;
+    batch.start = SDL_GetPerformanceCounter();
+}
+
+bool shaderBatchOpen(void) {
+    return batch.open;
+}
+
+bool finishShaderBatch(void) {
+    if (!batch.open) {
+        return true;
+    }
+
+    Uint64 finishStart = SDL_GetPerformanceCounter();
+    bool passed = true;
+    unsigned int numReady = 0;
+    for (unsigned int i = 0; i < batch.numEntries; i++) {
+        ShaderBatchEntry *entry = &batch.entries[i];
+        numReady += shaderBuildReady(&entry->build);
+
+        unsigned int shader = entry->build.program;
+        if (finishShaderBuild(&entry->build) == (unsigned int)-1) {
+            printf("Error: %s + %s failed to build\n", entry->vertexPath, entry->fragmentPath);
+            removeVariants(shader);
+            batch.failed[batch.numFailed++] = shader;
+            passed = false;
+        }
+        entry->finished = true;
+    }
+
+    Uint64 end = SDL_GetPerformanceCounter();
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    printf("Shader batch: %u programs, %u ready before finishing, %.1f ms until finished, %.1f ms of it blocked in finish, "
+           "parallel compile %s\n",
+           batch.numEntries, glExt.parallelShaderCompile ? numReady : 0, (double)(end - batch.start) * 1000.0 / frequency,
+           (double)(end - finishStart) * 1000.0 / frequency, glExt.parallelShaderCompile ? "on" : "unavailable");
+    batch.open = false;
+    return passed;
+}
+
+unsigned int batchedShader(unsigned int shader) {
+    for (unsigned int i = 0; i < batch.numFailed; i++) {
+        if (batch.failed[i] == shader) {
+            return -1;
+        }
+    }
     return shader;
 }
+
+// the last batch again, one program after the other and then all at once; the define keeps driver caches out
+void benchmarkShaderCompile(int rounds) {
+    ShaderBatchEntry *entries = batch.entries;
+    unsigned int count = batch.numEntries;
+    double ms[2] = {0.0, 0.0};
+
+    for (int round = 0; round < rounds; round++) {
+        for (int parallel = 0; parallel < 2; parallel++) {
+            if (glExt.parallelShaderCompile) {
+                // 0 turns the driver threads off, all ones asks for the implementation's maximum
+                glExt.maxShaderCompilerThreads(parallel ? 0xffffffffu : 0u);
+            }
+
+            ShaderBuild builds[SHADER_BATCH_SIZE];
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (unsigned int i = 0; i < count; i++) {
+                char defines[SHADER_BENCH_DEFINES_SIZE];
+                snprintf(defines, sizeof(defines), "#define SHADER_BENCH_RUN %d\n%s", round * 2 + parallel, entries[i].defines);
+                builds[i] = beginShaderBuild(entries[i].vertexPath, entries[i].fragmentPath, defines);
+                if (!parallel) {
+                    RenderShaderDelete(finishShaderBuild(&builds[i]));
+                }
+            }
+
+            if (parallel) {
+                for (unsigned int i = 0; i < count; i++) {
+                    while (!shaderBuildReady(&builds[i])) {
+                        SDL_Delay(0);
+                    }
+                    RenderShaderDelete(finishShaderBuild(&builds[i]));
+                }
+            }
+            ms[parallel] += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        }
+    }
+
+    printf("Shader compile benchmark, %u programs: serial %.1f ms, parallel %.1f ms, %.2fx%s\n", count, ms[0] / rounds,
+           ms[1] / rounds, ms[0] / ms[1], glExt.parallelShaderCompile ? "" : " (no parallel compile extension)");
+}
+
+void reportShaderCache(void) {
+    printf("Shader cache: %u variants, %u lookups, %u hits, %u compiled, %u shared by source hash, %u retired in use\n",
+           cache.numVariants, cache.numLookups, cache.numHits, cache.numCompiles, cache.numShared, cache.numRetired);
+}
+
+void freeShaderCache(void) {
+    for (unsigned int i = 0; i < batch.numEntries; i++) {
+        if (!batch.entries[i].finished) {
+            finishShaderBuild(&batch.entries[i].build);
+        }
+        free(batch.entries[i].defines);
+    }
+    batch = (ShaderBatch){0};
+
+    invalidateShaderCache();
+    for (unsigned int r = 0; r < cache.numRetired; r++) {
+        deleteProgram(cache.retired[r].program);
+    }
+    cache = (ShaderCache){0};
+}
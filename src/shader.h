@@ -1,6 +1,14 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// variant slots of the program cache, a power of two
+#define SHADER_CACHE_SIZE 64
+// programs one batch can hold, more are built right away
+#define SHADER_BATCH_SIZE 16
+#define SHADER_BENCH_DEFINES_SIZE 512
 
 typedef struct shader {
 
@@ -9,4 +17,42 @@ typedef struct shader {
 
 } Shader;
 
+// a program whose stages are compiling and linking while the caller keeps going
+typedef struct shaderBuild {
+    unsigned int program;
+    unsigned int vertex;
+    unsigned int fragment;
+    size_t sourceBytes;
+    uint64_t sourceHash;
+    // per stage, the files behind the source string numbers of the compile log
+    char *files[2];
+} ShaderBuild;
+
+// programs come from a cache keyed by the paths and the define set, every variant is compiled once
 unsigned int RenderShaderCreate(const char *path_vert, const char *path_frag);
+// defines is inserted after the #version line, one "#define NAME value" per line; #include is resolved, see shadersource.h
+unsigned int RenderShaderCreateDefines(const char *path_vert, const char *path_frag, const char *defines);
+// a cached program stays compiled for the next request until the cache is invalidated
+void RenderShaderDelete(unsigned int shader);
+// after a shader file changed, programs still in use are deleted with their last user
+void invalidateShaderCache(void);
+// between these, programs that miss the cache return their name at once and compile in the background;
+// nothing may query or use them before finishShaderBatch, which blocks on whatever is still compiling
+void beginShaderBatch(void);
+bool shaderBatchOpen(void);
+// false if any program failed, its name is deleted
+bool finishShaderBatch(void);
+// a name handed out during the last batch, or -1 if finishShaderBatch deleted it; callers swap their names
+// through this before creating other programs, which may reuse the deleted names
+unsigned int batchedShader(unsigned int shader);
+// compiles the last batch serially and in parallel, uncached
+void benchmarkShaderCompile(int rounds);
+void reportShaderCache(void);
+void freeShaderCache(void);
+
+// issues the compiles and the link without asking for their status, program 0 when a file is missing
+ShaderBuild beginShaderBuild(const char *path_vert, const char *path_frag, const char *defines);
+// polls GL_KHR_parallel_shader_compile; without it always true and finishing blocks on the driver
+bool shaderBuildReady(const ShaderBuild *build);
+// logs compile and link errors, -1 on failure like RenderShaderCreate
+unsigned int finishShaderBuild(ShaderBuild *build);
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "shaderreload.h"
+
+typedef struct shaderReload {
+    bool active;
+    int fd;
+    WatchedProgram programs[SHADER_RELOAD_MAX_PROGRAMS];
+    unsigned int numPrograms;
+} ShaderReload;
+
+static ShaderReload reload = {0};
+
+bool initShaderReload(const char* directory) {
+#ifdef __linux__
+    reload.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reload.fd < 0) {
+        printf("Shader reload: inotify unavailable\n");
+        return false;
+    }
+
+    // editors either rewrite the file or write a new one and rename it over the old
+    if (inotify_add_watch(reload.fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        printf("Shader reload: could not watch %s\n", directory);
+        close(reload.fd);
+        return false;
+    }
+
+    reload.active = true;
+    printf("Shader reload: watching %s\n", directory);
+    return true;
+#else
+    printf("Shader reload: needs inotify, %s is not watched\n", directory);
+    return false;
+#endif
+}
+
+void watchShaderProgram(unsigned int* program, const char* vertexPath, const char* fragmentPath, ShaderDefinesFunction defines,
+                        ShaderSwapFunction onSwap, void* data) {
+    if (reload.numPrograms == SHADER_RELOAD_MAX_PROGRAMS) {
+        printf("Shader reload: more than %d programs, %s is not watched\n", SHADER_RELOAD_MAX_PROGRAMS, fragmentPath);
+        return;
+    }
+
+    reload.programs[reload.numPrograms++] = (WatchedProgram){
+        .program = program,
+        .vertexPath = vertexPath,
+        .fragmentPath = fragmentPath,
+        .defines = defines,
+        .onSwap = onSwap,
+        .data = data,
+    };
+}
+
+static bool sameFile(const char* path, const char* name) {
+    const char* base = strrchr(path, '/');
+    return strcmp(base ? base + 1 : path, name) == 0;
+}
+
+// several saves of the same file before the next frame become one rebuild, false for files no program reads
+static bool markChanged(const char* name) {
+    // any program may pull in an include, they are few enough to rebuild them all
+    size_t length = strlen(name);
+    bool include = length > 5 && strcmp(name + length - 5, ".glsl") == 0;
+    bool watchedFile = include;
+
+    for (unsigned int i = 0; i < reload.numPrograms; i++) {
+        WatchedProgram* watched = &reload.programs[i];
+        if (include || sameFile(watched->vertexPath, name) || sameFile(watched->fragmentPath, name)) {
+            watched->dirty = true;
+            watchedFile = true;
+        }
+    }
+    return watchedFile;
+}
+
+static void readEvents(void) {
+#ifdef __linux__
+    _Alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        // EAGAIN once drained, the descriptor never blocks
+        ssize_t length = read(reload.fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        const struct inotify_event* event;
+        for (char* p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event*)p;
+            // editor swap and backup files land here too and leave the cache alone
+            if (event->len > 0 && markChanged(event->name)) {
+                // cached variants of the old source must not be handed out again
+                invalidateShaderCache();
+            }
+        }
+    }
+#endif
+}
+
+static const char* currentDefines(const WatchedProgram* watched) {
+    return watched->defines ? watched->defines() : "";
+}
+
+static void beginReload(WatchedProgram* watched) {
+    watched->dirty = false;
+
+    const char* defines = currentDefines(watched);
+    free(watched->buildDefines);
+    watched->buildDefines = malloc(strlen(defines) + 1);
+    strcpy(watched->buildDefines, defines);
+
+    watched->buildStart = SDL_GetPerformanceCounter();
+    watched->build = beginShaderBuild(watched->vertexPath, watched->fragmentPath, defines);
+    watched->building = watched->build.program != 0;
+    if (!watched->building) {
+        printf("Shader reload: %s + %s failed, keeping the old program\n", watched->vertexPath, watched->fragmentPath);
+    }
+}
+
+static void finishReload(WatchedProgram* watched) {
+    watched->building = false;
+    unsigned int program = finishShaderBuild(&watched->build);
+    if (program == (unsigned int)-1) {
+        printf("Shader reload: %s + %s failed, keeping the old program\n", watched->vertexPath, watched->fragmentPath);
+        return;
+    }
+
+    // the renderer recreated or dropped the program while this one was building
+    if (*watched->program == 0 || strcmp(currentDefines(watched), watched->buildDefines) != 0) {
+        RenderShaderDelete(program);
+        watched->dirty = *watched->program != 0;
+        return;
+    }
+
+    RenderShaderDelete(*watched->program);
+    *watched->program = program;
+    if (watched->onSwap) {
+        watched->onSwap(program, watched->data);
+    }
+
+    double ms = (double)(SDL_GetPerformanceCounter() - watched->buildStart) * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("Shader reload: %s + %s swapped in after %.1f ms\n", watched->vertexPath, watched->fragmentPath, ms);
+}
+
+void updateShaderReload(void) {
+    if (!reload.active) {
+        return;
+    }
+
+    readEvents();
+    for (unsigned int i = 0; i < reload.numPrograms; i++) {
+        WatchedProgram* watched = &reload.programs[i];
+        if (watched->building) {
+            // without the parallel compile extension this is the frame after the compile was issued
+            if (shaderBuildReady(&watched->build)) {
+                finishReload(watched);
+            }
+        } else if (watched->dirty && *watched->program != 0) {
+            beginReload(watched);
+        }
+    }
+}
+
+void freeShaderReload(void) {
+    for (unsigned int i = 0; i < reload.numPrograms; i++) {
+        WatchedProgram* watched = &reload.programs[i];
+        if (watched->building) {
+            unsigned int program = finishShaderBuild(&watched->build);
+            if (program != (unsigned int)-1) {
+                RenderShaderDelete(program);
+            }
+        }
+        free(watched->buildDefines);
+    }
+
+#ifdef __linux__
+    if (reload.active) {
+        close(reload.fd);
+    }
+#endif
+    reload = (ShaderReload){0};
+}
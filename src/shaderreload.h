@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "shader.h"
+
+#define SHADER_RELOAD_MAX_PROGRAMS 16
+#define SHADER_RELOAD_DIRECTORY "./shaders"
+
+// per program state that has to be set up again on the new program, e.g. uniform block bindings
+typedef void (*ShaderSwapFunction)(unsigned int program, void* data);
+// current define set of a program, NULL for none
+typedef const char* (*ShaderDefinesFunction)(void);
+
+typedef struct watchedProgram {
+    // the slot the renderer draws with, only written at a frame boundary
+    unsigned int* program;
+    const char* vertexPath;
+    const char* fragmentPath;
+    ShaderDefinesFunction defines;
+    ShaderSwapFunction onSwap;
+    void* data;
+
+    bool dirty;
+    bool building;
+    ShaderBuild build;
+    // the defines the build started with, a slot rebuilt with others meanwhile drops the build
+    char* buildDefines;
+    unsigned long long buildStart;
+} WatchedProgram;
+
+// inotify on the shader directory, false where it is unavailable
+bool initShaderReload(const char* directory);
+// program has to stay at the same address, a slot holding 0 is skipped until it is created
+void watchShaderProgram(unsigned int* program, const char* vertexPath, const char* fragmentPath, ShaderDefinesFunction defines,
+                        ShaderSwapFunction onSwap, void* data);
+// GL thread, once per frame before any draw: starts builds of changed programs and swaps in finished ones
+void updateShaderReload(void);
+void freeShaderReload(void);
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "shadersource.h"
+#include "io.h"
+#include "memtrack.h"
+
+static void appendText(ShaderSource* source, const char* text, size_t length) {
+    if (!source->valid) {
+        return;
+    }
+
+    if (source->length + length + 1 > source->capacity) {
+        size_t capacity = source->capacity ? source->capacity * 2 : 4096;
+        while (capacity < source->length + length + 1) {
+            capacity *= 2;
+        }
+
+        char* grown = trackedRealloc(MEMORY_IO_SCRATCH, source->text, capacity);
+        if (!grown) {
+            printf("Error: Could not grow shader source to %zu bytes\n", capacity);
+            source->valid = false;
+            return;
+        }
+        source->text = grown;
+        source->capacity = capacity;
+    }
+
+    memcpy(source->text + source->length, text, length);
+    source->length += length;
+    source->text[source->length] = '\0';
+}
+
+// GLSL 3.30 numbers the line after "#line n" as n + 1, later versions as n
+static void appendLine(ShaderSource* source, unsigned int nextLine, unsigned int file) {
+    char directive[32];
+    int length = snprintf(directive, sizeof(directive), "#line %u %u\n", nextLine - 1, file);
+    appendText(source, directive, (size_t)length);
+}
+
+static int findFile(const ShaderSource* source, const char* path) {
+    for (unsigned int i = 0; i < source->numFiles; i++) {
+        if (strcmp(source->files[i], path) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// the name between the quotes of an #include line, relative to the directory of the including file
+static bool includePath(const char* line, const char* end, const char* from, char* path) {
+    const char* open = memchr(line, '"', (size_t)(end - line));
+    const char* close = open ? memchr(open + 1, '"', (size_t)(end - open - 1)) : NULL;
+    if (!close) {
+        return false;
+    }
+
+    const char* slash = strrchr(from, '/');
+    size_t directory = slash ? (size_t)(slash - from + 1) : 0;
+    size_t name = (size_t)(close - open - 1);
+    if (directory + name >= SHADER_MAX_PATH) {
+        return false;
+    }
+
+    memcpy(path, from, directory);
+    memcpy(path + directory, open + 1, name);
+    path[directory + name] = '\0';
+    return true;
+}
+
+static void appendFile(ShaderSource* source, const char* path, const char* defines, unsigned int depth) {
+    if (source->numFiles == SHADER_MAX_FILES || strlen(path) >= SHADER_MAX_PATH) {
+        printf("Error: Too many or too long shader includes at %s\n", path);
+        source->valid = false;
+        return;
+    }
+
+    File file = io_file_read(path);
+    if (!file.is_valid) {
+        printf("Error reading shader: %s\n", path);
+        source->valid = false;
+        return;
+    }
+
+    unsigned int index = source->numFiles++;
+    strcpy(source->files[index], path);
+
+    const char* line = file.data;
+    const char* fileEnd = file.data + file.len;
+    for (unsigned int number = 1; line < fileEnd && source->valid; number++) {
+        const char* end = memchr(line, '\n', (size_t)(fileEnd - line));
+        end = end ? end + 1 : fileEnd;
+
+        const char* directive = line;
+        while (directive < end && (*directive == ' ' || *directive == '\t')) {
+            directive++;
+        }
+
+        if ((size_t)(end - directive) > 8 && strncmp(directive, "#include", 8) == 0) {
+            char included[SHADER_MAX_PATH];
+            if (!includePath(directive, end, path, included)) {
+                printf("Error: Malformed include in %s line %u\n", path, number);
+                source->valid = false;
+            } else if (depth + 1 >= SHADER_MAX_INCLUDE_DEPTH) {
+                printf("Error: Includes nested deeper than %d in %s\n", SHADER_MAX_INCLUDE_DEPTH, path);
+                source->valid = false;
+            } else {
+                if (findFile(source, included) < 0) {
+                    appendLine(source, 1, source->numFiles);
+                    appendFile(source, included, NULL, depth + 1);
+                }
+                // a repeated include drops its line too, what follows has to be renumbered either way
+                appendLine(source, number + 1, index);
+            }
+        } else {
+            appendText(source, line, (size_t)(end - line));
+            if (end == fileEnd && end[-1] != '\n') {
+                appendText(source, "\n", 1);
+            }
+
+            // the defines go right after the #version line, which has to stay first
+            if (depth == 0 && number == 1 && defines && defines[0] != '\0') {
+                appendText(source, defines, strlen(defines));
+                appendLine(source, 2, 0);
+            }
+        }
+        line = end;
+    }
+
+    io_file_free(&file);
+}
+
+ShaderSource preprocessShader(const char* path, const char* defines) {
+    ShaderSource source = {.valid = true};
+    appendFile(&source, path, defines, 0);
+    // an empty file still hands GL a string
+    appendText(&source, "", 0);
+    if (!source.valid) {
+        freeShaderSource(&source);
+    }
+    return source;
+}
+
+void freeShaderSource(ShaderSource* source) {
+    trackedFree(source->text);
+    source->text = NULL;
+    source->length = 0;
+    source->capacity = 0;
+}
+
+uint64_t hashShaderText(uint64_t seed, const char* text, size_t length) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
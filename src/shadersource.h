@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// files per expanded stage, the main file included
+#define SHADER_MAX_FILES 16
+#define SHADER_MAX_PATH 256
+#define SHADER_MAX_INCLUDE_DEPTH 8
+// FNV-1a, continue a hash by passing it back in as the seed
+#define SHADER_HASH_SEED 14695981039346656037ull
+
+// one stage with its #include lines resolved and the defines after #version
+typedef struct shaderSource {
+    char* text;
+    size_t length;
+    size_t capacity;
+    // #line source string numbers, 0 is the main file
+    char files[SHADER_MAX_FILES][SHADER_MAX_PATH];
+    unsigned int numFiles;
+    bool valid;
+} ShaderSource;
+
+// #include "name" is relative to the including file and pulls every file in once per stage
+ShaderSource preprocessShader(const char* path, const char* defines);
+void freeShaderSource(ShaderSource* source);
+uint64_t hashShaderText(uint64_t seed, const char* text, size_t length);
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "startup.h"
+
+typedef struct startupBudget {
+    const char* name;
+    double ms;
+} StartupBudget;
+
+typedef struct startupProfiler {
+    bool active;
+    struct timespec start;
+
+    StartupPhase phases[STARTUP_MAX_PHASES];
+    unsigned int numPhases;
+    // indices of the open phases, innermost last
+    unsigned int open[STARTUP_MAX_DEPTH];
+    unsigned int depth;
+    // phases past the limits are not recorded, their ends still have to match
+    unsigned int dropped;
+
+    StartupBudget budgets[STARTUP_MAX_BUDGETS];
+    unsigned int numBudgets;
+} StartupProfiler;
+
+static StartupProfiler profiler = {0};
+
+static StartupSample takeSample(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (StartupSample){
+        .ms = (double)(now.tv_sec - profiler.start.tv_sec) * 1000.0 + (double)(now.tv_nsec - profiler.start.tv_nsec) / 1e6,
+        .maxRssKiB = usage.ru_maxrss,
+        .minorFaults = usage.ru_minflt,
+        .majorFaults = usage.ru_majflt,
+    };
+}
+
+// exec to main: dynamic linking and constructors, only to the kernel's clock tick
+static double beforeMainMs(void) {
+#ifdef __linux__
+    FILE* file = fopen("/proc/self/stat", "r");
+    if (!file) {
+        return -1.0;
+    }
+
+    char line[1024];
+    size_t length = fread(line, 1, sizeof(line) - 1, file);
+    fclose(file);
+    line[length] = '\0';
+
+    // the command name may contain spaces, the fields after it do not; starttime is the 20th after it
+    char* field = strrchr(line, ')');
+    unsigned long long startTicks = 0;
+    for (int i = 0; field && i < 20; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    if (!field || sscanf(field, " %llu", &startTicks) != 1) {
+        return -1.0;
+    }
+
+    struct timespec boot;
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    double nowMs = (double)boot.tv_sec * 1000.0 + (double)boot.tv_nsec / 1e6;
+    return nowMs - (double)startTicks * 1000.0 / (double)sysconf(_SC_CLK_TCK);
+#else
+    return -1.0;
+#endif
+}
+
+void initStartupProfiler(void) {
+    profiler.active = true;
+    clock_gettime(CLOCK_MONOTONIC, &profiler.start);
+}
+
+void beginStartupPhase(const char* name) {
+    if (!profiler.active) {
+        return;
+    }
+    if (profiler.dropped > 0 || profiler.numPhases == STARTUP_MAX_PHASES || profiler.depth == STARTUP_MAX_DEPTH) {
+        profiler.dropped++;
+        return;
+    }
+
+    unsigned int index = profiler.numPhases++;
+    profiler.phases[index] = (StartupPhase){.name = name, .depth = profiler.depth, .begin = takeSample()};
+    profiler.open[profiler.depth++] = index;
+}
+
+void endStartupPhase(void) {
+    if (!profiler.active) {
+        return;
+    }
+    if (profiler.dropped > 0) {
+        profiler.dropped--;
+        return;
+    }
+    if (profiler.depth == 0) {
+        printf("Startup profiler: phase ended twice\n");
+        return;
+    }
+
+    profiler.phases[profiler.open[--profiler.depth]].end = takeSample();
+}
+
+void setStartupBudget(const char* name, double ms) {
+    if (profiler.numBudgets == STARTUP_MAX_BUDGETS) {
+        printf("Startup profiler: more than %d budgets, %s is ignored\n", STARTUP_MAX_BUDGETS, name);
+        return;
+    }
+    profiler.budgets[profiler.numBudgets++] = (StartupBudget){name, ms};
+}
+
+static void printRow(const char* name, unsigned int depth, const StartupSample* begin, const StartupSample* end,
+                     double totalMs) {
+    double ms = end->ms - begin->ms;
+    printf("  %*s%-*s %9.1f %6.1f%% %+9.1f %8ld %6ld\n", depth * 2, "", 28 - depth * 2, name, ms,
+           totalMs > 0.0 ? ms * 100.0 / totalMs : 0.0, (double)(end->maxRssKiB - begin->maxRssKiB) / 1024.0,
+           end->minorFaults - begin->minorFaults, end->majorFaults - begin->majorFaults);
+}
+
+static double phaseMs(const char* name, const StartupSample* end) {
+    if (strcmp(name, STARTUP_TOTAL) == 0) {
+        return end->ms;
+    }
+
+    // negative when no phase has the name, e.g. a typo on the command line
+    double ms = -1.0;
+    for (unsigned int i = 0; i < profiler.numPhases; i++) {
+        if (strcmp(profiler.phases[i].name, name) == 0) {
+            ms = (ms < 0.0 ? 0.0 : ms) + profiler.phases[i].end.ms - profiler.phases[i].begin.ms;
+        }
+    }
+    return ms;
+}
+
+bool reportStartup(void) {
+    if (!profiler.active) {
+        return true;
+    }
+
+    StartupSample end = takeSample();
+    // phases still open run up to the first frame
+    while (profiler.depth > 0) {
+        profiler.phases[profiler.open[--profiler.depth]].end = end;
+    }
+    profiler.active = false;
+
+    double beforeMain = beforeMainMs() - end.ms;
+    printf("Startup: %.1f ms to the first frame", end.ms);
+    if (beforeMain >= 0.0) {
+        printf(", %.0f ms more before main", beforeMain);
+    }
+    printf(", peak RSS %.1f MiB, %ld minor and %ld major page faults\n", (double)end.maxRssKiB / 1024.0, end.minorFaults,
+           end.majorFaults);
+
+    printf("  %-28s %9s %7s %9s %8s %6s\n", "phase", "ms", "share", "RSS MiB", "minflt", "majflt");
+    double topLevelMs = 0.0;
+    for (unsigned int i = 0; i < profiler.numPhases; i++) {
+        StartupPhase* phase = &profiler.phases[i];
+        printRow(phase->name, phase->depth, &phase->begin, &phase->end, end.ms);
+        if (phase->depth == 0) {
+            topLevelMs += phase->end.ms - phase->begin.ms;
+        }
+    }
+    printf("  %-28s %9.1f %6.1f%%\n", "outside phases", end.ms - topLevelMs,
+           end.ms > 0.0 ? (end.ms - topLevelMs) * 100.0 / end.ms : 0.0);
+    if (profiler.dropped > 0 || profiler.numPhases == STARTUP_MAX_PHASES) {
+        printf("  more than %d phases or %d levels, the rest is outside phases\n", STARTUP_MAX_PHASES, STARTUP_MAX_DEPTH);
+    }
+
+    bool passed = true;
+    for (unsigned int i = 0; i < profiler.numBudgets; i++) {
+        StartupBudget* budget = &profiler.budgets[i];
+        double ms = phaseMs(budget->name, &end);
+        if (ms < 0.0) {
+            printf("Startup budget: no phase called %s\n", budget->name);
+            passed = false;
+        } else if (ms > budget->ms) {
+            printf("Startup budget exceeded: %s took %.1f ms of %.1f ms\n", budget->name, ms, budget->ms);
+            passed = false;
+        }
+    }
+    if (profiler.numBudgets > 0 && passed) {
+        printf("Startup within all %u budgets\n", profiler.numBudgets);
+    }
+    return passed;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+
+#define STARTUP_MAX_PHASES 64
+#define STARTUP_MAX_DEPTH 8
+#define STARTUP_MAX_BUDGETS 16
+// phase name of the whole run up to the first presented frame, for budgets
+#define STARTUP_TOTAL "total"
+
+typedef struct startupSample {
+    double ms;
+    // peak resident set, getrusage has no current one
+    long maxRssKiB;
+    long minorFaults;
+    long majorFaults;
+} StartupSample;
+
+typedef struct startupPhase {
+    const char* name;
+    unsigned int depth;
+    StartupSample begin;
+    StartupSample end;
+} StartupPhase;
+
+// first thing in main, times are relative to this
+void initStartupProfiler(void);
+// phases nest, every begin needs its end; both do nothing once the report was printed
+void beginStartupPhase(const char* name);
+void endStartupPhase(void);
+// milliseconds for every phase called name, STARTUP_TOTAL for the whole startup; repeatable
+void setStartupBudget(const char* name, double ms);
+// at the first presented frame, prints the breakdown and returns false if a budget was exceeded
+bool reportStartup(void);
@@ -0,0 +1,444 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "streaming.h"
+#include "io.h"
+#include "memtrack.h"
+
+typedef struct streamRequest {
+    unsigned int texture;
+    int level;
+    const char* path;
+    size_t offset;
+    size_t size;
+    File data;
+} StreamRequest;
+
+// one loader thread reads levels from the cache files, the main thread owns everything GL
+typedef struct textureStreamer {
+    StreamedTexture* textures;
+    unsigned int numTextures;
+    unsigned int sizeTextures;
+    // texture name to slot in textures, -1 when not streamed
+    int* slots;
+    unsigned int numSlots;
+
+    SDL_Thread* loader;
+    SDL_mutex* mutex;
+    SDL_cond* wake;
+    bool quit;
+    StreamRequest requests[STREAMING_QUEUE_SIZE];
+    unsigned int requestHead, requestCount;
+    StreamRequest completed[STREAMING_QUEUE_SIZE];
+    unsigned int completedHead, completedCount;
+    // requests not yet uploaded, bounds both queues
+    unsigned int numInFlight;
+
+    unsigned int frame;
+    StreamingStats stats;
+} TextureStreamer;
+
+static TextureStreamer streamer = {0};
+static bool streamingActive = false;
+
+static int streamingLoader(void* data) {
+    TextureStreamer* s = data;
+
+    SDL_LockMutex(s->mutex);
+    while (true) {
+        while (s->requestCount == 0 && !s->quit) {
+            SDL_CondWait(s->wake, s->mutex);
+        }
+        if (s->quit) {
+            break;
+        }
+
+        StreamRequest request = s->requests[s->requestHead];
+        s->requestHead = (s->requestHead + 1) % STREAMING_QUEUE_SIZE;
+        s->requestCount--;
+        SDL_UnlockMutex(s->mutex);
+
+        request.data = io_file_read_range(request.path, request.offset, request.size);
+
+        SDL_LockMutex(s->mutex);
+        s->completed[(s->completedHead + s->completedCount) % STREAMING_QUEUE_SIZE] = request;
+        s->completedCount++;
+    }
+    SDL_UnlockMutex(s->mutex);
+
+    return 0;
+}
+
+void initTextureStreaming(size_t budgetBytes) {
+    streamer.stats.budgetBytes = budgetBytes;
+    // textures start out with lastUsedFrame 0, never current
+    streamer.frame = 1;
+    streamer.mutex = SDL_CreateMutex();
+    streamer.wake = SDL_CreateCond();
+    streamer.loader = SDL_CreateThread(streamingLoader, "streaming", &streamer);
+    if (!streamer.loader) {
+        printf("Failed to start texture streaming: %s\n", SDL_GetError());
+        SDL_DestroyCond(streamer.wake);
+        SDL_DestroyMutex(streamer.mutex);
+        return;
+    }
+
+    streamingActive = true;
+}
+
+bool textureStreamingActive(void) {
+    return streamingActive;
+}
+
+static StreamedTexture* findStreamedTexture(unsigned int id) {
+    if (id >= streamer.numSlots || streamer.slots[id] < 0) {
+        return NULL;
+    }
+    return &streamer.textures[streamer.slots[id]];
+}
+
+static void addStreamedTexture(const StreamedTexture* texture) {
+    if (streamer.numTextures == streamer.sizeTextures) {
+        streamer.sizeTextures = streamer.sizeTextures ? streamer.sizeTextures * 2 : 16;
+        streamer.textures = realloc(streamer.textures, streamer.sizeTextures * sizeof(StreamedTexture));
+    }
+
+    if (texture->id >= streamer.numSlots) {
+        unsigned int numSlots = texture->id * 2 + 1;
+        streamer.slots = realloc(streamer.slots, numSlots * sizeof(int));
+        for (unsigned int i = streamer.numSlots; i < numSlots; i++) {
+            streamer.slots[i] = -1;
+        }
+        streamer.numSlots = numSlots;
+    }
+
+    // entries of unloaded textures are reused so loading models in and out does not grow the array
+    for (unsigned int i = 0; i < streamer.numTextures; i++) {
+        if (streamer.textures[i].released && !streamer.textures[i].pending) {
+            streamer.slots[texture->id] = i;
+            streamer.textures[i] = *texture;
+            return;
+        }
+    }
+
+    streamer.slots[texture->id] = streamer.numTextures;
+    streamer.textures[streamer.numTextures++] = *texture;
+}
+
+void releaseStreamedTexture(unsigned int id) {
+    StreamedTexture* texture = streamingActive ? findStreamedTexture(id) : NULL;
+    if (!texture) {
+        return;
+    }
+
+    for (uint32_t i = texture->residentBase; i < texture->header.levels; i++) {
+        streamer.stats.residentBytes -= texture->header.levelSizes[i];
+    }
+    streamer.slots[id] = -1;
+    texture->id = 0;
+    texture->released = true;
+
+    // a level in flight still reads the path, uploadCompleted drops it on arrival
+    if (!texture->pending) {
+        free(texture->cachePath);
+        texture->cachePath = NULL;
+    }
+}
+
+// charges the levels currently resident, the tail included
+static void trackResidentLevels(const StreamedTexture* texture) {
+    size_t bytes = 0;
+    for (uint32_t i = texture->residentBase; i < texture->header.levels; i++) {
+        bytes += texture->header.levelSizes[i];
+    }
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, texture->id, MEMORY_TEXTURE_GPU, bytes);
+}
+
+unsigned int streamTexture(const char* path, bool srgb) {
+    StreamedTexture texture = {0};
+    char cachePath[512];
+    if (!openCachedTexture(path, srgb, &texture.header, cachePath, sizeof(cachePath))) {
+        return 0;
+    }
+
+    const TextureCacheHeader* header = &texture.header;
+    int tailBase = header->levels - 1;
+    while (tailBase > 0 && mipLevelSize(header->width, tailBase - 1) <= STREAMING_TAIL_SIZE &&
+           mipLevelSize(header->height, tailBase - 1) <= STREAMING_TAIL_SIZE) {
+        tailBase--;
+    }
+
+    // the tail levels are stored back to back at the end of the entry
+    size_t tailOffset = header->levelOffsets[tailBase];
+    size_t tailSize = header->levelOffsets[header->levels - 1] + header->levelSizes[header->levels - 1] - tailOffset;
+    File tail = io_file_read_range(cachePath, tailOffset, tailSize);
+    if (!tail.is_valid) {
+        return 0;
+    }
+
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    for (uint32_t i = tailBase; i < header->levels; i++) {
+        uploadTextureLevel(header, i, (const unsigned char*)tail.data + header->levelOffsets[i] - tailOffset);
+        streamer.stats.residentBytes += header->levelSizes[i];
+    }
+    io_file_free(&tail);
+
+    setTextureCacheParameters(header);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tailBase);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, (float)tailBase);
+
+    texture.cachePath = strdup(cachePath);
+    texture.residentBase = tailBase;
+    texture.tailBase = tailBase;
+    texture.desiredLevel = tailBase;
+    texture.minLod = (float)tailBase;
+    trackResidentLevels(&texture);
+    addStreamedTexture(&texture);
+
+    return texture.id;
+}
+
+// nearest point of the bounds, in object space
+static float distanceToBounds(const Mesh* mesh, const vec4 point) {
+    float distance = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        float d = fmaxf(fmaxf(mesh->aabbMin[i] - point[i], point[i] - mesh->aabbMax[i]), 0.0f);
+        distance += d * d;
+    }
+    return sqrtf(distance);
+}
+
+void requestModelTextures(const Model* model, mat4x4 modelMatrix, mat4x4 modelViewProjection, vec3 cameraPosition,
+                          mat4x4 projection, int viewportHeight) {
+    // done in object space, assumes a uniformly scaled model matrix
+    mat4x4 inverseModel;
+    mat4x4_invert(inverseModel, modelMatrix);
+    vec4 camera = {cameraPosition[0], cameraPosition[1], cameraPosition[2], 1.0f};
+    vec4 localCamera;
+    mat4x4_mul_vec4(localCamera, inverseModel, camera);
+
+    // pixels covered by one unit at distance one
+    float pixelScale = projection[1][1] * viewportHeight * 0.5f;
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        const Mesh* mesh = &model->meshes[i];
+        // occlusion only runs on request, the frustum test keeps meshes out of view from asking for mips either way
+        if (!mesh->visible || mesh->uvDensity <= 0.0f || meshOutsideFrustum(mesh, modelViewProjection)) {
+            continue;
+        }
+
+        float distance = fmaxf(distanceToBounds(mesh, localCamera), 0.01f);
+        float pixelsPerUnit = pixelScale / distance;
+
+        for (unsigned int t = 0; t < mesh->numTextures; t++) {
+            StreamedTexture* texture = findStreamedTexture(mesh->textures[t].id);
+            if (!texture) {
+                continue;
+            }
+
+            float texelsPerUnit = mesh->uvDensity * sqrtf((float)texture->header.width * texture->header.height);
+            float ratio = texelsPerUnit / pixelsPerUnit;
+            int level = ratio > 1.0f ? (int)floorf(log2f(ratio)) : 0;
+            level = level < texture->tailBase ? level : texture->tailBase;
+
+            if (texture->lastUsedFrame != streamer.frame) {
+                texture->lastUsedFrame = streamer.frame;
+                texture->desiredLevel = level;
+            } else if (level < texture->desiredLevel) {
+                texture->desiredLevel = level;
+            }
+        }
+    }
+}
+
+static bool evictableLevel(const StreamedTexture* texture) {
+    if (texture->pending || texture->released || texture->residentBase >= texture->tailBase) {
+        return false;
+    }
+    // still needed by something on screen this frame
+    return texture->lastUsedFrame != streamer.frame || texture->residentBase < texture->desiredLevel;
+}
+
+// drops the finest level of the least recently used textures until size more bytes fit the budget
+static bool makeRoom(size_t size) {
+    while (streamer.stats.residentBytes + size > streamer.stats.budgetBytes) {
+        StreamedTexture* victim = NULL;
+        for (unsigned int i = 0; i < streamer.numTextures; i++) {
+            StreamedTexture* texture = &streamer.textures[i];
+            if (evictableLevel(texture) && (!victim || texture->lastUsedFrame < victim->lastUsedFrame)) {
+                victim = texture;
+            }
+        }
+
+        if (!victim) {
+            return false;
+        }
+
+        int level = victim->residentBase++;
+        victim->minLod = fmaxf(victim->minLod, (float)victim->residentBase);
+
+        glBindTexture(GL_TEXTURE_2D, victim->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, victim->residentBase);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, victim->minLod);
+        releaseTextureLevel(&victim->header, level);
+        trackResidentLevels(victim);
+
+        streamer.stats.residentBytes -= victim->header.levelSizes[level];
+        streamer.stats.numEvictions++;
+    }
+
+    return true;
+}
+
+static void uploadCompleted(void) {
+    size_t uploaded = 0;
+
+    while (uploaded < STREAMING_UPLOAD_BYTES_PER_FRAME) {
+        SDL_LockMutex(streamer.mutex);
+        if (streamer.completedCount == 0) {
+            SDL_UnlockMutex(streamer.mutex);
+            break;
+        }
+        StreamRequest request = streamer.completed[streamer.completedHead];
+        streamer.completedHead = (streamer.completedHead + 1) % STREAMING_QUEUE_SIZE;
+        streamer.completedCount--;
+        SDL_UnlockMutex(streamer.mutex);
+
+        StreamedTexture* texture = &streamer.textures[request.texture];
+        texture->pending = false;
+        streamer.numInFlight--;
+
+        if (texture->released) {
+            streamer.stats.residentBytes -= request.size;
+            io_file_free(&request.data);
+            free(texture->cachePath);
+            texture->cachePath = NULL;
+            continue;
+        }
+
+        if (!request.data.is_valid) {
+            streamer.stats.residentBytes -= request.size;
+            continue;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture->id);
+        uploadTextureLevel(&texture->header, request.level, (const unsigned char*)request.data.data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, request.level);
+        io_file_free(&request.data);
+
+        texture->residentBase = request.level;
+        trackResidentLevels(texture);
+        uploaded += request.size;
+        streamer.stats.numUploads++;
+    }
+}
+
+static void fadeLod(void) {
+    for (unsigned int i = 0; i < streamer.numTextures; i++) {
+        StreamedTexture* texture = &streamer.textures[i];
+        if (!texture->released && texture->minLod > texture->residentBase) {
+            texture->minLod = fmaxf(texture->minLod - STREAMING_LOD_FADE, (float)texture->residentBase);
+            glBindTexture(GL_TEXTURE_2D, texture->id);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, texture->minLod);
+        }
+    }
+}
+
+static void issueRequests(void) {
+    while (streamer.numInFlight < STREAMING_QUEUE_SIZE) {
+        // biggest gap between what is resident and what the screen needs first
+        StreamedTexture* next = NULL;
+        int bestGap = 0;
+        for (unsigned int i = 0; i < streamer.numTextures; i++) {
+            StreamedTexture* texture = &streamer.textures[i];
+            int gap = texture->residentBase - texture->desiredLevel;
+            if (!texture->pending && !texture->released && texture->lastUsedFrame == streamer.frame && gap > bestGap) {
+                next = texture;
+                bestGap = gap;
+            }
+        }
+
+        if (!next) {
+            break;
+        }
+
+        int level = next->residentBase - 1;
+        size_t size = next->header.levelSizes[level];
+        if (!makeRoom(size)) {
+            streamer.stats.numDeferred++;
+            break;
+        }
+
+        // reserved now so requests in flight count against the budget
+        streamer.stats.residentBytes += size;
+        next->pending = true;
+        streamer.numInFlight++;
+
+        StreamRequest request = {(unsigned int)(next - streamer.textures), level, next->cachePath,
+                                 next->header.levelOffsets[level], size, {0}};
+
+        SDL_LockMutex(streamer.mutex);
+        streamer.requests[(streamer.requestHead + streamer.requestCount) % STREAMING_QUEUE_SIZE] = request;
+        streamer.requestCount++;
+        SDL_CondSignal(streamer.wake);
+        SDL_UnlockMutex(streamer.mutex);
+    }
+}
+
+void updateTextureStreaming(void) {
+    if (!streamingActive) {
+        return;
+    }
+
+    uploadCompleted();
+    fadeLod();
+    issueRequests();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    streamer.frame++;
+}
+
+void reportTextureStreaming(void) {
+    if (!streamingActive) {
+        return;
+    }
+
+    StreamingStats* stats = &streamer.stats;
+    printf("Streaming: %.1f of %.1f MiB resident, %u uploads, %u evictions, %u deferred by the budget\n",
+           stats->residentBytes / (1024.0 * 1024.0), stats->budgetBytes / (1024.0 * 1024.0),
+           stats->numUploads, stats->numEvictions, stats->numDeferred);
+}
+
+void freeTextureStreaming(void) {
+    if (!streamingActive) {
+        return;
+    }
+
+    SDL_LockMutex(streamer.mutex);
+    streamer.quit = true;
+    SDL_CondSignal(streamer.wake);
+    SDL_UnlockMutex(streamer.mutex);
+    SDL_WaitThread(streamer.loader, NULL);
+
+    // anything the loader finished but nobody uploaded
+    for (unsigned int i = 0; i < streamer.completedCount; i++) {
+        io_file_free(&streamer.completed[(streamer.completedHead + i) % STREAMING_QUEUE_SIZE].data);
+    }
+
+    for (unsigned int i = 0; i < streamer.numTextures; i++) {
+        free(streamer.textures[i].cachePath);
+    }
+    free(streamer.textures);
+    free(streamer.slots);
+
+    SDL_DestroyCond(streamer.wake);
+    SDL_DestroyMutex(streamer.mutex);
+
+    streamer = (TextureStreamer){0};
+    streamingActive = false;
+}
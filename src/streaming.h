@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <linmath.h>
+
+#include "model.h"
+#include "texcache.h"
+
+#define STREAMING_DEFAULT_BUDGET_MIB 256
+// levels at or below this size are loaded with the texture and never evicted
+#define STREAMING_TAIL_SIZE 64
+#define STREAMING_QUEUE_SIZE 64
+// bytes uploaded per frame at most, spreads large levels over frames
+#define STREAMING_UPLOAD_BYTES_PER_FRAME (16 * 1024 * 1024)
+// MIN_LOD steps per frame toward a newly arrived level, hides the pop
+#define STREAMING_LOD_FADE 0.1f
+
+typedef struct streamedTexture {
+    unsigned int id;
+    char* cachePath;
+    TextureCacheHeader header;
+    // finest level on the GPU, everything from here to the smallest mip is resident
+    int residentBase;
+    int tailBase;
+    int desiredLevel;
+    bool pending;
+    // unloaded, the entry is reused once no request is in flight
+    bool released;
+    unsigned int lastUsedFrame;
+    float minLod;
+} StreamedTexture;
+
+typedef struct streamingStats {
+    size_t residentBytes;
+    size_t budgetBytes;
+    unsigned int numUploads;
+    unsigned int numEvictions;
+    unsigned int numDeferred;
+} StreamingStats;
+
+void initTextureStreaming(size_t budgetBytes);
+bool textureStreamingActive(void);
+// loads only the tail mips, finer levels follow once requested
+unsigned int streamTexture(const char* path, bool srgb);
+// estimates the finest level each visible mesh in the frustum needs from its bounds, distance and uv density
+void requestModelTextures(const Model* model, mat4x4 modelMatrix, mat4x4 modelViewProjection, vec3 cameraPosition,
+                          mat4x4 projection, int viewportHeight);
+// stops streaming a texture about to be deleted
+void releaseStreamedTexture(unsigned int id);
+void updateTextureStreaming(void);
+void reportTextureStreaming(void);
+void freeTextureStreaming(void);
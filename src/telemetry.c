@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "telemetry.h"
+
+typedef struct telemetry {
+    bool active;
+    FILE* output;
+    double budgetMs;
+    Uint64 frequency;
+
+    Uint64 frameStart;
+    Uint64 lastMark;
+    uint64_t numFrames;
+
+    // reset with every summary, and over the whole run
+    TelemetryHistogram window[TELEMETRY_PHASE_COUNT];
+    TelemetryHistogram total[TELEMETRY_PHASE_COUNT];
+    uint64_t windowOverBudget;
+    uint64_t totalOverBudget;
+} Telemetry;
+
+static const char* phaseNames[TELEMETRY_PHASE_COUNT] = {
+    "frame",
+    "input",
+    "cull",
+    "uniforms",
+    "model",
+    "lights",
+    "swap",
+    "wait",
+};
+
+// no allocation anywhere past initTelemetry, the histograms are static
+static Telemetry telemetry = {0};
+
+static unsigned int bucketIndex(uint32_t value) {
+    unsigned int linear = 2u << TELEMETRY_SUB_BUCKET_BITS;
+    if (value < linear) {
+        return value;
+    }
+
+    int exponent = 31 - __builtin_clz(value) - TELEMETRY_SUB_BUCKET_BITS;
+    if (exponent > TELEMETRY_MAX_EXPONENT) {
+        return TELEMETRY_BUCKETS - 1;
+    }
+    return (exponent << TELEMETRY_SUB_BUCKET_BITS) + (value >> exponent);
+}
+
+// largest value that lands in the bucket
+static uint32_t bucketValue(unsigned int index) {
+    unsigned int linear = 2u << TELEMETRY_SUB_BUCKET_BITS;
+    if (index < linear) {
+        return index;
+    }
+
+    int exponent = (index >> TELEMETRY_SUB_BUCKET_BITS) - 1;
+    uint32_t sub = index - (exponent << TELEMETRY_SUB_BUCKET_BITS);
+    return ((sub + 1) << exponent) - 1;
+}
+
+static void recordValue(TelemetryHistogram* histogram, uint32_t value) {
+    histogram->counts[bucketIndex(value)]++;
+    histogram->numSamples++;
+    histogram->sum += value;
+    histogram->max = value > histogram->max ? value : histogram->max;
+}
+
+static double percentileMs(const TelemetryHistogram* histogram, double percentile) {
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)histogram->numSamples + 0.5);
+    target = target > 0 ? target : 1;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < TELEMETRY_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= target) {
+            uint32_t value = bucketValue(i);
+            return (value < histogram->max ? value : histogram->max) / 1000.0;
+        }
+    }
+    return histogram->max / 1000.0;
+}
+
+static void writeSummary(const char* scope, TelemetryHistogram* histograms, uint64_t overBudget) {
+    for (int phase = 0; phase < TELEMETRY_PHASE_COUNT; phase++) {
+        const TelemetryHistogram* histogram = &histograms[phase];
+        if (histogram->numSamples == 0) {
+            continue;
+        }
+
+        fprintf(telemetry.output,
+                "telemetry scope=%s frame=%llu phase=%s samples=%llu mean_ms=%.3f p50_ms=%.3f p95_ms=%.3f p99_ms=%.3f max_ms=%.3f",
+                scope, (unsigned long long)telemetry.numFrames, phaseNames[phase], (unsigned long long)histogram->numSamples,
+                (double)histogram->sum / histogram->numSamples / 1000.0, percentileMs(histogram, 50.0),
+                percentileMs(histogram, 95.0), percentileMs(histogram, 99.0), histogram->max / 1000.0);
+        if (phase == TELEMETRY_FRAME) {
+            fprintf(telemetry.output, " budget_ms=%.3f over_budget=%llu", telemetry.budgetMs, (unsigned long long)overBudget);
+        }
+        fputc('\n', telemetry.output);
+    }
+    fflush(telemetry.output);
+}
+
+bool initTelemetry(const char* path, double budgetMs) {
+    if (path == NULL || strcmp(path, "stdout") == 0) {
+        telemetry.output = stdout;
+    } else {
+        telemetry.output = fopen(path, "w");
+        if (!telemetry.output) {
+            printf("Error: Could not open telemetry output %s\n", path);
+            return false;
+        }
+    }
+
+    telemetry.budgetMs = budgetMs;
+    telemetry.frequency = SDL_GetPerformanceFrequency();
+    telemetry.active = true;
+    return true;
+}
+
+bool telemetryActive(void) {
+    return telemetry.active;
+}
+
+static uint32_t elapsedMicroseconds(Uint64 from, Uint64 to) {
+    uint64_t us = (to - from) * 1000000 / telemetry.frequency;
+    return us < UINT32_MAX ? (uint32_t)us : UINT32_MAX;
+}
+
+void beginTelemetryFrame(void) {
+    if (!telemetry.active) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (telemetry.frameStart != 0) {
+        uint32_t frame = elapsedMicroseconds(telemetry.frameStart, now);
+        recordValue(&telemetry.window[TELEMETRY_FRAME], frame);
+        recordValue(&telemetry.total[TELEMETRY_FRAME], frame);
+
+        if (frame > telemetry.budgetMs * 1000.0) {
+            telemetry.windowOverBudget++;
+            telemetry.totalOverBudget++;
+        }
+        telemetry.numFrames++;
+
+        if (telemetry.numFrames % TELEMETRY_INTERVAL == 0) {
+            writeSummary("window", telemetry.window, telemetry.windowOverBudget);
+            memset(telemetry.window, 0, sizeof(telemetry.window));
+            telemetry.windowOverBudget = 0;
+            // writing is not part of any phase
+            now = SDL_GetPerformanceCounter();
+        }
+    }
+
+    telemetry.frameStart = now;
+    telemetry.lastMark = now;
+}
+
+void markTelemetryPhase(TelemetryPhase phase) {
+    if (!telemetry.active) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    uint32_t elapsed = elapsedMicroseconds(telemetry.lastMark, now);
+    recordValue(&telemetry.window[phase], elapsed);
+    recordValue(&telemetry.total[phase], elapsed);
+    telemetry.lastMark = now;
+}
+
+void freeTelemetry(void) {
+    if (!telemetry.active) {
+        return;
+    }
+
+    writeSummary("total", telemetry.total, telemetry.totalOverBudget);
+    if (telemetry.output != stdout) {
+        fclose(telemetry.output);
+    }
+    memset(&telemetry, 0, sizeof(telemetry));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// log-linear buckets: exact below 2^(TELEMETRY_SUB_BUCKET_BITS + 1) microseconds,
+// then 2^TELEMETRY_SUB_BUCKET_BITS buckets per power of two, so under 1% error up to 2^25 us (33 s)
+#define TELEMETRY_SUB_BUCKET_BITS 7
+#define TELEMETRY_MAX_EXPONENT 17
+#define TELEMETRY_BUCKETS ((TELEMETRY_MAX_EXPONENT + 2) << TELEMETRY_SUB_BUCKET_BITS)
+// frames per written summary
+#define TELEMETRY_INTERVAL 600
+
+typedef enum telemetryPhase {
+    // start to start of consecutive frames
+    TELEMETRY_FRAME,
+    // events and fixed timestep updates
+    TELEMETRY_INPUT,
+    // culling, texture streaming requests and draw list recording
+    TELEMETRY_CULL,
+    TELEMETRY_UNIFORMS,
+    TELEMETRY_MODEL,
+    TELEMETRY_LIGHTS,
+    // includes the renderer's end of frame bookkeeping
+    TELEMETRY_SWAP,
+    TELEMETRY_WAIT,
+    TELEMETRY_PHASE_COUNT,
+} TelemetryPhase;
+
+typedef struct telemetryHistogram {
+    uint32_t counts[TELEMETRY_BUCKETS];
+    uint64_t numSamples;
+    uint64_t sum;
+    uint32_t max;
+} TelemetryHistogram;
+
+// path NULL or "stdout" writes to stdout
+bool initTelemetry(const char* path, double budgetMs);
+bool telemetryActive(void);
+// call at the top of every frame, writes a summary every TELEMETRY_INTERVAL frames
+void beginTelemetryFrame(void);
+// charges the time since the previous mark to phase
+void markTelemetryPhase(TelemetryPhase phase);
+// writes the whole run and closes the output
+void freeTelemetry(void);
@@ -0,0 +1,541 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <stb/stb_image.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "texcache.h"
+#include "glext.h"
+#include "bc.h"
+#include "io.h"
+#include "memtrack.h"
+#include "vfs.h"
+
+#define TEXTURE_CACHE_ALIGNMENT 16
+
+TextureCacheStats textureCacheStats = {0};
+MipFilter textureMipFilter = MIP_FILTER_KAISER;
+
+static unsigned int handleTextures[TEXTURE_CACHE_MAX_HANDLES];
+static uint64_t handles[TEXTURE_CACHE_MAX_HANDLES];
+
+static uint64_t hashPath(const char* path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = path; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// the same file cooked as sRGB and linear, or with another mip filter, gets an entry of its own
+static void cachePathFor(const char* path, bool srgb, char* out, size_t size) {
+    uint64_t key = hashPath(path);
+    unsigned char variant[2] = {srgb, (unsigned char)textureMipFilter};
+    for (int i = 0; i < 2; i++) {
+        key ^= variant[i];
+        key *= 1099511628211ull;
+    }
+    snprintf(out, size, "%s/%016llx.tex", TEXTURE_CACHE_DIR, (unsigned long long)key);
+}
+
+static void makeCacheDir(void) {
+#ifdef _WIN32
+    _mkdir(TEXTURE_CACHE_DIR);
+#else
+    mkdir(TEXTURE_CACHE_DIR, 0755);
+#endif
+}
+
+static bool formatSupported(TextureFormat format) {
+    switch (format) {
+        case TEXTURE_FORMAT_RAW:
+        case TEXTURE_FORMAT_BC4:
+        case TEXTURE_FORMAT_BC5:
+            // RGTC is core since 3.0
+            return true;
+        case TEXTURE_FORMAT_BC1:
+        case TEXTURE_FORMAT_BC3:
+            return glExt.textureCompressionS3TC;
+        case TEXTURE_FORMAT_BC7:
+            return glExt.textureCompressionBPTC;
+    }
+    return false;
+}
+
+static TextureFormat chooseFormat(int channels) {
+    if (channels == 1) {
+        return TEXTURE_FORMAT_BC4;
+    }
+
+    if (channels == 2) {
+        return TEXTURE_FORMAT_BC5;
+    }
+
+    if (TEXTURE_CACHE_PREFER_BC7 && formatSupported(TEXTURE_FORMAT_BC7)) {
+        return TEXTURE_FORMAT_BC7;
+    }
+
+    if (formatSupported(TEXTURE_FORMAT_BC1)) {
+        return channels == 4 ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1;
+    }
+
+    return TEXTURE_FORMAT_RAW;
+}
+
+static BCFormat bcFormatFor(TextureFormat format) {
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+            return BC_FORMAT_BC1;
+        case TEXTURE_FORMAT_BC3:
+            return BC_FORMAT_BC3;
+        case TEXTURE_FORMAT_BC4:
+            return BC_FORMAT_BC4;
+        case TEXTURE_FORMAT_BC5:
+            return BC_FORMAT_BC5;
+        default:
+            return BC_FORMAT_BC7;
+    }
+}
+
+static GLenum pixelFormatFor(int channels) {
+    if (channels == 1) {
+        return GL_RED;
+    } else if (channels == 2) {
+        return GL_RG;
+    } else if (channels == 3) {
+        return GL_RGB;
+    }
+    return GL_RGBA;
+}
+
+static GLenum internalFormatFor(int channels) {
+    if (channels == 1) {
+        return GL_R8;
+    } else if (channels == 2) {
+        return GL_RG8;
+    } else if (channels == 3) {
+        return GL_RGB8;
+    }
+    return GL_RGBA8;
+}
+
+static GLenum compressedFormatFor(TextureFormat format) {
+    switch (format) {
+        case TEXTURE_FORMAT_BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TEXTURE_FORMAT_BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TEXTURE_FORMAT_BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case TEXTURE_FORMAT_BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case TEXTURE_FORMAT_BC7:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+        default:
+            return 0;
+    }
+}
+
+static unsigned char* expandToRGBA(const unsigned char* src, int width, int height, int channels) {
+    size_t count = (size_t)width * height;
+    unsigned char* dst = malloc(count * 4);
+
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 4; c++) {
+            if (c < channels) {
+                dst[i * 4 + c] = src[i * channels + c];
+            } else {
+                dst[i * 4 + c] = c == 3 ? 255 : (channels == 1 ? src[i] : 0);
+            }
+        }
+    }
+
+    return dst;
+}
+
+// packed sources are dated by the pack, entries cooked from the loose file stay valid as long as it is unchanged
+static bool sourceInfo(const char* path, struct stat* source) {
+    VfsFile packed;
+    if (vfsFind(path, &packed)) {
+        memset(source, 0, sizeof(*source));
+        source->st_size = (off_t)packed.size;
+        source->st_mtime = (time_t)packed.sourceTime;
+        return true;
+    }
+    return stat(path, source) == 0;
+}
+
+static size_t alignSize(size_t size) {
+    return (size + TEXTURE_CACHE_ALIGNMENT - 1) & ~(size_t)(TEXTURE_CACHE_ALIGNMENT - 1);
+}
+
+// decodes the source, builds the mip chain and encodes every level; returns header + level data in one block
+static unsigned char* cookTexture(const char* path, const struct stat* source, bool srgb, size_t* cookedSize) {
+    stbi_set_flip_vertically_on_load(true);
+
+    int width, height, channels;
+    VfsFile packed;
+    unsigned char* level;
+    if (vfsFind(path, &packed) && packed.compression == PACK_COMPRESSION_NONE) {
+        level = stbi_load_from_memory((const unsigned char*)packed.data, (int)packed.size, &width, &height, &channels, 0);
+    } else {
+        // compressed entries and loose containers need io.c to decode them first
+        File file = io_file_read(path);
+        level = NULL;
+        if (file.is_valid) {
+            level = stbi_load_from_memory((const unsigned char*)file.data, (int)file.len, &width, &height, &channels, 0);
+        }
+        io_file_free(&file);
+    }
+    if (!level) {
+        printf("Error: Failed to load texture %s\n", path);
+        return NULL;
+    }
+
+    TextureFormat format = chooseFormat(channels);
+
+    TextureCacheHeader header = {0};
+    memcpy(header.magic, "TEXC", 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = format;
+    header.channels = channels;
+    header.width = width;
+    header.height = height;
+    header.levels = mipLevelCount(width, height);
+    header.levels = header.levels < TEXTURE_CACHE_MAX_LEVELS ? header.levels : TEXTURE_CACHE_MAX_LEVELS;
+    header.mipFilter = textureMipFilter;
+    header.gammaCorrect = srgb;
+    header.sourceSize = source->st_size;
+    header.sourceTime = source->st_mtime;
+
+    size_t offset = alignSize(sizeof(TextureCacheHeader));
+    for (uint32_t i = 0; i < header.levels; i++) {
+        int w = mipLevelSize(width, i);
+        int h = mipLevelSize(height, i);
+        header.levelOffsets[i] = offset;
+        header.levelSizes[i] = format == TEXTURE_FORMAT_RAW ? (size_t)w * h * channels : bcImageSize(bcFormatFor(format), w, h);
+        offset = alignSize(offset + header.levelSizes[i]);
+    }
+
+    unsigned char* cooked = trackedCalloc(MEMORY_IO_SCRATCH, 1, offset);
+    memcpy(cooked, &header, sizeof(header));
+
+    for (uint32_t i = 0; i < header.levels; i++) {
+        int w = mipLevelSize(width, i);
+        int h = mipLevelSize(height, i);
+
+        if (format == TEXTURE_FORMAT_RAW) {
+            memcpy(cooked + header.levelOffsets[i], level, header.levelSizes[i]);
+        } else {
+            unsigned char* rgba = expandToRGBA(level, w, h, channels);
+            encodeBCImage(bcFormatFor(format), rgba, w, h, cooked + header.levelOffsets[i]);
+            free(rgba);
+        }
+
+        if (i + 1 < header.levels) {
+            unsigned char* next = malloc((size_t)mipLevelSize(w, 1) * mipLevelSize(h, 1) * channels);
+            buildMipLevel(level, w, h, channels, textureMipFilter, srgb, next);
+            if (i == 0) {
+                stbi_image_free(level);
+            } else {
+                free(level);
+            }
+            level = next;
+        }
+    }
+
+    if (header.levels == 1) {
+        stbi_image_free(level);
+    } else {
+        free(level);
+    }
+
+    *cookedSize = offset;
+    return cooked;
+}
+
+static bool validCacheEntry(const TextureCacheHeader* header, size_t fileSize, const struct stat* source, bool srgb) {
+    if (fileSize < sizeof(TextureCacheHeader)) {
+        return false;
+    }
+
+    if (memcmp(header->magic, "TEXC", 4) != 0 || header->version != TEXTURE_CACHE_VERSION) {
+        return false;
+    }
+
+    if (header->sourceSize != (uint64_t)source->st_size || header->sourceTime != (int64_t)source->st_mtime) {
+        return false;
+    }
+
+    if (header->mipFilter != textureMipFilter || header->gammaCorrect != srgb) {
+        return false;
+    }
+
+    if (header->levels == 0 || header->levels > TEXTURE_CACHE_MAX_LEVELS) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->levels; i++) {
+        if (header->levelOffsets[i] + header->levelSizes[i] > fileSize) {
+            return false;
+        }
+    }
+
+    // cooked for a driver with other compression support
+    return formatSupported(header->format);
+}
+
+static void countTexture(const TextureCacheHeader* header) {
+    textureCacheStats.numTextures++;
+    for (uint32_t i = 0; i < header->levels; i++) {
+        textureCacheStats.rawBytes += (size_t)mipLevelSize(header->width, i) * mipLevelSize(header->height, i) * header->channels;
+        textureCacheStats.gpuBytes += header->levelSizes[i];
+    }
+}
+
+GLenum textureInternalFormat(const TextureCacheHeader* header) {
+    return header->format == TEXTURE_FORMAT_RAW ? internalFormatFor(header->channels) : compressedFormatFor(header->format);
+}
+
+void setTextureCacheParameters(const TextureCacheHeader* header) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void uploadTextureLevel(const TextureCacheHeader* header, int level, const unsigned char* pixels) {
+    int w = mipLevelSize(header->width, level);
+    int h = mipLevelSize(header->height, level);
+    GLenum internalFormat = textureInternalFormat(header);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (header->format == TEXTURE_FORMAT_RAW) {
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, pixelFormatFor(header->channels), GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, header->levelSizes[level], pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void releaseTextureLevel(const TextureCacheHeader* header, int level) {
+    // redefining the level as empty lets the driver drop its memory
+    GLenum internalFormat = textureInternalFormat(header);
+    if (header->format == TEXTURE_FORMAT_RAW) {
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, pixelFormatFor(header->channels), GL_UNSIGNED_BYTE, NULL);
+    } else {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, 0, 0, 0, 0, NULL);
+    }
+}
+
+static unsigned int uploadTexture(const TextureCacheHeader* header, const unsigned char* data) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < header->levels; i++) {
+        bytes += header->levelSizes[i];
+    }
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, texture, MEMORY_TEXTURE_GPU, bytes);
+
+    if (!glExt.textureStorage) {
+        for (uint32_t i = 0; i < header->levels; i++) {
+            uploadTextureLevel(header, i, data + header->levelOffsets[i]);
+        }
+        setTextureCacheParameters(header);
+        return texture;
+    }
+
+    // allocates the whole chain once, no per level reallocation or completeness checks in the driver
+    GLenum internalFormat = textureInternalFormat(header);
+    glExt.texStorage2D(GL_TEXTURE_2D, header->levels, internalFormat, header->width, header->height);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < header->levels; i++) {
+        int w = mipLevelSize(header->width, i);
+        int h = mipLevelSize(header->height, i);
+        const unsigned char* pixels = data + header->levelOffsets[i];
+
+        if (header->format == TEXTURE_FORMAT_RAW) {
+            glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, w, h, pixelFormatFor(header->channels), GL_UNSIGNED_BYTE, pixels);
+        } else {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, w, h, internalFormat, header->levelSizes[i], pixels);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    setTextureCacheParameters(header);
+    return texture;
+}
+
+static unsigned char* readCacheEntry(const char* cachePath, const struct stat* source, bool srgb) {
+    struct stat cached;
+    if (stat(cachePath, &cached) != 0) {
+        return NULL;
+    }
+
+    File file = io_file_read(cachePath);
+    if (!file.is_valid) {
+        return NULL;
+    }
+
+    if (!validCacheEntry((const TextureCacheHeader*)file.data, file.len, source, srgb)) {
+        io_file_free(&file);
+        return NULL;
+    }
+
+    textureCacheStats.numHits++;
+    return (unsigned char*)file.data;
+}
+
+// returns header + level data, cooking and storing the entry when it is missing or stale
+static unsigned char* fetchCacheEntry(const char* path, const char* cachePath, bool srgb) {
+    struct stat source;
+    if (!sourceInfo(path, &source)) {
+        printf("Error: Failed to load texture %s\n", path);
+        return NULL;
+    }
+
+    unsigned char* entry = readCacheEntry(cachePath, &source, srgb);
+    if (entry) {
+        return entry;
+    }
+
+    size_t cookedSize = 0;
+    entry = cookTexture(path, &source, srgb, &cookedSize);
+    if (!entry) {
+        return NULL;
+    }
+
+    makeCacheDir();
+    io_file_write(entry, cookedSize, cachePath);
+
+    return entry;
+}
+
+unsigned int loadCachedTexture(const char* path, bool srgb) {
+    char cachePath[512];
+    cachePathFor(path, srgb, cachePath, sizeof(cachePath));
+
+    unsigned char* entry = fetchCacheEntry(path, cachePath, srgb);
+    if (!entry) {
+        return 0;
+    }
+
+    const TextureCacheHeader* header = (const TextureCacheHeader*)entry;
+    unsigned int texture = uploadTexture(header, entry);
+    countTexture(header);
+    trackedFree(entry);
+
+    return texture;
+}
+
+unsigned char* readCachedTexture(const char* path, bool srgb) {
+    char cachePath[512];
+    cachePathFor(path, srgb, cachePath, sizeof(cachePath));
+
+    unsigned char* entry = fetchCacheEntry(path, cachePath, srgb);
+    if (entry) {
+        countTexture((const TextureCacheHeader*)entry);
+    }
+    return entry;
+}
+
+GLenum texturePixelFormat(const TextureCacheHeader* header) {
+    return pixelFormatFor(header->channels);
+}
+
+bool openCachedTexture(const char* path, bool srgb, TextureCacheHeader* header, char* cachePath, size_t cachePathSize) {
+    cachePathFor(path, srgb, cachePath, cachePathSize);
+
+    // only the header is read when the entry is already cooked
+    struct stat source, cached;
+    if (sourceInfo(path, &source) && stat(cachePath, &cached) == 0 && (size_t)cached.st_size >= sizeof(TextureCacheHeader)) {
+        File file = io_file_read_range(cachePath, 0, sizeof(TextureCacheHeader));
+        if (file.is_valid) {
+            bool valid = validCacheEntry((const TextureCacheHeader*)file.data, cached.st_size, &source, srgb);
+            if (valid) {
+                memcpy(header, file.data, sizeof(TextureCacheHeader));
+            }
+            io_file_free(&file);
+
+            if (valid) {
+                textureCacheStats.numHits++;
+                countTexture(header);
+                return true;
+            }
+        }
+    }
+
+    unsigned char* entry = fetchCacheEntry(path, cachePath, srgb);
+    if (!entry) {
+        return false;
+    }
+
+    memcpy(header, entry, sizeof(TextureCacheHeader));
+    countTexture(header);
+    trackedFree(entry);
+
+    return true;
+}
+
+uint64_t residentTextureHandle(unsigned int texture) {
+    for (unsigned int i = 0; i < textureCacheStats.numResidentHandles; i++) {
+        if (handleTextures[i] == texture) {
+            return handles[i];
+        }
+    }
+
+    if (!glExt.bindlessTexture || textureCacheStats.numResidentHandles == TEXTURE_CACHE_MAX_HANDLES) {
+        printf("Error: No bindless handle for texture %u\n", texture);
+        return 0;
+    }
+
+    uint64_t handle = glExt.getTextureHandle(texture);
+    glExt.makeTextureHandleResident(handle);
+
+    handleTextures[textureCacheStats.numResidentHandles] = texture;
+    handles[textureCacheStats.numResidentHandles] = handle;
+    textureCacheStats.numResidentHandles++;
+
+    return handle;
+}
+
+void releaseTextureHandles(void) {
+    for (unsigned int i = 0; i < textureCacheStats.numResidentHandles; i++) {
+        glExt.makeTextureHandleNonResident(handles[i]);
+    }
+    textureCacheStats.numResidentHandles = 0;
+}
+
+void releaseTextureHandle(unsigned int texture) {
+    for (unsigned int i = 0; i < textureCacheStats.numResidentHandles; i++) {
+        if (handleTextures[i] == texture) {
+            glExt.makeTextureHandleNonResident(handles[i]);
+
+            unsigned int last = --textureCacheStats.numResidentHandles;
+            handleTextures[i] = handleTextures[last];
+            handles[i] = handles[last];
+            return;
+        }
+    }
+}
+
+void reportTextureCache(void) {
+    TextureCacheStats* stats = &textureCacheStats;
+    double rawMiB = stats->rawBytes / (1024.0 * 1024.0);
+    double gpuMiB = stats->gpuBytes / (1024.0 * 1024.0);
+
+    printf("Textures: %u loaded, %u from cache, %s mips, %.1f MiB on GPU instead of %.1f MiB (%.1f MiB saved)\n",
+           stats->numTextures, stats->numHits, mipFilterName(textureMipFilter), gpuMiB, rawMiB, rawMiB - gpuMiB);
+}
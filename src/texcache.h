@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "mipmap.h"
+
+// cooked textures live here, one file per source image
+#define TEXTURE_CACHE_DIR "./cache"
+#define TEXTURE_CACHE_VERSION 2
+#define TEXTURE_CACHE_MAX_LEVELS 16
+// BC7 over BC1/BC3 when the driver has BPTC; better quality, slower to cook
+#define TEXTURE_CACHE_PREFER_BC7 1
+
+typedef enum textureFormat {
+    TEXTURE_FORMAT_RAW,
+    TEXTURE_FORMAT_BC1,
+    TEXTURE_FORMAT_BC3,
+    TEXTURE_FORMAT_BC4,
+    TEXTURE_FORMAT_BC5,
+    TEXTURE_FORMAT_BC7,
+} TextureFormat;
+
+typedef struct textureCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t channels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    // entries cooked with other mip settings are rebuilt
+    uint16_t mipFilter;
+    uint16_t gammaCorrect;
+    // the cache entry is stale once the source changes
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t levelOffsets[TEXTURE_CACHE_MAX_LEVELS];
+    uint64_t levelSizes[TEXTURE_CACHE_MAX_LEVELS];
+} TextureCacheHeader;
+
+// bindless handles made resident through the cache
+#define TEXTURE_CACHE_MAX_HANDLES 1024
+
+typedef struct textureCacheStats {
+    unsigned int numTextures;
+    unsigned int numHits;
+    // what plain RGB(A)8 uploads with full mip chains would have used
+    size_t rawBytes;
+    size_t gpuBytes;
+    unsigned int numResidentHandles;
+} TextureCacheStats;
+
+extern TextureCacheStats textureCacheStats;
+extern MipFilter textureMipFilter;
+
+// srgb marks colour data, its mips are filtered in linear space
+unsigned int loadCachedTexture(const char* path, bool srgb);
+// whole entry, header followed by the level data; the caller frees it with trackedFree
+unsigned char* readCachedTexture(const char* path, bool srgb);
+// makes sure the cache entry exists and returns its header, levels are read separately at levelOffsets
+bool openCachedTexture(const char* path, bool srgb, TextureCacheHeader* header, char* cachePath, size_t cachePathSize);
+// per level uploads into mutable storage, for textures that change their resident levels; the texture must be bound
+void uploadTextureLevel(const TextureCacheHeader* header, int level, const unsigned char* pixels);
+void releaseTextureLevel(const TextureCacheHeader* header, int level);
+void setTextureCacheParameters(const TextureCacheHeader* header);
+// returns the texture's bindless handle, resident until releaseTextureHandles; the texture must not change afterwards
+uint64_t residentTextureHandle(unsigned int texture);
+void releaseTextureHandles(void);
+// drops the handle of a texture about to be deleted, if it has one
+void releaseTextureHandle(unsigned int texture);
+// GL enums for the stored format, internal is the compressed format for BC entries
+unsigned int textureInternalFormat(const TextureCacheHeader* header);
+unsigned int texturePixelFormat(const TextureCacheHeader* header);
+void reportTextureCache(void);
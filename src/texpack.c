@@ -0,0 +1,375 @@
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "texpack.h"
+#include "memtrack.h"
+#include "texcache.h"
+
+typedef struct packEntry {
+    const char* name;
+    bool srgb;
+    unsigned char* data;
+    const TextureCacheHeader* header;
+    bool tile;
+    // placement, x and y only for atlas tiles
+    int array;
+    int layer;
+    int x, y;
+} PackEntry;
+
+static TextureArray arrays[TEXTURE_PACK_MAX_ARRAYS];
+static unsigned int numArrays = 0;
+static TexturePackStats packStats = {0};
+static bool packingActive = false;
+
+void enableTexturePacking(void) {
+    packingActive = true;
+}
+
+bool texturePackingActive(void) {
+    return packingActive;
+}
+
+static bool isPowerOfTwo(int value) {
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+static int log2Int(int value) {
+    int result = 0;
+    while (value > 1) {
+        value >>= 1;
+        result++;
+    }
+    return result;
+}
+
+static size_t blockBytes(unsigned int format) {
+    return format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC4 ? 8 : 16;
+}
+
+static size_t levelBytes(const TextureArray* array, int level) {
+    int w = mipLevelSize(array->width, level);
+    int h = mipLevelSize(array->height, level);
+    if (array->format == TEXTURE_FORMAT_RAW) {
+        return (size_t)w * h * array->channels;
+    }
+    return (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes(array->format);
+}
+
+static int addArray(const TextureCacheHeader* header, bool atlas) {
+    if (numArrays == TEXTURE_PACK_MAX_ARRAYS) {
+        printf("Error: Too many texture arrays, %d max\n", TEXTURE_PACK_MAX_ARRAYS);
+        return -1;
+    }
+
+    TextureArray* array = &arrays[numArrays];
+    *array = (TextureArray){0};
+    array->format = header->format;
+    array->channels = header->channels;
+    array->atlas = atlas;
+    if (atlas) {
+        array->width = TEXTURE_ATLAS_PAGE_SIZE;
+        array->height = TEXTURE_ATLAS_PAGE_SIZE;
+        array->levels = mipLevelCount(TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE);
+    } else {
+        array->width = header->width;
+        array->height = header->height;
+        array->levels = header->levels;
+    }
+
+    return numArrays++;
+}
+
+// full size textures, one layer each in an array of matching format and size
+static void placeLayer(PackEntry* entry) {
+    const TextureCacheHeader* header = entry->header;
+    for (unsigned int i = 0; i < numArrays; i++) {
+        TextureArray* array = &arrays[i];
+        if (!array->atlas && array->format == header->format && array->channels == header->channels &&
+            array->width == (int)header->width && array->height == (int)header->height &&
+            array->numLayers < TEXTURE_ARRAY_MAX_LAYERS) {
+            entry->array = i;
+            entry->layer = array->numLayers++;
+            return;
+        }
+    }
+
+    entry->array = addArray(header, false);
+    if (entry->array >= 0) {
+        entry->layer = arrays[entry->array].numLayers++;
+    }
+}
+
+static int compareTiles(const void* a, const void* b) {
+    const TextureCacheHeader* ha = (*(const PackEntry* const*)a)->header;
+    const TextureCacheHeader* hb = (*(const PackEntry* const*)b)->header;
+    if (ha->format != hb->format) {
+        return (int)ha->format - (int)hb->format;
+    }
+    if (ha->channels != hb->channels) {
+        return (int)ha->channels - (int)hb->channels;
+    }
+    if (ha->height != hb->height) {
+        return (int)hb->height - (int)ha->height;
+    }
+    return (int)hb->width - (int)ha->width;
+}
+
+// shelf packing, tiles are powers of two and placed at multiples of their size so their mips stay separate
+static void placeTiles(PackEntry** tiles, unsigned int numTiles) {
+    qsort(tiles, numTiles, sizeof(PackEntry*), compareTiles);
+
+    int array = -1;
+    int x = 0, y = 0, shelfHeight = 0;
+    const TextureCacheHeader* previous = NULL;
+
+    for (unsigned int i = 0; i < numTiles; i++) {
+        PackEntry* tile = tiles[i];
+        const TextureCacheHeader* header = tile->header;
+        int w = header->width;
+        int h = header->height;
+
+        bool newGroup = !previous || previous->format != header->format || previous->channels != header->channels;
+        if (newGroup) {
+            array = addArray(header, true);
+            if (array < 0) {
+                return;
+            }
+            arrays[array].numLayers = 1;
+            x = y = shelfHeight = 0;
+        }
+        previous = header;
+
+        x = (x + w - 1) / w * w;
+        if (x + w > TEXTURE_ATLAS_PAGE_SIZE) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        if (y + h > TEXTURE_ATLAS_PAGE_SIZE) {
+            if (arrays[array].numLayers == TEXTURE_ARRAY_MAX_LAYERS) {
+                array = addArray(header, true);
+                if (array < 0) {
+                    return;
+                }
+            }
+            arrays[array].numLayers++;
+            x = y = shelfHeight = 0;
+        }
+
+        shelfHeight = shelfHeight > h ? shelfHeight : h;
+        tile->array = array;
+        tile->layer = arrays[array].numLayers - 1;
+        tile->x = x;
+        tile->y = y;
+        x += w;
+
+        // the page chain stops where the smallest tile would share texels or blocks with its neighbours
+        int smallest = w < h ? w : h;
+        int levels = log2Int(header->format == TEXTURE_FORMAT_RAW ? smallest : smallest / 4) + 1;
+        arrays[array].levels = arrays[array].levels < levels ? arrays[array].levels : levels;
+    }
+}
+
+static void copyTile(const TextureArray* array, const PackEntry* tile, int level, unsigned char* page) {
+    const TextureCacheHeader* header = tile->header;
+    const unsigned char* src = tile->data + header->levelOffsets[level];
+    int pageWidth = mipLevelSize(array->width, level);
+    int w = mipLevelSize(header->width, level);
+    int h = mipLevelSize(header->height, level);
+    int x = tile->x >> level;
+    int y = tile->y >> level;
+
+    if (array->format == TEXTURE_FORMAT_RAW) {
+        size_t rowBytes = (size_t)w * array->channels;
+        for (int row = 0; row < h; row++) {
+            memcpy(page + ((size_t)(y + row) * pageWidth + x) * array->channels, src + row * rowBytes, rowBytes);
+        }
+        return;
+    }
+
+    // whole blocks, the tile is block aligned down to the last page level
+    size_t bytes = blockBytes(array->format);
+    size_t rowBytes = (size_t)(w / 4) * bytes;
+    for (int row = 0; row < h / 4; row++) {
+        memcpy(page + ((size_t)(y / 4 + row) * (pageWidth / 4) + x / 4) * bytes, src + row * rowBytes, rowBytes);
+    }
+}
+
+static void uploadArray(TextureArray* array, int index, PackEntry* entries, unsigned int numEntries) {
+    glGenTextures(1, &array->id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    TextureCacheHeader format = {.format = array->format, .channels = array->channels};
+    GLenum internalFormat = textureInternalFormat(&format);
+
+    for (int level = 0; level < array->levels; level++) {
+        size_t layerBytes = levelBytes(array, level);
+        unsigned char* data = calloc(array->numLayers, layerBytes);
+
+        for (unsigned int i = 0; i < numEntries; i++) {
+            PackEntry* entry = &entries[i];
+            if (entry->array != index) {
+                continue;
+            }
+
+            unsigned char* layer = data + entry->layer * layerBytes;
+            if (array->atlas) {
+                copyTile(array, entry, level, layer);
+            } else {
+                memcpy(layer, entry->data + entry->header->levelOffsets[level], layerBytes);
+            }
+        }
+
+        int w = mipLevelSize(array->width, level);
+        int h = mipLevelSize(array->height, level);
+        if (array->format == TEXTURE_FORMAT_RAW) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, w, h, array->numLayers, 0,
+                         texturePixelFormat(&format), GL_UNSIGNED_BYTE, data);
+        } else {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, w, h, array->numLayers, 0,
+                                   layerBytes * array->numLayers, data);
+        }
+        array->bytes += layerBytes * array->numLayers;
+        free(data);
+    }
+    trackGpuObject(MEMORY_OBJECT_TEXTURE, array->id, MEMORY_TEXTURE_GPU, array->bytes);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array->levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+static PackEntry* findEntry(PackEntry* entries, unsigned int numEntries, const char* name, bool srgb) {
+    for (unsigned int i = 0; i < numEntries; i++) {
+        if (entries[i].srgb == srgb && strcmp(entries[i].name, name) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+void packModelTextures(Model* model) {
+    unsigned int sizeEntries = 0;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        sizeEntries += model->meshes[i].numTextures;
+    }
+    if (sizeEntries == 0) {
+        return;
+    }
+
+    PackEntry* entries = calloc(sizeEntries, sizeof(PackEntry));
+    PackEntry** tiles = calloc(sizeEntries, sizeof(PackEntry*));
+    unsigned int numEntries = 0;
+    unsigned int numTiles = 0;
+    unsigned int firstArray = numArrays;
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* mesh = &model->meshes[i];
+        for (unsigned int t = 0; t < mesh->numTextures; t++) {
+            Texture* texture = &mesh->textures[t];
+            bool srgb = strcmp("texture_diffuse", texture->type) == 0;
+            if (findEntry(entries, numEntries, texture->path.data, srgb)) {
+                continue;
+            }
+
+            char* path = calloc(strlen(model->directory) + texture->path.length + 2, sizeof(char));
+            sprintf(path, "%s/%s", model->directory, texture->path.data);
+            unsigned char* data = readCachedTexture(path, srgb);
+            free(path);
+            if (!data) {
+                continue;
+            }
+
+            PackEntry* entry = &entries[numEntries++];
+            entry->name = texture->path.data;
+            entry->srgb = srgb;
+            entry->data = data;
+            entry->header = (const TextureCacheHeader*)data;
+            entry->array = -1;
+
+            const TextureCacheHeader* header = entry->header;
+            entry->tile = header->width <= TEXTURE_ATLAS_MAX_TILE && header->height <= TEXTURE_ATLAS_MAX_TILE &&
+                          isPowerOfTwo(header->width) && isPowerOfTwo(header->height) &&
+                          (header->format == TEXTURE_FORMAT_RAW || (header->width >= 4 && header->height >= 4));
+            if (entry->tile) {
+                tiles[numTiles++] = entry;
+            } else {
+                placeLayer(entry);
+            }
+        }
+    }
+
+    placeTiles(tiles, numTiles);
+
+    for (unsigned int i = firstArray; i < numArrays; i++) {
+        uploadArray(&arrays[i], i, entries, numEntries);
+        if (arrays[i].atlas) {
+            packStats.numPages += arrays[i].numLayers;
+        } else {
+            packStats.numLayers += arrays[i].numLayers;
+        }
+    }
+    packStats.numTextures += numEntries;
+    packStats.numTiles += numTiles;
+
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        Mesh* mesh = &model->meshes[i];
+        for (unsigned int t = 0; t < mesh->numTextures; t++) {
+            Texture* texture = &mesh->textures[t];
+            PackEntry* entry = findEntry(entries, numEntries, texture->path.data, strcmp("texture_diffuse", texture->type) == 0);
+            if (!entry || entry->array < 0) {
+                continue;
+            }
+
+            const TextureArray* array = &arrays[entry->array];
+            texture->id = array->id;
+            texture->layer = entry->layer;
+            if (array->atlas) {
+                texture->uvTransform[0] = (float)entry->header->width / array->width;
+                texture->uvTransform[1] = (float)entry->header->height / array->height;
+                texture->uvTransform[2] = (float)entry->x / array->width;
+                texture->uvTransform[3] = (float)entry->y / array->height;
+            } else {
+                texture->uvTransform[0] = 1.0f;
+                texture->uvTransform[1] = 1.0f;
+                texture->uvTransform[2] = 0.0f;
+                texture->uvTransform[3] = 0.0f;
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < numEntries; i++) {
+        trackedFree(entries[i].data);
+    }
+    free(entries);
+    free(tiles);
+}
+
+void reportTexturePacking(void) {
+    size_t bytes = 0;
+    for (unsigned int i = 0; i < numArrays; i++) {
+        bytes += arrays[i].bytes;
+    }
+
+    printf("Texture packing: %u textures in %u arrays, %u layers, %u tiles on %u atlas pages, %.1f MiB\n",
+           packStats.numTextures, numArrays, packStats.numLayers, packStats.numTiles, packStats.numPages,
+           bytes / (1024.0 * 1024.0));
+}
+
+void freeTexturePacking(void) {
+    for (unsigned int i = 0; i < numArrays; i++) {
+        untrackGpuObject(MEMORY_OBJECT_TEXTURE, arrays[i].id);
+        glDeleteTextures(1, &arrays[i].id);
+    }
+    numArrays = 0;
+    packStats = (TexturePackStats){0};
+}
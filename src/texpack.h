@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "model.h"
+
+// textures up to this size in both dimensions go into atlas pages instead of their own layer
+#define TEXTURE_ATLAS_MAX_TILE 256
+#define TEXTURE_ATLAS_PAGE_SIZE 1024
+// minimum GL_MAX_ARRAY_TEXTURE_LAYERS in 3.3
+#define TEXTURE_ARRAY_MAX_LAYERS 256
+#define TEXTURE_PACK_MAX_ARRAYS 64
+
+typedef struct textureArray {
+    unsigned int id;
+    unsigned int format;
+    unsigned int channels;
+    int width;
+    int height;
+    int levels;
+    int numLayers;
+    bool atlas;
+    size_t bytes;
+} TextureArray;
+
+typedef struct texturePackStats {
+    unsigned int numTextures;
+    unsigned int numLayers;
+    unsigned int numTiles;
+    unsigned int numPages;
+} TexturePackStats;
+
+void enableTexturePacking(void);
+bool texturePackingActive(void);
+// groups the model's material textures into 2D array layers and atlas pages, meshes then refer to them by layer
+void packModelTextures(Model* model);
+void reportTexturePacking(void);
+void freeTexturePacking(void);
@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "transforms.h"
+#include "jobs.h"
+
+// one lane per object; the kernel below is written once against these and compiled at the widest width
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define TRANSFORM_LANES 8
+#define TRANSFORM_LANES_NAME "avx2"
+typedef __m256 Lanes;
+static inline Lanes lanesLoad(const float* p) { return _mm256_loadu_ps(p); }
+static inline void lanesStore(float* p, Lanes a) { _mm256_storeu_ps(p, a); }
+static inline Lanes lanesSet(float x) { return _mm256_set1_ps(x); }
+static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+static inline Lanes lanesSub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+static inline Lanes lanesMulAdd(Lanes a, Lanes b, Lanes c) { return _mm256_fmadd_ps(a, b, c); }
+static inline Lanes lanesAbs(Lanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TRANSFORM_LANES 4
+#define TRANSFORM_LANES_NAME "sse2"
+typedef __m128 Lanes;
+static inline Lanes lanesLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void lanesStore(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+static inline Lanes lanesSet(float x) { return _mm_set1_ps(x); }
+static inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes lanesSub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes lanesMul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes lanesMulAdd(Lanes a, Lanes b, Lanes c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline Lanes lanesAbs(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+#else
+#define TRANSFORM_LANES 1
+#define TRANSFORM_LANES_NAME "scalar"
+typedef float Lanes;
+static inline Lanes lanesLoad(const float* p) { return *p; }
+static inline void lanesStore(float* p, Lanes a) { *p = a; }
+static inline Lanes lanesSet(float x) { return x; }
+static inline Lanes lanesAdd(Lanes a, Lanes b) { return a + b; }
+static inline Lanes lanesSub(Lanes a, Lanes b) { return a - b; }
+static inline Lanes lanesMul(Lanes a, Lanes b) { return a * b; }
+static inline Lanes lanesMulAdd(Lanes a, Lanes b, Lanes c) { return a * b + c; }
+static inline Lanes lanesAbs(Lanes a) { return fabsf(a); }
+#endif
+
+_Static_assert(TRANSFORM_BATCH % TRANSFORM_LANES == 0, "a batch must hold whole kernel passes");
+_Static_assert(TRANSFORM_GRAIN % TRANSFORM_BATCH == 0, "chunks must hold whole batches");
+
+// position, rotation, scale, center, extent, worldMin and worldMax
+#define TRANSFORM_ARRAYS 22
+
+typedef struct composeContext {
+    TransformSet* set;
+    // column major, NULL for none
+    const float* parent;
+    bool bounds;
+    float* matrices;
+} ComposeContext;
+
+static float** transformArray(TransformSet* set, int array) {
+    float** arrays[] = {set->position, set->rotation, set->scale, set->center, set->extent, set->worldMin, set->worldMax};
+    int sizes[] = {3, 4, 3, 3, 3, 3, 3};
+    for (int i = 0;; array -= sizes[i++]) {
+        if (array < sizes[i]) {
+            return &arrays[i][array];
+        }
+    }
+}
+
+// origin, no rotation, unit scale and bounds from -1 to 1, in transformArray order
+static const float transformDefaults[TRANSFORM_ARRAYS] = {
+    0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+};
+
+static void resetTransforms(TransformSet* set, unsigned int begin, unsigned int end) {
+    for (int array = 0; array < TRANSFORM_ARRAYS; array++) {
+        float* values = *transformArray(set, array);
+        for (unsigned int i = begin; i < end; i++) {
+            values[i] = transformDefaults[array];
+        }
+    }
+}
+
+TransformSet initTransformSet(unsigned int capacity) {
+    TransformSet set = {0};
+    resizeTransformSet(&set, capacity);
+    set.count = 0;
+    return set;
+}
+
+void resizeTransformSet(TransformSet* set, unsigned int count) {
+    if (count > set->capacity) {
+        // all arrays share one block, padded so the last pass never reads past its array
+        unsigned int capacity = set->capacity ? set->capacity : TRANSFORM_BATCH;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+
+        float* block = malloc((size_t)capacity * TRANSFORM_ARRAYS * sizeof(float));
+        if (!block) {
+            printf("Error: Could not allocate %u transforms\n", capacity);
+            return;
+        }
+
+        float* old = set->position[0];
+        for (int array = 0; array < TRANSFORM_ARRAYS; array++) {
+            float** values = transformArray(set, array);
+            float* moved = block + (size_t)array * capacity;
+            if (set->count > 0) {
+                memcpy(moved, *values, set->count * sizeof(float));
+            }
+            *values = moved;
+        }
+        free(old);
+
+        set->capacity = capacity;
+        resetTransforms(set, set->count, capacity);
+    } else if (count > set->count) {
+        resetTransforms(set, set->count, count);
+    }
+    set->count = count;
+}
+
+unsigned int addTransform(TransformSet* set, vec3 position, quat rotation, vec3 scale) {
+    unsigned int index = set->count;
+    resizeTransformSet(set, index + 1);
+    for (int k = 0; k < 3; k++) {
+        set->position[k][index] = position[k];
+        set->scale[k][index] = scale[k];
+    }
+    for (int k = 0; k < 4; k++) {
+        set->rotation[k][index] = rotation[k];
+    }
+    return index;
+}
+
+void setTransformBounds(TransformSet* set, unsigned int index, vec3 min, vec3 max) {
+    for (int k = 0; k < 3; k++) {
+        set->center[k][index] = (min[k] + max[k]) * 0.5f;
+        set->extent[k][index] = (max[k] - min[k]) * 0.5f;
+    }
+}
+
+// world matrices of the objects from first on, one lane vector per column major element
+static void composeLanes(const TransformSet* set, unsigned int first, const float* parent, Lanes m[16]) {
+    Lanes x = lanesLoad(set->rotation[0] + first);
+    Lanes y = lanesLoad(set->rotation[1] + first);
+    Lanes z = lanesLoad(set->rotation[2] + first);
+    Lanes w = lanesLoad(set->rotation[3] + first);
+    Lanes two = lanesSet(2.0f);
+
+    // same expansion as mat4x4_from_quat
+    Lanes xx = lanesMul(x, x), yy = lanesMul(y, y), zz = lanesMul(z, z), ww = lanesMul(w, w);
+    Lanes xy = lanesMul(x, y), xz = lanesMul(x, z), yz = lanesMul(y, z);
+    Lanes wx = lanesMul(w, x), wy = lanesMul(w, y), wz = lanesMul(w, z);
+    Lanes sx = lanesLoad(set->scale[0] + first);
+    Lanes sy = lanesLoad(set->scale[1] + first);
+    Lanes sz = lanesLoad(set->scale[2] + first);
+
+    // T * R * S, the upper 3x3 columns followed by the translation
+    Lanes local[12] = {
+        lanesMul(lanesSub(lanesSub(lanesAdd(ww, xx), yy), zz), sx),
+        lanesMul(lanesMul(two, lanesAdd(xy, wz)), sx),
+        lanesMul(lanesMul(two, lanesSub(xz, wy)), sx),
+        lanesMul(lanesMul(two, lanesSub(xy, wz)), sy),
+        lanesMul(lanesSub(lanesAdd(lanesSub(ww, xx), yy), zz), sy),
+        lanesMul(lanesMul(two, lanesAdd(yz, wx)), sy),
+        lanesMul(lanesMul(two, lanesAdd(xz, wy)), sz),
+        lanesMul(lanesMul(two, lanesSub(yz, wx)), sz),
+        lanesMul(lanesAdd(lanesSub(lanesSub(ww, xx), yy), zz), sz),
+        lanesLoad(set->position[0] + first),
+        lanesLoad(set->position[1] + first),
+        lanesLoad(set->position[2] + first),
+    };
+
+    if (!parent) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 3; r++) {
+                m[c * 4 + r] = local[c * 3 + r];
+            }
+            m[c * 4 + 3] = lanesSet(c == 3 ? 1.0f : 0.0f);
+        }
+        return;
+    }
+
+    // the parent is shared by every lane, its elements are broadcast; local row 3 is (0, 0, 0, 1)
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            Lanes sum = lanesSet(c == 3 ? parent[12 + r] : 0.0f);
+            sum = lanesMulAdd(lanesSet(parent[8 + r]), local[c * 3 + 2], sum);
+            sum = lanesMulAdd(lanesSet(parent[4 + r]), local[c * 3 + 1], sum);
+            m[c * 4 + r] = lanesMulAdd(lanesSet(parent[r]), local[c * 3], sum);
+        }
+    }
+}
+
+// the world box around the transformed local box: center moved, extent through the absolute 3x3
+static void composeBounds(TransformSet* set, unsigned int first, const Lanes m[16]) {
+    Lanes cx = lanesLoad(set->center[0] + first);
+    Lanes cy = lanesLoad(set->center[1] + first);
+    Lanes cz = lanesLoad(set->center[2] + first);
+    Lanes ex = lanesLoad(set->extent[0] + first);
+    Lanes ey = lanesLoad(set->extent[1] + first);
+    Lanes ez = lanesLoad(set->extent[2] + first);
+
+    for (int r = 0; r < 3; r++) {
+        Lanes center = lanesMulAdd(m[r], cx, lanesMulAdd(m[4 + r], cy, lanesMulAdd(m[8 + r], cz, m[12 + r])));
+        Lanes extent = lanesMulAdd(lanesAbs(m[r]), ex, lanesMulAdd(lanesAbs(m[4 + r]), ey, lanesMul(lanesAbs(m[8 + r]), ez)));
+        lanesStore(set->worldMin[r] + first, lanesSub(center, extent));
+        lanesStore(set->worldMax[r] + first, lanesAdd(center, extent));
+    }
+}
+
+#if TRANSFORM_LANES == 8
+static void transpose8(__m256 rows[8]) {
+    __m256 t[8], s[8];
+    for (int i = 0; i < 4; i++) {
+        t[i * 2] = _mm256_unpacklo_ps(rows[i * 2], rows[i * 2 + 1]);
+        t[i * 2 + 1] = _mm256_unpackhi_ps(rows[i * 2], rows[i * 2 + 1]);
+    }
+    for (int i = 0; i < 2; i++) {
+        s[i * 4] = _mm256_shuffle_ps(t[i * 4], t[i * 4 + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        s[i * 4 + 1] = _mm256_shuffle_ps(t[i * 4], t[i * 4 + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        s[i * 4 + 2] = _mm256_shuffle_ps(t[i * 4 + 1], t[i * 4 + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        s[i * 4 + 3] = _mm256_shuffle_ps(t[i * 4 + 1], t[i * 4 + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (int i = 0; i < 4; i++) {
+        rows[i] = _mm256_permute2f128_ps(s[i], s[i + 4], 0x20);
+        rows[i + 4] = _mm256_permute2f128_ps(s[i], s[i + 4], 0x31);
+    }
+}
+#endif
+
+// lane vectors per element to one matrix per object, 16 floats each
+static void storeMatrices(const Lanes m[16], float* out) {
+#if TRANSFORM_LANES == 8
+    __m256 low[8], high[8];
+    for (int i = 0; i < 8; i++) {
+        low[i] = m[i];
+        high[i] = m[i + 8];
+    }
+    transpose8(low);
+    transpose8(high);
+    for (int i = 0; i < 8; i++) {
+        _mm256_storeu_ps(out + i * 16, low[i]);
+        _mm256_storeu_ps(out + i * 16 + 8, high[i]);
+    }
+#elif TRANSFORM_LANES == 4
+    for (int block = 0; block < 4; block++) {
+        __m128 r0 = m[block * 4], r1 = m[block * 4 + 1], r2 = m[block * 4 + 2], r3 = m[block * 4 + 3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out + block * 4, r0);
+        _mm_storeu_ps(out + 16 + block * 4, r1);
+        _mm_storeu_ps(out + 32 + block * 4, r2);
+        _mm_storeu_ps(out + 48 + block * 4, r3);
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        out[i] = m[i];
+    }
+#endif
+}
+
+// begin and end count kernel passes, not objects
+static void composeRange(void* data, int begin, int end) {
+    ComposeContext* context = data;
+    TransformSet* set = context->set;
+
+    for (int pass = begin; pass < end; pass++) {
+        unsigned int first = (unsigned int)pass * TRANSFORM_LANES;
+        Lanes m[16];
+        composeLanes(set, first, context->parent, m);
+        if (context->bounds) {
+            composeBounds(set, first, m);
+        }
+
+        // the output holds exactly count matrices, a partial last pass goes through the stack
+        float* out = context->matrices + (size_t)first * 16;
+        if (first + TRANSFORM_LANES <= set->count) {
+            storeMatrices(m, out);
+        } else {
+            float tail[TRANSFORM_LANES * 16];
+            storeMatrices(m, tail);
+            memcpy(out, tail, (set->count - first) * 16 * sizeof(float));
+        }
+    }
+}
+
+void composeTransforms(TransformSet* set, mat4x4 parent, bool bounds, float* matrices) {
+    ComposeContext context = {set, parent ? &parent[0][0] : NULL, bounds, matrices};
+    int numPasses = (int)((set->count + TRANSFORM_LANES - 1) / TRANSFORM_LANES);
+    parallelFor(numPasses, TRANSFORM_GRAIN / TRANSFORM_LANES, composeRange, &context);
+}
+
+void freeTransformSet(TransformSet* set) {
+    free(set->position[0]);
+    *set = (TransformSet){0};
+}
+
+static uint32_t randomState = 1;
+
+static float randomFloat(float min, float max) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return min + (max - min) * (float)(randomState >> 8) / (float)(1 << 24);
+}
+
+// what every caller did before, one linmath matrix per object
+static void composeReference(const TransformSet* set, unsigned int i, mat4x4 parent, mat4x4 world) {
+    quat rotation = {set->rotation[0][i], set->rotation[1][i], set->rotation[2][i], set->rotation[3][i]};
+    mat4x4 translation, rotated, local;
+    mat4x4_translate(translation, set->position[0][i], set->position[1][i], set->position[2][i]);
+    mat4x4_from_quat(rotated, rotation);
+    mat4x4_mul(local, translation, rotated);
+    mat4x4_scale_aniso(local, local, set->scale[0][i], set->scale[1][i], set->scale[2][i]);
+    mat4x4_mul(world, parent, local);
+}
+
+static double elapsedMs(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+bool benchmarkTransforms(int count) {
+    TransformSet set = initTransformSet((unsigned int)count);
+    float* matrices = malloc((size_t)count * sizeof(mat4x4));
+    mat4x4* reference = malloc((size_t)count * sizeof(mat4x4));
+    if (!set.position[0] || !matrices || !reference) {
+        printf("Error: Could not allocate %d transforms\n", count);
+        freeTransformSet(&set);
+        free(matrices);
+        free(reference);
+        return false;
+    }
+
+    randomState = 11;
+    for (int i = 0; i < count; i++) {
+        vec3 position = {randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f), randomFloat(-100.0f, 100.0f)};
+        vec3 scale = {randomFloat(0.25f, 4.0f), randomFloat(0.25f, 4.0f), randomFloat(0.25f, 4.0f)};
+        quat rotation = {randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(0.1f, 1.0f)};
+        quat_norm(rotation, rotation);
+        vec3 min = {randomFloat(-2.0f, 0.0f), randomFloat(-2.0f, 0.0f), randomFloat(-2.0f, 0.0f)};
+        vec3 max = {randomFloat(0.0f, 2.0f), randomFloat(0.0f, 2.0f), randomFloat(0.0f, 2.0f)};
+        unsigned int index = addTransform(&set, position, rotation, scale);
+        setTransformBounds(&set, index, min, max);
+    }
+
+    mat4x4 identity, parent;
+    mat4x4_identity(identity);
+    mat4x4_rotate(parent, identity, 0.3f, 1.0f, 0.2f, 0.7f);
+    mat4x4_translate_in_place(parent, 10.0f, -5.0f, 3.0f);
+
+    // one at a time, batched on this thread, and batched across the job system
+    double ms[3] = {0.0, 0.0, 0.0};
+    ComposeContext context = {&set, &parent[0][0], true, matrices};
+    int numPasses = (count + TRANSFORM_LANES - 1) / TRANSFORM_LANES;
+    for (int repeat = 0; repeat < TRANSFORM_BENCH_REPEAT; repeat++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < count; i++) {
+            composeReference(&set, (unsigned int)i, parent, reference[i]);
+        }
+        ms[0] += elapsedMs(start);
+
+        start = SDL_GetPerformanceCounter();
+        composeRange(&context, 0, numPasses);
+        ms[1] += elapsedMs(start);
+
+        start = SDL_GetPerformanceCounter();
+        composeTransforms(&set, parent, true, matrices);
+        ms[2] += elapsedMs(start);
+    }
+
+    // relative to the largest element of each column, rotations keep the columns of similar size
+    double maxError = 0.0;
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 4; c++) {
+            double scale = 1.0;
+            for (int r = 0; r < 4; r++) {
+                scale = fabs(reference[i][c][r]) > scale ? fabs(reference[i][c][r]) : scale;
+            }
+            for (int r = 0; r < 4; r++) {
+                double error = fabs((double)matrices[i * 16 + c * 4 + r] - reference[i][c][r]) / (FLT_EPSILON * scale);
+                maxError = error > maxError ? error : maxError;
+            }
+        }
+    }
+
+    // every corner of the local box has to land inside the world box
+    unsigned int outside = 0;
+    for (int i = 0; i < count; i++) {
+        for (int corner = 0; corner < 8; corner++) {
+            vec4 local, world;
+            for (int k = 0; k < 3; k++) {
+                local[k] = set.center[k][i] + ((corner >> k) & 1 ? set.extent[k][i] : -set.extent[k][i]);
+            }
+            local[3] = 1.0f;
+            mat4x4_mul_vec4(world, reference[i], local);
+            for (int k = 0; k < 3; k++) {
+                float slack = 1e-4f * (1.0f + fabsf(world[k]));
+                if (world[k] < set.worldMin[k][i] - slack || world[k] > set.worldMax[k][i] + slack) {
+                    outside++;
+                }
+            }
+        }
+    }
+
+    bool passed = maxError <= TRANSFORM_BENCH_BOUND && outside == 0;
+    for (int k = 0; k < 3; k++) {
+        ms[k] /= TRANSFORM_BENCH_REPEAT;
+    }
+    printf("Transform benchmark, %d objects with parent and bounds, %s kernel:\n", count, TRANSFORM_LANES_NAME);
+    printf("  one at a time %8.3f ms\n", ms[0]);
+    printf("  batched       %8.3f ms, %.2fx\n", ms[1], ms[0] / ms[1]);
+    printf("  %2d threads    %8.3f ms, %.2fx\n", jobWorkerCount() + 1, ms[2], ms[0] / ms[2]);
+    printf("  max error %.2f eps, %u corners outside their bounds: %s\n", maxError, outside, passed ? "passed" : "FAILED");
+
+    freeTransformSet(&set);
+    free(matrices);
+    free(reference);
+    return passed;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <linmath.h>
+
+// objects per kernel pass with AVX2, capacities are rounded up to it so every pass can load full lanes
+#define TRANSFORM_BATCH 8
+// objects per parallelFor chunk, a multiple of TRANSFORM_BATCH
+#define TRANSFORM_GRAIN 4096
+#define TRANSFORM_BENCH_OBJECTS 100000
+#define TRANSFORM_BENCH_REPEAT 20
+// largest accepted difference to the linmath path, in FLT_EPSILON times the largest element of the column
+#define TRANSFORM_BENCH_BOUND 16.0
+
+// one array per component so a kernel pass loads the same field of TRANSFORM_BATCH objects at once
+typedef struct transformSet {
+    unsigned int count;
+    unsigned int capacity;
+
+    float* position[3];
+    // quaternion with w last like linmath's quat
+    float* rotation[4];
+    float* scale[3];
+
+    // local bounds as center and half extent, only read when composing with bounds
+    float* center[3];
+    float* extent[3];
+    // axis aligned world bounds written by composeTransforms
+    float* worldMin[3];
+    float* worldMax[3];
+} TransformSet;
+
+TransformSet initTransformSet(unsigned int capacity);
+// grows the set, new objects start at the origin with no rotation and unit scale and bounds
+void resizeTransformSet(TransformSet* set, unsigned int count);
+unsigned int addTransform(TransformSet* set, vec3 position, quat rotation, vec3 scale);
+void setTransformBounds(TransformSet* set, unsigned int index, vec3 min, vec3 max);
+// writes count column major matrices parent * T * R * S to matrices, e.g. a mapped instance buffer;
+// parent may be NULL and must be affine when bounds are requested
+void composeTransforms(TransformSet* set, mat4x4 parent, bool bounds, float* matrices);
+void freeTransformSet(TransformSet* set);
+
+// batched against one mat4x4 at a time on count objects, run from the command line
+bool benchmarkTransforms(int count);
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vfs.h"
+
+typedef struct vfs {
+    bool active;
+    const unsigned char* pack;
+    size_t size;
+    VfsStats stats;
+} Vfs;
+
+static Vfs vfs = {0};
+
+bool initVfs(const char* packPath) {
+#ifndef _WIN32
+    int fd = open(packPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("Error: Could not open asset pack %s\n", packPath);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(PackHeader)) {
+        printf("Error: Asset pack %s is too small\n", packPath);
+        close(fd);
+        return false;
+    }
+
+    // the mapping keeps the file alive, pages are only read once touched
+    void* pack = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pack == MAP_FAILED) {
+        printf("Error: Could not map asset pack %s\n", packPath);
+        return false;
+    }
+
+    if (!validPackHeader(pack, (size_t)info.st_size)) {
+        printf("Error: %s is not a version %d asset pack\n", packPath, PACK_VERSION);
+        munmap(pack, (size_t)info.st_size);
+        return false;
+    }
+
+    vfs = (Vfs){.active = true, .pack = pack, .size = (size_t)info.st_size};
+    const PackHeader* header = pack;
+    printf("Asset pack %s: %u files, %.1f MiB\n", packPath, header->numEntries, (double)vfs.size / (1024.0 * 1024.0));
+    return true;
+#else
+    printf("Asset packs need mmap, %s is not mounted\n", packPath);
+    return false;
+#endif
+}
+
+bool vfsActive(void) {
+    return vfs.active;
+}
+
+bool vfsFind(const char* path, VfsFile* file) {
+    if (!vfs.active) {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&vfs.stats.numLookups, 1, memory_order_relaxed);
+    char normalized[PACK_MAX_PATH];
+    if (!normalizePackPath(path, normalized, sizeof(normalized))) {
+        return false;
+    }
+
+    const PackEntry* entry = findPackEntry(vfs.pack, normalized, hashPackPath(normalized));
+    if (!entry) {
+        return false;
+    }
+    if (entry->compression > PACK_COMPRESSION_LZ) {
+        printf("Error: %s is packed with unknown compression %u\n", normalized, entry->compression);
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&vfs.stats.numHits, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&vfs.stats.bytesServed, entry->size, memory_order_relaxed);
+    *file = (VfsFile){
+        .data = (const char*)vfs.pack + entry->offset,
+        .size = entry->size,
+        .storedSize = entry->storedSize,
+        .compression = (PackCompression)entry->compression,
+        .sourceTime = entry->sourceTime,
+    };
+    return true;
+}
+
+void reportVfs(void) {
+    if (!vfs.active) {
+        return;
+    }
+
+    printf("Asset pack: %u of %u lookups served, %.1f MiB\n", atomic_load(&vfs.stats.numHits),
+           atomic_load(&vfs.stats.numLookups), (double)atomic_load(&vfs.stats.bytesServed) / (1024.0 * 1024.0));
+}
+
+void freeVfs(void) {
+#ifndef _WIN32
+    if (vfs.active) {
+        munmap((void*)vfs.pack, vfs.size);
+    }
+#endif
+    vfs = (Vfs){0};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "pack.h"
+
+// a packed file, data points into the mapping and stays valid until freeVfs; compressed entries are
+// storedSize bytes of container there and size bytes once io.c decoded them
+typedef struct vfsFile {
+    const char* data;
+    size_t size;
+    size_t storedSize;
+    PackCompression compression;
+    int64_t sourceTime;
+} VfsFile;
+
+// updated from loader threads too
+typedef struct vfsStats {
+    atomic_uint numLookups;
+    atomic_uint numHits;
+    atomic_size_t bytesServed;
+} VfsStats;
+
+// maps the pack read only; paths it holds are served from it, everything else still comes from disk
+bool initVfs(const char* packPath);
+bool vfsActive(void);
+// any thread, lookups only read the mapping
+bool vfsFind(const char* path, VfsFile* file);
+void reportVfs(void);
+void freeVfs(void);
@@ -0,0 +1,345 @@
+// builds the asset pack mounted with -pack, run from the directory the game runs in:
+//   assetpack assets.pack assets shaders
+// -lz first stores every file that compresses well enough as an LZ container, and
+//   assetpack -lzfile <input> <output>
+// writes one loose container, which io.c reads like the original
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../src/pack.h"
+#include "../src/lz.h"
+
+typedef struct packFile {
+    char path[PACK_MAX_PATH];
+    uint64_t hash;
+    uint64_t size;
+    int64_t sourceTime;
+    // the container with -lz when it saved enough, NULL to copy the file as is
+    unsigned char* stored;
+    uint64_t storedSize;
+} PackFile;
+
+typedef struct packList {
+    PackFile* files;
+    unsigned int count;
+    unsigned int capacity;
+} PackList;
+
+static bool addFile(PackList* list, const char* path, const struct stat* info) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->files = realloc(list->files, list->capacity * sizeof(PackFile));
+    }
+
+    PackFile* file = &list->files[list->count];
+    if (!normalizePackPath(path, file->path, sizeof(file->path))) {
+        printf("Error: %s cannot be packed, paths have to be relative and inside the working directory\n", path);
+        return false;
+    }
+    file->hash = hashPackPath(file->path);
+    file->size = (uint64_t)info->st_size;
+    file->sourceTime = (int64_t)info->st_mtime;
+    file->stored = NULL;
+    file->storedSize = file->size;
+    list->count++;
+    return true;
+}
+
+static bool addPath(PackList* list, const char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        printf("Error: %s does not exist\n", path);
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        return addFile(list, path, &info);
+    }
+
+    DIR* directory = opendir(path);
+    if (!directory) {
+        printf("Error: Could not read directory %s\n", path);
+        return false;
+    }
+
+    bool passed = true;
+    struct dirent* entry;
+    while (passed && (entry = readdir(directory))) {
+        // hidden files are editor and VCS state
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char child[PACK_MAX_PATH];
+        if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child)) {
+            printf("Error: Path too long: %s/%s\n", path, entry->d_name);
+            passed = false;
+        } else {
+            passed = addPath(list, child);
+        }
+    }
+    closedir(directory);
+    return passed;
+}
+
+static int comparePaths(const void* a, const void* b) {
+    return strcmp(((const PackFile*)a)->path, ((const PackFile*)b)->path);
+}
+
+static int compareEntries(const void* a, const void* b) {
+    uint64_t hashA = ((const PackEntry*)a)->hash;
+    uint64_t hashB = ((const PackEntry*)b)->hash;
+    return (hashA > hashB) - (hashA < hashB);
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + PACK_ALIGNMENT - 1) & ~(uint64_t)(PACK_ALIGNMENT - 1);
+}
+
+static bool copyFile(FILE* output, const PackFile* file) {
+    FILE* input = fopen(file->path, "rb");
+    if (!input) {
+        printf("Error: Could not open %s\n", file->path);
+        return false;
+    }
+
+    char buffer[1 << 16];
+    uint64_t copied = 0;
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        fwrite(buffer, 1, n, output);
+        copied += n;
+    }
+    fclose(input);
+
+    if (copied != file->size) {
+        printf("Error: %s changed while packing\n", file->path);
+        return false;
+    }
+    return true;
+}
+
+static unsigned char* readFile(const char* path, uint64_t* size) {
+    FILE* input = fopen(path, "rb");
+    if (!input) {
+        printf("Error: Could not open %s\n", path);
+        return NULL;
+    }
+
+    fseek(input, 0, SEEK_END);
+    long length = ftell(input);
+    fseek(input, 0, SEEK_SET);
+    unsigned char* data = length >= 0 ? malloc((size_t)length + 1) : NULL;
+    if (!data || fread(data, 1, (size_t)length, input) != (size_t)length) {
+        printf("Error: Could not read %s\n", path);
+        free(data);
+        fclose(input);
+        return NULL;
+    }
+    fclose(input);
+
+    *size = (uint64_t)length;
+    return data;
+}
+
+static unsigned char* compressFile(const unsigned char* data, uint64_t size, uint64_t* compressedSize) {
+    size_t capacity = lzContainerBound(size);
+    unsigned char* compressed = malloc(capacity);
+    *compressedSize = compressLZ(data, size, compressed, capacity);
+    return compressed;
+}
+
+static bool compressEntry(PackFile* file) {
+    uint64_t size;
+    unsigned char* data = readFile(file->path, &size);
+    if (!data) {
+        return false;
+    }
+    if (size != file->size) {
+        printf("Error: %s changed while packing\n", file->path);
+        free(data);
+        return false;
+    }
+
+    uint64_t compressedSize;
+    unsigned char* compressed = compressFile(data, size, &compressedSize);
+    free(data);
+    // small savings are not worth decoding on every load
+    if (compressedSize == 0 || compressedSize > size * (1.0 - LZ_MIN_SAVING)) {
+        free(compressed);
+        return true;
+    }
+    file->stored = compressed;
+    file->storedSize = compressedSize;
+    return true;
+}
+
+static int writeContainer(const char* inputPath, const char* outputPath) {
+    uint64_t size;
+    unsigned char* data = readFile(inputPath, &size);
+    if (!data) {
+        return 1;
+    }
+
+    uint64_t compressedSize;
+    unsigned char* compressed = compressFile(data, size, &compressedSize);
+    FILE* output = fopen(outputPath, "wb");
+    bool passed = output && fwrite(compressed, 1, compressedSize, output) == compressedSize;
+    if (output && fclose(output) != 0) {
+        passed = false;
+    }
+    free(data);
+    free(compressed);
+
+    if (!passed) {
+        printf("Error: Writing %s failed\n", outputPath);
+        remove(outputPath);
+        return 1;
+    }
+    printf("Compressed %s into %s, %.1f%% of %.1f MiB\n", inputPath, outputPath,
+           size > 0 ? 100.0 * compressedSize / size : 100.0, (double)size / (1024.0 * 1024.0));
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && strcmp(argv[1], "-lzfile") == 0) {
+        return writeContainer(argv[2], argv[3]);
+    }
+
+    bool compress = argc > 1 && strcmp(argv[1], "-lz") == 0;
+    int first = compress ? 2 : 1;
+    if (argc < first + 2) {
+        printf("Usage: %s [-lz] <output.pack> <file or directory>...\n"
+               "       %s -lzfile <input> <output>\n", argv[0], argv[0]);
+        return 1;
+    }
+    const char* packPath = argv[first];
+
+    PackList list = {0};
+    for (int i = first + 1; i < argc; i++) {
+        if (!addPath(&list, argv[i])) {
+            return 1;
+        }
+    }
+
+    if (list.count == 0) {
+        printf("Error: Nothing to pack\n");
+        return 1;
+    }
+
+    // data in path order keeps the files of one model next to each other on disk
+    qsort(list.files, list.count, sizeof(PackFile), comparePaths);
+
+    unsigned int numCompressed = 0;
+    for (unsigned int i = 0; i < list.count && compress; i++) {
+        if (!compressEntry(&list.files[i])) {
+            return 1;
+        }
+        numCompressed += list.files[i].stored != NULL;
+    }
+
+    uint32_t numSlots = 1;
+    while (numSlots < list.count * PACK_SLOTS_PER_ENTRY || numSlots <= list.count) {
+        numSlots *= 2;
+    }
+
+    size_t namesSize = 0;
+    for (unsigned int i = 0; i < list.count; i++) {
+        namesSize += strlen(list.files[i].path) + 1;
+    }
+
+    PackHeader header = {
+        .magic = {'P', 'A', 'C', 'K'},
+        .version = PACK_VERSION,
+        .numEntries = list.count,
+        .numSlots = numSlots,
+        .entriesOffset = sizeof(PackHeader),
+    };
+    header.slotsOffset = header.entriesOffset + (uint64_t)list.count * sizeof(PackEntry);
+    header.namesOffset = header.slotsOffset + (uint64_t)numSlots * sizeof(uint32_t);
+    header.dataOffset = alignOffset(header.namesOffset + namesSize);
+
+    PackEntry* entries = calloc(list.count, sizeof(PackEntry));
+    char* names = calloc(header.dataOffset - header.namesOffset, 1);
+    uint64_t offset = header.dataOffset;
+    size_t nameOffset = 0;
+    for (unsigned int i = 0; i < list.count; i++) {
+        const PackFile* file = &list.files[i];
+        entries[i] = (PackEntry){
+            .hash = file->hash,
+            .offset = offset,
+            .size = file->size,
+            .storedSize = file->storedSize,
+            .sourceTime = file->sourceTime,
+            .nameOffset = (uint32_t)nameOffset,
+            .compression = file->stored ? PACK_COMPRESSION_LZ : PACK_COMPRESSION_NONE,
+        };
+        memcpy(names + nameOffset, file->path, strlen(file->path) + 1);
+        nameOffset += strlen(file->path) + 1;
+        offset = alignOffset(offset + file->storedSize);
+    }
+    header.size = offset;
+
+    // the table of contents is sorted by hash, the slots index into it
+    qsort(entries, list.count, sizeof(PackEntry), compareEntries);
+    uint32_t* slots = calloc(numSlots, sizeof(uint32_t));
+    for (unsigned int i = 0; i < list.count; i++) {
+        if (i > 0 && entries[i].hash == entries[i - 1].hash) {
+            printf("Error: %s and %s have the same hash\n", names + entries[i].nameOffset, names + entries[i - 1].nameOffset);
+            return 1;
+        }
+
+        uint32_t slot = entries[i].hash & (numSlots - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (numSlots - 1);
+        }
+        slots[slot] = i + 1;
+    }
+
+    FILE* output = fopen(packPath, "wb");
+    if (!output) {
+        printf("Error: Could not write %s\n", packPath);
+        return 1;
+    }
+
+    fwrite(&header, sizeof(header), 1, output);
+    fwrite(entries, sizeof(PackEntry), list.count, output);
+    fwrite(slots, sizeof(uint32_t), numSlots, output);
+    fwrite(names, 1, header.dataOffset - header.namesOffset, output);
+
+    // entries were written in path order before sorting, so walk the files again in that order
+    bool passed = true;
+    uint64_t position = header.dataOffset;
+    for (unsigned int i = 0; i < list.count && passed; i++) {
+        const PackFile* file = &list.files[i];
+        if (file->stored) {
+            passed = fwrite(file->stored, 1, file->storedSize, output) == file->storedSize;
+        } else {
+            passed = copyFile(output, file);
+        }
+        uint64_t next = alignOffset(position + file->storedSize);
+        for (uint64_t pad = position + file->storedSize; pad < next; pad++) {
+            fputc(0, output);
+        }
+        position = next;
+    }
+
+    if (fclose(output) != 0 || !passed) {
+        printf("Error: Writing %s failed\n", packPath);
+        remove(packPath);
+        return 1;
+    }
+
+    printf("Packed %u files into %s, %.1f MiB, %u compressed\n", list.count, packPath,
+           (double)header.size / (1024.0 * 1024.0), numCompressed);
+    for (unsigned int i = 0; i < list.count; i++) {
+        free(list.files[i].stored);
+    }
+    free(entries);
+    free(names);
+    free(slots);
+    free(list.files);
+    return 0;
+}